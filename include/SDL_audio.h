@@ -246,6 +246,57 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
  */
 extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
 
+/** A structure converting audio a piece at a time */
+typedef struct SDL_AudioStream SDL_AudioStream;
+
+/**
+ * This function creates a stream converting audio from one format, number
+ * of channels and rate to another.  Unlike SDL_ConvertAudio(), the stream
+ * keeps the state of its filters from one call to the next, so audio put
+ * in pieces of any size converts as it would in one buffer, and it holds
+ * the converted audio until it's read.  The rate conversion uses the
+ * quality set with SDL_AUDIO_RESAMPLER, or 2 if that isn't set.
+ *
+ * @return The new stream, or NULL if there was an error.
+ */
+extern DECLSPEC SDL_AudioStream * SDLCALL SDL_NewAudioStream(
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate);
+
+/**
+ * Put 'len' bytes of audio in the source format into the stream.
+ * The resampler holds back the last few frames until the audio that
+ * follows them is put, or the stream is flushed.
+ *
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len);
+
+/**
+ * Read up to 'len' bytes of converted audio from the stream, in whole
+ * frames of the destination format.
+ *
+ * @return The number of bytes read.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len);
+
+/** Get the number of bytes of converted audio ready to be read */
+extern DECLSPEC int SDLCALL SDL_AudioStreamAvailable(SDL_AudioStream *stream);
+
+/**
+ * Convert the audio the stream is holding back, as if silence followed
+ * it, at the end of a sound.  Audio put after this starts afresh.
+ *
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamFlush(SDL_AudioStream *stream);
+
+/** Throw away all of the audio in the stream */
+extern DECLSPEC void SDLCALL SDL_AudioStreamClear(SDL_AudioStream *stream);
+
+/** Free a stream created with SDL_NewAudioStream() */
+extern DECLSPEC void SDLCALL SDL_FreeAudioStream(SDL_AudioStream *stream);
+
 
 #define SDL_MIX_MAXVOLUME 128
 /**
@@ -257,6 +308,42 @@ extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
  */
 extern DECLSPEC void SDLCALL SDL_MixAudio(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
 
+/**
+ * This adds an audio buffer of the playing audio format to an accumulator
+ * of one Sint32 per sample, which should start out zeroed.  The samples
+ * are added times the volume, which ranges from 0 - 128 like the volume
+ * of SDL_MixAudio(), so the accumulator has room for hundreds of sounds
+ * at full volume.  Once all of the sounds are in, SDL_MixAudioClamp()
+ * turns the sum into audio, clipping it once instead of after each sound.
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioAccum(Sint32 *accum, const Uint8 *src, Uint32 len, int volume);
+
+/**
+ * This writes 'len' bytes of the playing audio format to 'dst' from an
+ * accumulator filled by SDL_MixAudioAccum(), clipping each sample to the
+ * range of the format.
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioClamp(Uint8 *dst, const Sint32 *accum, Uint32 len);
+
+/** A sound to mix with SDL_MixAudioVoices() */
+typedef struct SDL_AudioVoice {
+	const Uint8 *src;	/**< Audio in the playing audio format */
+	Uint32 len;		/**< Length of src in bytes */
+	int left_volume;	/**< Volume of the left channels, 0 - 128 */
+	int right_volume;	/**< Volume of the right channels, 0 - 128 */
+} SDL_AudioVoice;
+
+/**
+ * This mixes 'numvoices' sounds into 'len' bytes of 'dst' in one pass,
+ * with a separate volume for the left and right channels of each sound.
+ * Mono audio is mixed at the average of the two volumes, as are the
+ * center and LFE channels of 6 channel audio.  A sound shorter than 'len'
+ * is only mixed for its own length.  The sum is clipped once, like
+ * SDL_MixAudioAccum() followed by SDL_MixAudioClamp(), so it can differ
+ * slightly from calling SDL_MixAudio() for each sound.
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioVoices(Uint8 *dst, const SDL_AudioVoice *voices, int numvoices, Uint32 len);
+
 /**
  * @name Audio Locks
  * The lock manipulated by these functions protects the callback function.
@@ -203,6 +203,11 @@ typedef struct SDL_VideoInfo {
 #define SDL_YUY2_OVERLAY  0x32595559	/**< Packed mode: Y0+U0+Y1+V0 (1 plane) */
 #define SDL_UYVY_OVERLAY  0x59565955	/**< Packed mode: U0+Y0+V0+Y1 (1 plane) */
 #define SDL_YVYU_OVERLAY  0x55595659	/**< Packed mode: Y0+V0+Y1+U0 (1 plane) */
+#define SDL_NV12_OVERLAY  0x3231564E	/**< Planar mode: Y + U/V interleaved  (2 planes) */
+#define SDL_NV21_OVERLAY  0x3132564E	/**< Planar mode: Y + V/U interleaved  (2 planes) */
+#define SDL_P010_OVERLAY  0x30313050	/**< Planar mode: Y + U/V interleaved, 16-bit
+					     little endian samples with 10 bits
+					     in the top bits  (2 planes) */
 /*@}*/
 
 /** The YUV hardware video overlay */
@@ -604,6 +609,39 @@ extern DECLSPEC int SDLCALL SDL_SaveBMP_RW
 #define SDL_SaveBMP(surface, file) \
 		SDL_SaveBMP_RW(surface, SDL_RWFromFile(file, "wb"), 1)
 
+/**
+ * Save the RLE encoding of a surface to an SDL data source, so it can be
+ * loaded back with SDL_LoadRLE_RW() without encoding it again.  The
+ * surface must be RLE accelerated (SDL_RLEACCEL set, which happens on its
+ * first blit with SDL_RLEACCEL requested).  The data is in the byte order
+ * of this machine, and is only meant as a cache.
+ * If 'freedst' is non-zero, the destination will be closed after being
+ * written.
+ * Returns 0 if successful or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_SaveRLE_RW
+		(SDL_Surface *surface, SDL_RWops *dst, int freedst);
+
+/**
+ * Load an RLE accelerated surface saved by SDL_SaveRLE_RW().  The surface
+ * has no pixels until it is locked, which decodes it.  'dst' is the
+ * surface it will be blitted to, usually the display surface: if the
+ * encoding suits it, as when it was saved after a blit to a surface of the
+ * same format, blits to 'dst' use the loaded encoding as is.  Otherwise,
+ * or if 'dst' is NULL, the surface is decoded, and encoded again on its
+ * next blit.
+ * If 'freesrc' is non-zero, the source will be closed after being read.
+ * Returns the new surface, or NULL if there was an error.
+ */
+extern DECLSPEC SDL_Surface * SDLCALL SDL_LoadRLE_RW
+		(SDL_RWops *src, int freesrc, SDL_Surface *dst);
+
+/** Convenience macros -- save and load an RLE encoded surface to a file */
+#define SDL_SaveRLE(surface, file) \
+		SDL_SaveRLE_RW(surface, SDL_RWFromFile(file, "wb"), 1)
+#define SDL_LoadRLE(file, dst) \
+		SDL_LoadRLE_RW(SDL_RWFromFile(file, "rb"), 1, dst)
+
 /**
  * Sets the color key (transparent pixel) in a blittable surface.
  * If 'flag' is SDL_SRCCOLORKEY (optionally OR'd with SDL_RLEACCEL), 
@@ -756,6 +794,25 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 			(SDL_Surface *src, SDL_Rect *srcrect,
 			 SDL_Surface *dst, SDL_Rect *dstrect);
 
+/** One blit of a batch passed to SDL_BlitSurfaces() */
+typedef struct SDL_BlitRequest {
+	SDL_Surface *src;	/**< Surface to blit from */
+	SDL_Rect srcrect;	/**< Area of the source surface to blit */
+	SDL_Rect dstrect;	/**< Position of the blit, set to the final
+				 *   blit rectangle like SDL_BlitSurface() */
+} SDL_BlitRequest;
+
+/**
+ * This function performs 'numblits' blits onto 'dst', in order, with the
+ * same clipping and results as calling SDL_BlitSurface() for each one.
+ * The destination is locked only once, and consecutive blits from the same
+ * source surface share its lock and blit mapping, so sorting the requests
+ * by source surface (where they don't overlap) makes the batch faster.
+ * This function returns 0 on success, or -1 if any of the blits failed.
+ */
+extern DECLSPEC int SDLCALL SDL_BlitSurfaces
+			(SDL_Surface *dst, int numblits, SDL_BlitRequest *blits);
+
 /**
  * This function performs a fast fill of the given rectangle with 'color'
  * The given rectangle is clipped to the destination surface clip area
@@ -768,6 +825,17 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 extern DECLSPEC int SDLCALL SDL_FillRect
 		(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color);
 
+/**
+ * This function fills 'numrects' rectangles of 'dst' with 'color', with the
+ * same results as calling SDL_FillRect() for each one, but the rectangles
+ * in 'rects' are not modified.  Overlapping and adjacent rectangles are
+ * merged where possible, the rest are filled top to bottom, and the surface
+ * is locked only once.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_FillRects
+		(SDL_Surface *dst, int numrects, SDL_Rect *rects, Uint32 color);
+
 /**
  * This function takes a surface and copies it to a new surface of the
  * pixel format and colors of the video framebuffer, suitable for fast
@@ -823,6 +891,18 @@ extern DECLSPEC int SDLCALL SDL_DisplayYUVOverlay(SDL_Overlay *overlay, SDL_Rect
 /** Free a video overlay */
 extern DECLSPEC void SDLCALL SDL_FreeYUVOverlay(SDL_Overlay *overlay);
 
+/** Make a software overlay display planes owned by the caller, such as the
+ *  output buffers of a video decoder, instead of copying them into its
+ *  own pixels.
+ *  'pixels' and 'pitches' give overlay->planes planes in the overlay's
+ *  format, and must stay valid as long as the overlay displays them.
+ *  Passing NULL for 'pixels' goes back to the overlay's own planes.
+ *  Returns 0, or -1 if the overlay is hardware accelerated or a pitch is
+ *  too small.
+ */
+extern DECLSPEC int SDLCALL SDL_SetYUVOverlayPlanes(SDL_Overlay *overlay,
+				Uint8 **pixels, const Uint16 *pitches);
+
 /*@}*/
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -942,6 +1022,48 @@ extern DECLSPEC SDL_GrabMode SDLCALL SDL_WM_GrabInput(SDL_GrabMode mode);
 /** @internal Not in public API at the moment - do not use! */
 extern DECLSPEC int SDLCALL SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                                     SDL_Surface *dst, SDL_Rect *dstrect);
+
+/** @name Stretch filters for SDL_SoftStretchEx() */
+/*@{*/
+#define SDL_STRETCH_NEAREST	0x00	/**< Nearest neighbour, like SDL_SoftStretch() */
+#define SDL_STRETCH_BILINEAR	0x01	/**< Bilinear interpolation */
+#define SDL_STRETCH_BOX		0x02	/**< Average of the covered source pixels, for shrinking */
+/*@}*/
+
+/**
+ * Stretch 'srcrect' of 'src' into 'dstrect' of 'dst', which must have the
+ * same pixel format, using the filter selected in 'flags'.
+ * The filters work on the raw pixel values, so they aren't suited to
+ * colorkeyed surfaces, and 8-bit (paletted) surfaces always use
+ * SDL_STRETCH_NEAREST.  When enlarging, SDL_STRETCH_BOX is equivalent to
+ * SDL_STRETCH_NEAREST.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchEx(SDL_Surface *src, SDL_Rect *srcrect,
+                                    SDL_Surface *dst, SDL_Rect *dstrect, Uint32 flags);
+
+/**
+ * A stretch context holds the scaling tables and row buffers of a stretch,
+ * so that repeating a stretch with the same sizes and filter, for example
+ * once per video frame, doesn't rebuild them.  SDL_SoftStretchEx() keeps
+ * no state between calls, and a context may only be used by one thread at
+ * a time, so threads stretching in parallel should each have their own.
+ */
+typedef struct SDL_StretchContext SDL_StretchContext;
+
+/** Create an empty stretch context, or return NULL if out of memory */
+extern DECLSPEC SDL_StretchContext * SDLCALL SDL_CreateStretchContext(void);
+
+/** Free a stretch context */
+extern DECLSPEC void SDLCALL SDL_FreeStretchContext(SDL_StretchContext *ctx);
+
+/**
+ * Perform the same stretch as SDL_SoftStretchEx(), reusing the tables in
+ * 'ctx' if the last stretch with it had the same sizes, format and filter.
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchContext(SDL_StretchContext *ctx,
+                                    SDL_Surface *src, SDL_Rect *srcrect,
+                                    SDL_Surface *dst, SDL_Rect *dstrect, Uint32 flags);
                     
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
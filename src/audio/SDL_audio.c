@@ -176,7 +176,22 @@ int SDLCALL SDL_RunAudio(void *audiop)
 		}
 
 		/* Convert the audio if necessary */
-		if ( audio->convert.needed ) {
+		if ( audio->convert_stream ) {
+			/* Keep the filter history between buffers, and
+			   run the callback again until a buffer is ready */
+			SDL_AudioStreamPut(audio->convert_stream,
+			                   audio->convert.buf, stream_len);
+			if ( SDL_AudioStreamAvailable(audio->convert_stream) <
+			     (int)audio->spec.size ) {
+				continue;
+			}
+			stream = audio->GetAudioBuf(audio);
+			if ( stream == NULL ) {
+				stream = audio->fake_stream;
+			}
+			SDL_AudioStreamGet(audio->convert_stream,
+			                   stream, audio->spec.size);
+		} else if ( audio->convert.needed ) {
 			SDL_ConvertAudio(&audio->convert);
 			stream = audio->GetAudioBuf(audio);
 			if ( stream == NULL ) {
@@ -471,6 +486,7 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	/* Open the audio subsystem */
 	SDL_memcpy(&audio->spec, desired, sizeof(audio->spec));
 	audio->convert.needed = 0;
+	audio->convert_stream = NULL;
 	audio->enabled = 1;
 	audio->paused  = 1;
 
@@ -501,18 +517,44 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	} else if ( desired->freq != audio->spec.freq ||
 		    desired->format != audio->spec.format ||
 		    desired->channels != audio->spec.channels ) {
-		/* Build an audio conversion block */
-		if ( SDL_BuildAudioCVT(&audio->convert,
+		/* Build an audio conversion block.  Drivers that run the
+		   callback themselves convert each buffer straight into the
+		   device buffer, and resampled buffers don't fit it exactly,
+		   so only the audio thread uses the resampler, through a
+		   stream that carries the extra frames over. */
+		if ( SDL_BuildAudioCVTQuality(&audio->convert,
 			desired->format, desired->channels,
 					desired->freq,
 			audio->spec.format, audio->spec.channels,
-					audio->spec.freq) < 0 ) {
+					audio->spec.freq,
+			(audio->opened == 1) ? SDL_GetResamplerQuality() : 0) < 0 ) {
 			SDL_CloseAudio();
 			return(-1);
 		}
 		if ( audio->convert.needed ) {
 			audio->convert.len = (int) ( ((double) audio->spec.size) /
                                           audio->convert.len_ratio );
+			if ( audio->convert.rate_incr != 0.0 ) {
+				/* Rounding down keeps each callback within a
+				   device buffer, so the stream can't build up
+				   a backlog */
+				int frame = ((desired->format & 0xFF)/8) *
+				            desired->channels;
+
+				audio->convert_stream = SDL_NewAudioStream(
+					desired->format, desired->channels,
+					desired->freq, audio->spec.format,
+					audio->spec.channels, audio->spec.freq);
+				if ( audio->convert_stream == NULL ) {
+					SDL_CloseAudio();
+					return(-1);
+				}
+				audio->convert.len =
+					(audio->convert.len/frame) * frame;
+				if ( audio->convert.len == 0 ) {
+					audio->convert.len = frame;
+				}
+			}
 			audio->convert.buf =(Uint8 *)SDL_AllocAudioMem(
 			   audio->convert.len*audio->convert.len_mult);
 			if ( audio->convert.buf == NULL ) {
@@ -522,6 +564,11 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 			}
 		}
 	}
+	if ( audio->convert.needed ) {
+		audio->mix_channels = desired->channels;
+	} else {
+		audio->mix_channels = audio->spec.channels;
+	}
 
 	/* Start the audio thread if necessary */
 	switch (audio->opened) {
@@ -617,6 +664,9 @@ void SDL_AudioQuit(void)
 			SDL_FreeAudioMem(audio->convert.buf);
 
 		}
+		if ( audio->convert_stream ) {
+			SDL_FreeAudioStream(audio->convert_stream);
+		}
 		if ( audio->opened ) {
 			audio->CloseAudio(audio);
 			audio->opened = 0;
@@ -21,6 +21,17 @@
 */
 #include "SDL_config.h"
 
+/* x86 SSE intrinsics audio routines.  They are built with per-function
+   target attributes, so the rest of the library keeps the baseline
+   instruction set, and are picked at runtime from the CPU features. */
+#if SDL_ASSEMBLY_ROUTINES && (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SDL_SSE_AUDIO 1
+#define SDL_AUDIO_TARGETING(x) __attribute__((target(x)))
+#include <immintrin.h>
+extern SDL_bool SDL_HasAVX2(void);	/* whether CPU and OS support x86 AVX2 */
+#endif
+
 /* Functions and variables exported from SDL_audio.c for SDL_sysaudio.c */
 
 /* Functions to get a list of "close" audio formats */
@@ -30,6 +41,15 @@ extern Uint16 SDL_NextAudioFormat(void);
 /* Function to calculate the size and silence for a SDL_AudioSpec */
 extern void SDL_CalculateAudioSpec(SDL_AudioSpec *spec);
 
+/* The resampler quality from SDL_AUDIO_RESAMPLER, 0 if it's off */
+extern int SDL_GetResamplerQuality(void);
+
+/* SDL_BuildAudioCVT() with the resampler at the given quality, or the
+   old rate converters if it's 0 */
+extern int SDL_BuildAudioCVTQuality(SDL_AudioCVT *cvt,
+	Uint16 src_format, Uint8 src_channels, int src_rate,
+	Uint16 dst_format, Uint8 dst_channels, int dst_rate, int quality);
+
 /* The actual mixing thread function */
 extern int SDLCALL SDL_RunAudio(void *audiop);
 
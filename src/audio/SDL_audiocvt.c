@@ -23,7 +23,18 @@
 
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
+#ifdef HAVE_MATH_H
+#include <math.h>	/* Used for building the resampler filter */
+#else
+/* Math routines from uClibc: http://www.uclibc.org */
+#include "../video/math_private.h"
+#include "../video/e_sqrt.h"
+#define sqrt(x)		__ieee754_sqrt(x)
+#endif
+
 #include "SDL_audio.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_audio_c.h"
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -1300,6 +1311,662 @@ void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/*
+ * Windowed-sinc resampler, doing the whole rate change in one pass when
+ * SDL_AUDIO_RESAMPLER is set to a quality level.  The filter is a Kaiser
+ * windowed sinc, tabulated at RESAMPLER_PHASES points per zero crossing;
+ * the taps for each output frame are interpolated from the table, and
+ * stretched when downsampling so the cutoff follows the lower rate.
+ */
+#define RESAMPLER_QUALITIES	3
+#define RESAMPLER_PHASES	256
+#define RESAMPLER_PI		3.14159265358979323846
+
+static const struct {
+	int zero_crossings;
+	double beta;		/* Kaiser window shape */
+	double rolloff;		/* cutoff, relative to the lower Nyquist rate */
+} resampler_levels[RESAMPLER_QUALITIES] = {
+	{ 4, 5.0, 0.85 },
+	{ 8, 7.0, 0.92 },
+	{ 16, 9.0, 0.96 }
+};
+
+static float resampler_table1[4*RESAMPLER_PHASES+2];
+static float resampler_table2[8*RESAMPLER_PHASES+2];
+static float resampler_table3[16*RESAMPLER_PHASES+2];
+static float *resampler_tables[RESAMPLER_QUALITIES] = {
+	resampler_table1, resampler_table2, resampler_table3
+};
+static int resampler_built[RESAMPLER_QUALITIES];
+
+/* The resampler quality from SDL_AUDIO_RESAMPLER, 0 if it's off */
+int SDL_GetResamplerQuality(void)
+{
+	const char *env = SDL_getenv("SDL_AUDIO_RESAMPLER");
+	int quality = env ? SDL_atoi(env) : 0;
+
+	if ( quality < 0 ) {
+		quality = 0;
+	} else if ( quality > RESAMPLER_QUALITIES ) {
+		quality = RESAMPLER_QUALITIES;
+	}
+	return(quality);
+}
+
+/* Zeroth order modified Bessel function of the first kind */
+static double SDL_BesselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	double q = x*x/4.0;
+	int k;
+
+	for ( k = 1; term > sum*1e-12; ++k ) {
+		term *= q/((double)k*k);
+		sum += term;
+	}
+	return(sum);
+}
+
+static void SDL_BuildResamplerTable(int quality)
+{
+	float *table = resampler_tables[quality-1];
+	int n = resampler_levels[quality-1].zero_crossings*RESAMPLER_PHASES;
+	double beta = resampler_levels[quality-1].beta;
+	double a, sin_a, cos_a, s, c, t, x, w;
+	int i;
+
+	if ( resampler_built[quality-1] ) {
+		return;
+	}
+
+	/* sin(pi*x) for each table point, by rotating through the phases */
+	a = RESAMPLER_PI/RESAMPLER_PHASES;
+	sin_a = a - a*a*a/6.0 + a*a*a*a*a/120.0;
+	cos_a = 1.0 - a*a/2.0 + a*a*a*a/24.0 - a*a*a*a*a*a/720.0;
+	s = 0.0;
+	c = 1.0;
+	table[0] = 1.0f;
+	for ( i = 1; i <= n; ++i ) {
+		t = s*cos_a + c*sin_a;
+		c = c*cos_a - s*sin_a;
+		s = t;
+		x = (double)i/RESAMPLER_PHASES;
+		w = 1.0 - ((double)i/n)*((double)i/n);
+		w = SDL_BesselI0(beta*sqrt(w > 0.0 ? w : 0.0))/SDL_BesselI0(beta);
+		table[i] = (float)(s/(RESAMPLER_PI*x)*w);
+	}
+	table[n+1] = 0.0f;
+	resampler_built[quality-1] = 1;
+}
+
+/* Read 'count' samples of 'format' as floats in [-1, 1).  This goes from
+   the last sample down, so it can be done in place. */
+static void SDL_ResamplerLoad(const Uint8 *src, float *dst, int count, Uint16 format)
+{
+	int i;
+
+	switch (format) {
+		case AUDIO_U8:
+			for ( i = count-1; i >= 0; --i ) {
+				dst[i] = (float)(src[i]-128)*(1.0f/128.0f);
+			}
+			break;
+		case AUDIO_S8:
+			for ( i = count-1; i >= 0; --i ) {
+				dst[i] = (float)((Sint8)src[i])*(1.0f/128.0f);
+			}
+			break;
+		case AUDIO_U16LSB:
+			for ( i = count-1; i >= 0; --i ) {
+				int v = (src[2*i+1]<<8)|src[2*i];
+				dst[i] = (float)(v-32768)*(1.0f/32768.0f);
+			}
+			break;
+		case AUDIO_U16MSB:
+			for ( i = count-1; i >= 0; --i ) {
+				int v = (src[2*i]<<8)|src[2*i+1];
+				dst[i] = (float)(v-32768)*(1.0f/32768.0f);
+			}
+			break;
+		case AUDIO_S16LSB:
+			for ( i = count-1; i >= 0; --i ) {
+				Sint16 v = (Sint16)((src[2*i+1]<<8)|src[2*i]);
+				dst[i] = (float)v*(1.0f/32768.0f);
+			}
+			break;
+		case AUDIO_S16MSB:
+			for ( i = count-1; i >= 0; --i ) {
+				Sint16 v = (Sint16)((src[2*i]<<8)|src[2*i+1]);
+				dst[i] = (float)v*(1.0f/32768.0f);
+			}
+			break;
+	}
+}
+
+/* Write 'count' float samples as 'format', rounded and clipped */
+static void SDL_ResamplerStore(const float *src, Uint8 *dst, int count, Uint16 format)
+{
+	int i, v;
+	float f;
+
+	for ( i = 0; i < count; ++i ) {
+		if ( (format & 0xFF) == 8 ) {
+			f = src[i]*128.0f;
+			v = (f >= 0.0f) ? (int)(f+0.5f) : -(int)(0.5f-f);
+			if ( v > 127 ) {
+				v = 127;
+			} else if ( v < -128 ) {
+				v = -128;
+			}
+			if ( format == AUDIO_U8 ) {
+				v += 128;
+			}
+			dst[i] = (Uint8)v;
+		} else {
+			f = src[i]*32768.0f;
+			v = (f >= 0.0f) ? (int)(f+0.5f) : -(int)(0.5f-f);
+			if ( v > 32767 ) {
+				v = 32767;
+			} else if ( v < -32768 ) {
+				v = -32768;
+			}
+			if ( !(format & 0x8000) ) {
+				v += 32768;
+			}
+			if ( format & 0x1000 ) {
+				dst[2*i] = (Uint8)(v>>8);
+				dst[2*i+1] = (Uint8)v;
+			} else {
+				dst[2*i] = (Uint8)v;
+				dst[2*i+1] = (Uint8)(v>>8);
+			}
+		}
+	}
+}
+
+/* Sum 'src' times 'coefs' over 'n' interleaved samples, per channel */
+static void SDL_ResampleDot(const float *src, const float *coefs, int n,
+                            int channels, float *out)
+{
+	int i, c;
+
+	for ( c = 0; c < channels; ++c ) {
+		out[c] = 0.0f;
+	}
+	for ( i = 0; i < n; i += channels ) {
+		for ( c = 0; c < channels; ++c ) {
+			out[c] += src[i+c]*coefs[i+c];
+		}
+	}
+}
+
+#if SDL_SSE_AUDIO
+/* 'n' is a multiple of both 4 and 'channels', so lane l of accumulator a
+   always holds channel (4*a+l) % channels */
+SDL_AUDIO_TARGETING("sse")
+static void SDL_ResampleDotSSE(const float *src, const float *coefs, int n,
+                               int channels, float *out)
+{
+	__m128 acc[3];
+	float lanes[12];
+	int blocks = (channels % 4 == 0) ? 1 : ((channels % 2 == 0) ? channels/2 : channels);
+	int i, a, c;
+
+	for ( a = 0; a < blocks; ++a ) {
+		acc[a] = _mm_setzero_ps();
+	}
+	for ( i = 0; i < n; ) {
+		for ( a = 0; a < blocks; ++a, i += 4 ) {
+			acc[a] = _mm_add_ps(acc[a], _mm_mul_ps(
+			         _mm_loadu_ps(src+i), _mm_loadu_ps(coefs+i)));
+		}
+	}
+	for ( a = 0; a < blocks; ++a ) {
+		_mm_storeu_ps(lanes+4*a, acc[a]);
+	}
+	for ( c = 0; c < channels; ++c ) {
+		out[c] = 0.0f;
+	}
+	for ( i = 0; i < 4*blocks; ++i ) {
+		out[i % channels] += lanes[i];
+	}
+}
+#endif
+
+/* The filter for one rate change, shared by every output frame */
+typedef struct SDL_Resampler {
+	const float *table;
+	int table_len;
+	double incr;		/* input frames per output frame */
+	double step;		/* table points per input frame */
+	int half;		/* input frames on each side of an output frame */
+	int taps;		/* input frames read per output frame */
+	int channels;
+	void (*dot)(const float *, const float *, int, int, float *);
+} SDL_Resampler;
+
+static void SDL_InitResampler(SDL_Resampler *rs, int quality, double incr, int channels)
+{
+	double scale;
+
+	rs->table = resampler_tables[quality-1];
+	rs->table_len = resampler_levels[quality-1].zero_crossings*RESAMPLER_PHASES;
+	rs->incr = incr;
+	rs->channels = channels;
+
+	/* Downsampling lowers the cutoff and widens the filter to match */
+	scale = resampler_levels[quality-1].rolloff;
+	if ( incr > 1.0 ) {
+		scale /= incr;
+	}
+	rs->step = scale*RESAMPLER_PHASES;
+	rs->half = (int)(resampler_levels[quality-1].zero_crossings/scale) + 1;
+	rs->taps = 2*rs->half;
+	/* Pad to whole SSE vectors */
+	while ( (rs->taps*channels) % 4 ) {
+		++rs->taps;
+	}
+
+	rs->dot = SDL_ResampleDot;
+#if SDL_SSE_AUDIO
+	if ( SDL_HasSSE() ) {
+		rs->dot = SDL_ResampleDotSSE;
+	}
+#endif
+}
+
+/* Filter one output frame from the 'taps' input frames at 'src', where
+   'pos' is the output's position in frames past the first of them.
+   'coefs' is scratch space for taps*channels floats. */
+static void SDL_ResampleFrame(const SDL_Resampler *rs, const float *src,
+                              double pos, float *coefs, float *out)
+{
+	const float *table = rs->table;
+	int channels = rs->channels;
+	double d;
+	float sum;
+	int k, c, idx;
+
+	/* Interpolate the taps from the table and normalize them */
+	pos *= rs->step;
+	sum = 0.0f;
+	for ( k = 0; k < rs->taps; ++k ) {
+		d = pos - k*rs->step;
+		if ( d < 0.0 ) {
+			d = -d;
+		}
+		idx = (int)d;
+		if ( idx < rs->table_len ) {
+			coefs[k*channels] = table[idx] +
+			       (float)(d-idx)*(table[idx+1]-table[idx]);
+		} else {
+			coefs[k*channels] = 0.0f;
+		}
+		sum += coefs[k*channels];
+	}
+	sum = 1.0f/sum;
+	for ( k = 0; k < rs->taps; ++k ) {
+		float coef = coefs[k*channels]*sum;
+		for ( c = 0; c < channels; ++c ) {
+			coefs[k*channels+c] = coef;
+		}
+	}
+	rs->dot(src, coefs, rs->taps*channels, channels, out);
+}
+
+static void SDL_Resample(SDL_AudioCVT *cvt, Uint16 format, int channels, int quality)
+{
+	SDL_Resampler rs;
+	double t;
+	int frame, inframes, outframes, first;
+	int i, j, k, c;
+	float *in, *coefs, *window, samples[6];
+	const float *src;
+	Uint8 *out;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Resampling audio * %4.4f\n", 1.0/cvt->rate_incr);
+#endif
+	SDL_InitResampler(&rs, quality, cvt->rate_incr, channels);
+	frame = ((format & 0xFF)/8)*channels;
+	inframes = cvt->len_cvt/frame;
+	outframes = (int)((double)inframes/rs.incr + 1e-6);
+
+	/* The input goes to floats in place, the output right after it */
+	in = (float *)cvt->buf;
+	out = cvt->buf + inframes*channels*sizeof(float);
+	SDL_ResamplerLoad(cvt->buf, in, inframes*channels, format);
+
+	coefs = SDL_stack_alloc(float, 2*rs.taps*channels);
+	window = coefs + rs.taps*channels;
+	for ( j = 0; j < outframes; ++j ) {
+		t = j*rs.incr;
+		first = (int)t - rs.half + 1;
+
+		/* Past the ends of the buffer, the edge frames repeat */
+		if ( (first >= 0) && (first+rs.taps <= inframes) ) {
+			src = in + first*channels;
+		} else {
+			for ( k = 0; k < rs.taps; ++k ) {
+				i = first+k;
+				if ( i < 0 ) {
+					i = 0;
+				} else if ( i >= inframes ) {
+					i = inframes-1;
+				}
+				for ( c = 0; c < channels; ++c ) {
+					window[k*channels+c] = in[i*channels+c];
+				}
+			}
+			src = window;
+		}
+		SDL_ResampleFrame(&rs, src, t - first, coefs, samples);
+		SDL_ResamplerStore(samples, out+j*frame, channels, format);
+	}
+	SDL_stack_free(coefs);
+
+	SDL_memmove(cvt->buf, out, outframes*frame);
+	cvt->len_cvt = outframes*frame;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+#define RESAMPLE_FILTER(channels, quality) \
+static void SDLCALL SDL_Resample_c##channels##_q##quality(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	SDL_Resample(cvt, format, channels, quality); \
+}
+RESAMPLE_FILTER(1, 1)
+RESAMPLE_FILTER(2, 1)
+RESAMPLE_FILTER(4, 1)
+RESAMPLE_FILTER(6, 1)
+RESAMPLE_FILTER(1, 2)
+RESAMPLE_FILTER(2, 2)
+RESAMPLE_FILTER(4, 2)
+RESAMPLE_FILTER(6, 2)
+RESAMPLE_FILTER(1, 3)
+RESAMPLE_FILTER(2, 3)
+RESAMPLE_FILTER(4, 3)
+RESAMPLE_FILTER(6, 3)
+#undef RESAMPLE_FILTER
+
+static void (SDLCALL *resample_filters[RESAMPLER_QUALITIES][4])(SDL_AudioCVT *cvt, Uint16 format) = {
+	{ SDL_Resample_c1_q1, SDL_Resample_c2_q1, SDL_Resample_c4_q1, SDL_Resample_c6_q1 },
+	{ SDL_Resample_c1_q2, SDL_Resample_c2_q2, SDL_Resample_c4_q2, SDL_Resample_c6_q2 },
+	{ SDL_Resample_c1_q3, SDL_Resample_c2_q3, SDL_Resample_c4_q3, SDL_Resample_c6_q3 }
+};
+
+/*
+ * Fused conversion.  For mono and stereo audio, the endian, sign, 8/16-bit,
+ * channel and power of two rate filters above are done together in one
+ * pass, a block of frames at a time.  Samples go through the block as
+ * 16-bit values with the destination's sign, which gives the same results
+ * as the filters one after the other.
+ */
+#define FUSED_BLOCK	512	/* Output frames per block, a power of two */
+
+/* Read 'count' samples as 16-bit values, taking 'channels' samples from
+   every 'step' frames */
+static void SDL_FusedRead(const Uint8 *src, Uint16 format, int channels,
+                          int count, int step, Uint16 flip, Uint16 *out)
+{
+	int skip = ((format & 0xFF)/8)*channels*(step-1);
+	int i, c;
+
+	if ( step == 1 ) {
+		channels = count;
+	}
+	switch (format & 0x10FF) {
+		case 8:
+			for ( i = 0; i < count; i += channels, src += skip ) {
+				for ( c = 0; c < channels; ++c, ++src ) {
+					out[i+c] = (Uint16)(src[0] << 8) ^ flip;
+				}
+			}
+			break;
+		case 16:
+			for ( i = 0; i < count; i += channels, src += skip ) {
+				for ( c = 0; c < channels; ++c, src += 2 ) {
+					out[i+c] = (Uint16)((src[1] << 8) | src[0]) ^ flip;
+				}
+			}
+			break;
+		case 0x1000|16:
+			for ( i = 0; i < count; i += channels, src += skip ) {
+				for ( c = 0; c < channels; ++c, src += 2 ) {
+					out[i+c] = (Uint16)((src[0] << 8) | src[1]) ^ flip;
+				}
+			}
+			break;
+	}
+}
+
+/* Write 'count' 16-bit values as 'format' */
+static void SDL_FusedWrite(const Uint16 *in, int count, Uint16 format, Uint8 *dst)
+{
+	int i;
+
+	if ( (format & 0x10FF) == (AUDIO_U16SYS & 0x10FF) ) {
+		SDL_memcpy(dst, in, count*2);
+		return;
+	}
+	switch (format & 0x10FF) {
+		case 8:
+			for ( i = 0; i < count; ++i ) {
+				dst[i] = (Uint8)(in[i] >> 8);
+			}
+			break;
+		case 16:
+			for ( i = 0; i < count; ++i ) {
+				dst[2*i] = (Uint8)in[i];
+				dst[2*i+1] = (Uint8)(in[i] >> 8);
+			}
+			break;
+		case 0x1000|16:
+			for ( i = 0; i < count; ++i ) {
+				dst[2*i] = (Uint8)(in[i] >> 8);
+				dst[2*i+1] = (Uint8)in[i];
+			}
+			break;
+	}
+}
+
+#if SDL_SSE_AUDIO
+SDL_AUDIO_TARGETING("sse2")
+static void SDL_FusedRead8SSE2(const Uint8 *src, int count, Uint16 flip, Uint16 *out)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i mask = _mm_set1_epi16((short)flip);
+	__m128i v;
+	int i;
+
+	for ( i = 0; i+16 <= count; i += 16 ) {
+		v = _mm_loadu_si128((const __m128i *)(src+i));
+		_mm_storeu_si128((__m128i *)(out+i),
+		                 _mm_xor_si128(_mm_unpacklo_epi8(zero, v), mask));
+		_mm_storeu_si128((__m128i *)(out+i+8),
+		                 _mm_xor_si128(_mm_unpackhi_epi8(zero, v), mask));
+	}
+	for ( ; i < count; ++i ) {
+		out[i] = (Uint16)(src[i] << 8) ^ flip;
+	}
+}
+
+SDL_AUDIO_TARGETING("sse2")
+static void SDL_FusedWrite8SSE2(const Uint16 *in, int count, Uint8 *dst)
+{
+	__m128i lo, hi;
+	int i;
+
+	for ( i = 0; i+16 <= count; i += 16 ) {
+		lo = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(in+i)), 8);
+		hi = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(in+i+8)), 8);
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_packus_epi16(lo, hi));
+	}
+	for ( ; i < count; ++i ) {
+		dst[i] = (Uint8)(in[i] >> 8);
+	}
+}
+#endif
+
+/* Repeat each of 'count' samples, or pairs of samples, in place */
+static void SDL_FusedDouble16(Uint16 *block, int count)
+{
+	int i;
+
+	for ( i = count-1; i >= 0; --i ) {
+		block[2*i] = block[i];
+		block[2*i+1] = block[i];
+	}
+}
+
+static void SDL_FusedDouble32(Uint16 *block, int count)
+{
+	int i;
+
+	for ( i = count-1; i >= 0; --i ) {
+		block[4*i] = block[4*i+2] = block[2*i];
+		block[4*i+1] = block[4*i+3] = block[2*i+1];
+	}
+}
+
+/* Mix stereo pairs down to mono, the way SDL_ConvertMono() does at the
+   destination format */
+static void SDL_FusedMono(Uint16 *block, int count, Uint16 format)
+{
+	int i;
+
+	switch (format & 0x80FF) {
+		case AUDIO_U8:
+			for ( i = 0; i < count; ++i ) {
+				block[i] = (Uint16)((((block[2*i] >> 8) +
+				                      (block[2*i+1] >> 8)) / 2) << 8);
+			}
+			break;
+		case AUDIO_S8:
+			for ( i = 0; i < count; ++i ) {
+				Sint32 sample = (Sint8)(block[2*i] >> 8) +
+				                (Sint8)(block[2*i+1] >> 8);
+				block[i] = (Uint16)((Uint8)(sample / 2) << 8);
+			}
+			break;
+		case AUDIO_U16:
+			for ( i = 0; i < count; ++i ) {
+				block[i] = (Uint16)(((Sint32)block[2*i] +
+				                     block[2*i+1]) / 2);
+			}
+			break;
+		case AUDIO_S16:
+			for ( i = 0; i < count; ++i ) {
+				Sint32 sample = (Sint16)block[2*i] +
+				                (Sint16)block[2*i+1];
+				block[i] = (Uint16)(sample / 2);
+			}
+			break;
+	}
+}
+
+static void SDL_ConvertFused(SDL_AudioCVT *cvt, int src_channels, int dst_channels)
+{
+	Uint16 block[FUSED_BLOCK*2];
+	Uint16 src_format = cvt->src_format;
+	Uint16 dst_format = cvt->dst_format;
+	Uint16 flip = (Uint16)((src_format ^ dst_format) & 0x8000);
+	int src_frame = ((src_format & 0xFF)/8)*src_channels;
+	int dst_frame = ((dst_format & 0xFF)/8)*dst_channels;
+	int inframes, outframes, backwards;
+	int up, down, done, first, count, frames, j;
+	double rate;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting audio in one pass\n");
+#endif
+	/* The rest of the length ratio is the power of two rate change */
+	up = down = 0;
+	rate = cvt->len_ratio*src_frame/dst_frame;
+	while ( rate > 1.0 ) {
+		rate /= 2.0;
+		++up;
+	}
+	while ( rate < 1.0 ) {
+		rate *= 2.0;
+		++down;
+	}
+
+	inframes = cvt->len_cvt/src_frame;
+	outframes = (inframes << up) >> down;
+
+	/* Growing data is converted from the end, shrinking from the start,
+	   so each block only overwrites input that has been read.  The blocks
+	   are whole input frames when upsampling. */
+	backwards = ((dst_frame << up) > (src_frame << down));
+	for ( done = 0; done < outframes; done += count ) {
+		count = outframes - done;
+		if ( count > FUSED_BLOCK ) {
+			count = FUSED_BLOCK;
+		}
+		first = backwards ? (outframes - done - count) : done;
+		frames = count >> up;
+
+#if SDL_SSE_AUDIO
+		if ( ((src_format & 0xFF) == 8) && !down && SDL_HasSSE2() ) {
+			SDL_FusedRead8SSE2(cvt->buf + (first >> up)*src_frame,
+			                   frames*src_channels, flip, block);
+		} else
+#endif
+		SDL_FusedRead(cvt->buf + ((first << down) >> up)*src_frame,
+		              src_format, src_channels, frames*src_channels,
+		              1 << down, flip, block);
+
+		/* Mix or copy the channels, then double the frames up to the
+		   output rate */
+		if ( src_channels < dst_channels ) {
+			SDL_FusedDouble16(block, frames);
+		} else if ( src_channels > dst_channels ) {
+			SDL_FusedMono(block, frames, dst_format);
+		}
+		for ( j = 0; j < up; ++j ) {
+			if ( dst_channels == 1 ) {
+				SDL_FusedDouble16(block, frames << j);
+			} else {
+				SDL_FusedDouble32(block, frames << j);
+			}
+		}
+
+#if SDL_SSE_AUDIO
+		if ( ((dst_format & 0xFF) == 8) && SDL_HasSSE2() ) {
+			SDL_FusedWrite8SSE2(block, count*dst_channels,
+			                    cvt->buf + first*dst_frame);
+		} else
+#endif
+		SDL_FusedWrite(block, count*dst_channels, dst_format,
+		               cvt->buf + first*dst_frame);
+	}
+
+	cvt->len_cvt = outframes*dst_frame;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, dst_format);
+	}
+}
+
+#define FUSED_FILTER(src_channels, dst_channels) \
+static void SDLCALL SDL_ConvertFused_##src_channels##_##dst_channels(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	SDL_ConvertFused(cvt, src_channels, dst_channels); \
+}
+FUSED_FILTER(1, 1)
+FUSED_FILTER(1, 2)
+FUSED_FILTER(2, 1)
+FUSED_FILTER(2, 2)
+#undef FUSED_FILTER
+
+static void (SDLCALL *fused_filters[2][2])(SDL_AudioCVT *cvt, Uint16 format) = {
+	{ SDL_ConvertFused_1_1, SDL_ConvertFused_1_2 },
+	{ SDL_ConvertFused_2_1, SDL_ConvertFused_2_2 }
+};
+
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 {
 	/* Make sure there's data to convert */
@@ -1328,6 +1995,20 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	Uint16 src_format, Uint8 src_channels, int src_rate,
 	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
 {
+	return SDL_BuildAudioCVTQuality(cvt, src_format, src_channels, src_rate,
+	                                dst_format, dst_channels, dst_rate,
+	                                SDL_GetResamplerQuality());
+}
+
+/* The same, resampling at the given quality, or with the old rate
+   converters if it's 0 */
+int SDL_BuildAudioCVTQuality(SDL_AudioCVT *cvt,
+	Uint16 src_format, Uint8 src_channels, int src_rate,
+	Uint16 dst_format, Uint8 dst_channels, int dst_rate, int quality)
+{
+	int channel_index;
+	int orig_src_channels = src_channels;
+
 /*printf("Build format %04x->%04x, channels %u->%u, rate %d->%d\n",
 		src_format, dst_format, src_channels, dst_channels, src_rate, dst_rate);*/
 	/* Start off with no conversion necessary */
@@ -1435,6 +2116,26 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 
 	/* Do rate conversion */
 	cvt->rate_incr = 0.0;
+	if ( ((src_rate/100) != (dst_rate/100)) && quality ) {
+		double ratio = (double)dst_rate/src_rate;
+		double mult;
+
+		switch (src_channels) {
+			case 1: channel_index = 0; break;
+			case 2: channel_index = 1; break;
+			case 4: channel_index = 2; break;
+			case 6: channel_index = 3; break;
+			default: return -1;
+		}
+		SDL_BuildResamplerTable(quality);
+		cvt->filters[cvt->filter_index++] =
+				resample_filters[quality-1][channel_index];
+		cvt->rate_incr = (double)src_rate/dst_rate;
+		/* Room for the input as floats and the output after it */
+		mult = 32.0/(dst_format & 0xFF) + ratio;
+		cvt->len_mult *= ((int)mult < mult) ? (int)mult+1 : (int)mult;
+		cvt->len_ratio *= ratio;
+	} else
 	if ( (src_rate/100) != (dst_rate/100) ) {
 		Uint32 hi_rate, lo_rate;
 		int len_mult;
@@ -1497,6 +2198,18 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		}
 	}
 
+	/* Mono and stereo conversions without the resampler can be done in
+	   one pass instead of a chain of them */
+	if ( (cvt->filter_index > 1) && (cvt->rate_incr == 0.0) &&
+	     (orig_src_channels >= 1) && (orig_src_channels <= 2) &&
+	     (dst_channels >= 1) && (dst_channels <= 2) &&
+	     (((src_format & 0xFF) == 8) || ((src_format & 0xFF) == 16)) &&
+	     (((dst_format & 0xFF) == 8) || ((dst_format & 0xFF) == 16)) ) {
+		cvt->filters[0] =
+			fused_filters[orig_src_channels-1][dst_channels-1];
+		cvt->filter_index = 1;
+	}
+
 	/* Set up the filter information */
 	if ( cvt->filter_index != 0 ) {
 		cvt->needed = 1;
@@ -1508,3 +2221,333 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	}
 	return(cvt->needed);
 }
+
+/*
+ * Streaming conversion.  The format and channels are converted a chunk at
+ * a time with an SDL_AudioCVT at the source rate, and the rate with the
+ * resampler above, keeping the last input frames as history so pieces
+ * join up the way a single buffer would.  Converted audio is queued until
+ * it's read.
+ */
+#define AUDIOSTREAM_CHUNK	1024	/* Source frames converted per pass */
+#define AUDIOSTREAM_QUALITY	2	/* Resampler quality if none was set */
+
+struct SDL_AudioStream {
+	/* Format and channel conversion, at the source rate */
+	SDL_AudioCVT cvt;
+	int src_frame;
+	int dst_frame;
+	Uint16 dst_format;
+
+	/* The start of a frame that hasn't been put in completely yet */
+	Uint8 *partial;
+	int partial_len;
+
+	/* Rate conversion, when the rates differ */
+	int resampling;
+	SDL_Resampler rs;
+	float *history;		/* Input frames, from the oldest still needed */
+	int history_len;
+	int history_max;
+	int pos;		/* Next output frame, in history frames, */
+	int pos_frac;		/*  plus pos_frac/rate_out of a frame */
+	int rate_in;		/* The rates, divided by their common factor */
+	int rate_out;
+	float *coefs;
+
+	/* Converted audio waiting to be read */
+	Uint8 *queue;
+	int queue_head;
+	int queue_len;
+	int queue_max;
+};
+
+/* Start the history with silence, so the first frames have a past */
+static void SDL_ResetAudioStreamHistory(SDL_AudioStream *stream)
+{
+	if ( stream->resampling ) {
+		stream->history_len = stream->rs.half;
+		SDL_memset(stream->history, 0,
+		           stream->history_len*stream->rs.channels*sizeof(float));
+		stream->pos = stream->history_len;
+		stream->pos_frac = 0;
+	}
+}
+
+/* Make room for 'len' more bytes at the end of the queue */
+static Uint8 *SDL_AudioStreamQueueSpace(SDL_AudioStream *stream, int len)
+{
+	if ( stream->queue_head+stream->queue_len+len > stream->queue_max ) {
+		if ( stream->queue_head > 0 ) {
+			SDL_memmove(stream->queue,
+			            stream->queue+stream->queue_head,
+			            stream->queue_len);
+			stream->queue_head = 0;
+		}
+		if ( stream->queue_len+len > stream->queue_max ) {
+			int max = 2*(stream->queue_len+len);
+			Uint8 *queue = (Uint8 *)SDL_realloc(stream->queue, max);
+			if ( queue == NULL ) {
+				SDL_OutOfMemory();
+				return(NULL);
+			}
+			stream->queue = queue;
+			stream->queue_max = max;
+		}
+	}
+	return(stream->queue+stream->queue_head+stream->queue_len);
+}
+
+/* Filter every output frame before 'end' that the history reaches, then
+   let go of the input frames behind them.  The position is kept as an
+   exact fraction, so the output doesn't depend on how the input was cut
+   up. */
+static int SDL_AudioStreamResample(SDL_AudioStream *stream, int end)
+{
+	SDL_Resampler *rs = &stream->rs;
+	int channels = rs->channels;
+	int maxout, first;
+	float samples[6];
+	Uint8 *out;
+
+	maxout = (int)((double)(end - stream->pos)/rs->incr) + 1;
+	if ( maxout < 0 ) {
+		maxout = 0;
+	}
+	out = SDL_AudioStreamQueueSpace(stream, maxout*stream->dst_frame);
+	if ( out == NULL ) {
+		return(-1);
+	}
+	while ( stream->pos < end ) {
+		first = stream->pos - rs->half + 1;
+		if ( first+rs->taps > stream->history_len ) {
+			break;
+		}
+		SDL_ResampleFrame(rs, stream->history+first*channels,
+		    (stream->pos - first) + (double)stream->pos_frac/stream->rate_out,
+		    stream->coefs, samples);
+		SDL_ResamplerStore(samples, out, channels, stream->dst_format);
+		out += stream->dst_frame;
+		stream->queue_len += stream->dst_frame;
+
+		stream->pos += stream->rate_in / stream->rate_out;
+		stream->pos_frac += stream->rate_in % stream->rate_out;
+		if ( stream->pos_frac >= stream->rate_out ) {
+			stream->pos_frac -= stream->rate_out;
+			++stream->pos;
+		}
+	}
+
+	first = stream->pos - rs->half + 1;
+	if ( first > 0 ) {
+		stream->history_len -= first;
+		SDL_memmove(stream->history, stream->history+first*channels,
+		            stream->history_len*channels*sizeof(float));
+		stream->pos -= first;
+	}
+	return(0);
+}
+
+/* Convert the whole frames in the chunk buffer */
+static int SDL_AudioStreamConvert(SDL_AudioStream *stream, int len)
+{
+	SDL_AudioCVT *cvt = &stream->cvt;
+	Uint8 *out;
+	int frames;
+
+	cvt->len = len;
+	SDL_ConvertAudio(cvt);
+	if ( ! stream->resampling ) {
+		out = SDL_AudioStreamQueueSpace(stream, cvt->len_cvt);
+		if ( out == NULL ) {
+			return(-1);
+		}
+		SDL_memcpy(out, cvt->buf, cvt->len_cvt);
+		stream->queue_len += cvt->len_cvt;
+		return(0);
+	}
+
+	frames = cvt->len_cvt/(2*stream->rs.channels);
+	SDL_ResamplerLoad(cvt->buf,
+	                  stream->history+stream->history_len*stream->rs.channels,
+	                  frames*stream->rs.channels, AUDIO_S16SYS);
+	stream->history_len += frames;
+	return(SDL_AudioStreamResample(stream, stream->history_len));
+}
+
+SDL_AudioStream *SDL_NewAudioStream(
+	Uint16 src_format, Uint8 src_channels, int src_rate,
+	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	SDL_AudioStream *stream;
+	Uint16 cvt_format;
+	int quality, a, b, t;
+
+	if ( (src_channels == 0) || (dst_channels == 0) ||
+	     (src_rate <= 0) || (dst_rate <= 0) ) {
+		SDL_SetError("Invalid audio stream parameters");
+		return(NULL);
+	}
+	stream = (SDL_AudioStream *)SDL_malloc(sizeof(*stream));
+	if ( stream == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(stream, 0, sizeof(*stream));
+	stream->src_frame = ((src_format & 0xFF)/8)*src_channels;
+	stream->dst_frame = ((dst_format & 0xFF)/8)*dst_channels;
+	stream->dst_format = dst_format;
+	stream->resampling = (src_rate != dst_rate);
+
+	/* The resampler takes 16-bit input in the destination channels */
+	cvt_format = stream->resampling ? AUDIO_S16SYS : dst_format;
+	if ( SDL_BuildAudioCVT(&stream->cvt, src_format, src_channels, src_rate,
+	                       cvt_format, dst_channels, src_rate) < 0 ) {
+		SDL_FreeAudioStream(stream);
+		return(NULL);
+	}
+	stream->cvt.buf = (Uint8 *)SDL_malloc(
+		AUDIOSTREAM_CHUNK*stream->src_frame*stream->cvt.len_mult);
+	stream->partial = (Uint8 *)SDL_malloc(stream->src_frame);
+	/* Start with room for a chunk's output, twice over */
+	stream->queue_max = 2*stream->dst_frame*
+		((int)((double)AUDIOSTREAM_CHUNK*dst_rate/src_rate) + 1);
+	stream->queue = (Uint8 *)SDL_malloc(stream->queue_max);
+	if ( (stream->cvt.buf == NULL) || (stream->partial == NULL) ||
+	     (stream->queue == NULL) ) {
+		SDL_FreeAudioStream(stream);
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+
+	if ( stream->resampling ) {
+		switch (dst_channels) {
+			case 1: case 2: case 4: case 6:
+				break;
+			default:
+				SDL_FreeAudioStream(stream);
+				SDL_SetError("Can't resample %d channels", dst_channels);
+				return(NULL);
+		}
+		quality = SDL_GetResamplerQuality();
+		if ( quality == 0 ) {
+			quality = AUDIOSTREAM_QUALITY;
+		}
+		SDL_BuildResamplerTable(quality);
+		SDL_InitResampler(&stream->rs, quality,
+		                  (double)src_rate/dst_rate, dst_channels);
+		a = src_rate;
+		b = dst_rate;
+		while ( b ) {
+			t = a % b;
+			a = b;
+			b = t;
+		}
+		stream->rate_in = src_rate / a;
+		stream->rate_out = dst_rate / a;
+
+		/* Room for a chunk, what's kept between them, and the
+		   silence a flush adds */
+		stream->history_max = AUDIOSTREAM_CHUNK + 2*stream->rs.taps + 1;
+		stream->history = (float *)SDL_malloc(
+			stream->history_max*dst_channels*sizeof(float));
+		stream->coefs = (float *)SDL_malloc(
+			stream->rs.taps*dst_channels*sizeof(float));
+		if ( (stream->history == NULL) || (stream->coefs == NULL) ) {
+			SDL_FreeAudioStream(stream);
+			SDL_OutOfMemory();
+			return(NULL);
+		}
+		SDL_ResetAudioStreamHistory(stream);
+	}
+	return(stream);
+}
+
+int SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len)
+{
+	const Uint8 *src = (const Uint8 *)buf;
+	int chunk = AUDIOSTREAM_CHUNK*stream->src_frame;
+	int amount, whole;
+
+	while ( len > 0 ) {
+		/* Gather a chunk, starting with any partial frame */
+		SDL_memcpy(stream->cvt.buf, stream->partial, stream->partial_len);
+		amount = chunk - stream->partial_len;
+		if ( amount > len ) {
+			amount = len;
+		}
+		SDL_memcpy(stream->cvt.buf+stream->partial_len, src, amount);
+		src += amount;
+		len -= amount;
+		amount += stream->partial_len;
+
+		whole = amount - (amount % stream->src_frame);
+		stream->partial_len = amount - whole;
+		SDL_memcpy(stream->partial, stream->cvt.buf+whole,
+		           stream->partial_len);
+		if ( (whole > 0) && (SDL_AudioStreamConvert(stream, whole) < 0) ) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+int SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len)
+{
+	if ( len > stream->queue_len ) {
+		len = stream->queue_len;
+	}
+	len -= (len % stream->dst_frame);
+	SDL_memcpy(buf, stream->queue+stream->queue_head, len);
+	stream->queue_head += len;
+	stream->queue_len -= len;
+	if ( stream->queue_len == 0 ) {
+		stream->queue_head = 0;
+	}
+	return(len);
+}
+
+int SDL_AudioStreamAvailable(SDL_AudioStream *stream)
+{
+	return(stream->queue_len);
+}
+
+int SDL_AudioStreamFlush(SDL_AudioStream *stream)
+{
+	int end;
+	int retval = 0;
+
+	/* A partial frame can't be converted, so it's dropped */
+	stream->partial_len = 0;
+	if ( stream->resampling ) {
+		/* Pad with silence to filter the last frames, but stop at
+		   the output frames that would follow them */
+		end = stream->history_len;
+		SDL_memset(stream->history+stream->history_len*stream->rs.channels,
+		           0, stream->rs.taps*stream->rs.channels*sizeof(float));
+		stream->history_len += stream->rs.taps;
+		retval = SDL_AudioStreamResample(stream, end);
+		SDL_ResetAudioStreamHistory(stream);
+	}
+	return(retval);
+}
+
+void SDL_AudioStreamClear(SDL_AudioStream *stream)
+{
+	stream->partial_len = 0;
+	stream->queue_head = 0;
+	stream->queue_len = 0;
+	SDL_ResetAudioStreamHistory(stream);
+}
+
+void SDL_FreeAudioStream(SDL_AudioStream *stream)
+{
+	if ( stream ) {
+		SDL_free(stream->cvt.buf);
+		SDL_free(stream->partial);
+		SDL_free(stream->history);
+		SDL_free(stream->coefs);
+		SDL_free(stream->queue);
+		SDL_free(stream);
+	}
+}
@@ -27,6 +27,7 @@
 #include "SDL_timer.h"
 #include "SDL_audio.h"
 #include "SDL_sysaudio.h"
+#include "SDL_audio_c.h"
 #include "SDL_mixer_MMX.h"
 #include "SDL_mixer_MMX_VC.h"
 #include "SDL_mixer_m68k.h"
@@ -90,24 +91,409 @@ static const Uint8 mix8[] =
 #define ADJUST_VOLUME(s, v)	(s = (s*v)/SDL_MIX_MAXVOLUME)
 #define ADJUST_VOLUME_U8(s, v)	(s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
-void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+#if SDL_SSE_AUDIO
+/*
+ * SSE2 and AVX2 mixers.  They give the same results as the C loops below
+ * for volumes up to SDL_MIX_MAXVOLUME: the volume is applied with a
+ * division by 128 that truncates toward zero, like ADJUST_VOLUME, and the
+ * saturating adds clip like the C loops do.  Each one mixes whole vectors
+ * and returns the number of bytes it did, leaving the rest to the C loop.
+ */
+#define MIX_SHIFT	7	/* log2(SDL_MIX_MAXVOLUME) */
+
+/* Divide by SDL_MIX_MAXVOLUME, truncating toward zero */
+#define MIX_DIV32_SSE2(x) \
+	_mm_srai_epi32(_mm_add_epi32(x, _mm_and_si128(_mm_srai_epi32(x, 31), \
+	               _mm_set1_epi32(SDL_MIX_MAXVOLUME-1))), MIX_SHIFT)
+#define MIX_DIV16_SSE2(x) \
+	_mm_srai_epi16(_mm_add_epi16(x, _mm_and_si128(_mm_srai_epi16(x, 15), \
+	               _mm_set1_epi16(SDL_MIX_MAXVOLUME-1))), MIX_SHIFT)
+#define MIX_SWAP16_SSE2(x) \
+	_mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8))
+
+#define MIX_DIV32_AVX2(x) \
+	_mm256_srai_epi32(_mm256_add_epi32(x, _mm256_and_si256(_mm256_srai_epi32(x, 31), \
+	                  _mm256_set1_epi32(SDL_MIX_MAXVOLUME-1))), MIX_SHIFT)
+#define MIX_DIV16_AVX2(x) \
+	_mm256_srai_epi16(_mm256_add_epi16(x, _mm256_and_si256(_mm256_srai_epi16(x, 15), \
+	                  _mm256_set1_epi16(SDL_MIX_MAXVOLUME-1))), MIX_SHIFT)
+#define MIX_SWAP16_AVX2(x) \
+	_mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8))
+
+SDL_AUDIO_TARGETING("sse2")
+static Uint32 SDL_MixAudio_SSE2_U8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 {
-	Uint16 format;
+	__m128i zero = _mm_setzero_si128();
+	__m128i vol = _mm_set1_epi16((short)volume);
+	__m128i bias = _mm_set1_epi16(128);
+	__m128i top = _mm_set1_epi16(0xFE);
+	__m128i s, d, lo, hi;
+	Uint32 i;
 
-	if ( volume == 0 ) {
-		return;
+	for ( i = 0; i+16 <= len; i += 16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		d = _mm_loadu_si128((const __m128i *)(dst+i));
+		lo = _mm_sub_epi16(_mm_unpacklo_epi8(s, zero), bias);
+		hi = _mm_sub_epi16(_mm_unpackhi_epi8(s, zero), bias);
+		lo = MIX_DIV16_SSE2(_mm_mullo_epi16(lo, vol));
+		hi = MIX_DIV16_SSE2(_mm_mullo_epi16(hi, vol));
+		/* The same clipping as the mix8 table */
+		lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(d, zero));
+		hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(d, zero));
+		lo = _mm_min_epi16(_mm_max_epi16(lo, zero), top);
+		hi = _mm_min_epi16(_mm_max_epi16(hi, zero), top);
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_packus_epi16(lo, hi));
 	}
-	/* Mix the user-level audio format */
+	return(i);
+}
+
+SDL_AUDIO_TARGETING("sse2")
+static Uint32 SDL_MixAudio_SSE2_S8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	__m128i vol = _mm_set1_epi16((short)volume);
+	__m128i s, d, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i+16 <= len; i += 16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		d = _mm_loadu_si128((const __m128i *)(dst+i));
+		lo = _mm_srai_epi16(_mm_unpacklo_epi8(s, s), 8);
+		hi = _mm_srai_epi16(_mm_unpackhi_epi8(s, s), 8);
+		lo = MIX_DIV16_SSE2(_mm_mullo_epi16(lo, vol));
+		hi = MIX_DIV16_SSE2(_mm_mullo_epi16(hi, vol));
+		d = _mm_adds_epi8(d, _mm_packs_epi16(lo, hi));
+		_mm_storeu_si128((__m128i *)(dst+i), d);
+	}
+	return(i);
+}
+
+SDL_AUDIO_TARGETING("sse2")
+static Uint32 SDL_MixAudio_SSE2_S16(Uint8 *dst, const Uint8 *src, Uint32 len, int volume, int swap)
+{
+	__m128i vol = _mm_set1_epi16((short)volume);
+	__m128i s, d, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i+16 <= len; i += 16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		d = _mm_loadu_si128((const __m128i *)(dst+i));
+		if ( swap ) {
+			s = MIX_SWAP16_SSE2(s);
+			d = MIX_SWAP16_SSE2(d);
+		}
+		lo = _mm_mullo_epi16(s, vol);
+		hi = _mm_mulhi_epi16(s, vol);
+		s = _mm_packs_epi32(MIX_DIV32_SSE2(_mm_unpacklo_epi16(lo, hi)),
+		                    MIX_DIV32_SSE2(_mm_unpackhi_epi16(lo, hi)));
+		d = _mm_adds_epi16(d, s);
+		if ( swap ) {
+			d = MIX_SWAP16_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst+i), d);
+	}
+	return(i);
+}
+
+/* The AVX2 versions are the same on 256-bit vectors.  The unpacks and
+   packs work within 128-bit lanes, so they keep the samples in order. */
+SDL_AUDIO_TARGETING("avx2")
+static Uint32 SDL_MixAudio_AVX2_U8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i vol = _mm256_set1_epi16((short)volume);
+	__m256i bias = _mm256_set1_epi16(128);
+	__m256i top = _mm256_set1_epi16(0xFE);
+	__m256i s, d, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i+32 <= len; i += 32 ) {
+		s = _mm256_loadu_si256((const __m256i *)(src+i));
+		d = _mm256_loadu_si256((const __m256i *)(dst+i));
+		lo = _mm256_sub_epi16(_mm256_unpacklo_epi8(s, zero), bias);
+		hi = _mm256_sub_epi16(_mm256_unpackhi_epi8(s, zero), bias);
+		lo = MIX_DIV16_AVX2(_mm256_mullo_epi16(lo, vol));
+		hi = MIX_DIV16_AVX2(_mm256_mullo_epi16(hi, vol));
+		lo = _mm256_add_epi16(lo, _mm256_unpacklo_epi8(d, zero));
+		hi = _mm256_add_epi16(hi, _mm256_unpackhi_epi8(d, zero));
+		lo = _mm256_min_epi16(_mm256_max_epi16(lo, zero), top);
+		hi = _mm256_min_epi16(_mm256_max_epi16(hi, zero), top);
+		_mm256_storeu_si256((__m256i *)(dst+i), _mm256_packus_epi16(lo, hi));
+	}
+	return(i);
+}
+
+SDL_AUDIO_TARGETING("avx2")
+static Uint32 SDL_MixAudio_AVX2_S8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	__m256i vol = _mm256_set1_epi16((short)volume);
+	__m256i s, d, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i+32 <= len; i += 32 ) {
+		s = _mm256_loadu_si256((const __m256i *)(src+i));
+		d = _mm256_loadu_si256((const __m256i *)(dst+i));
+		lo = _mm256_srai_epi16(_mm256_unpacklo_epi8(s, s), 8);
+		hi = _mm256_srai_epi16(_mm256_unpackhi_epi8(s, s), 8);
+		lo = MIX_DIV16_AVX2(_mm256_mullo_epi16(lo, vol));
+		hi = MIX_DIV16_AVX2(_mm256_mullo_epi16(hi, vol));
+		d = _mm256_adds_epi8(d, _mm256_packs_epi16(lo, hi));
+		_mm256_storeu_si256((__m256i *)(dst+i), d);
+	}
+	return(i);
+}
+
+SDL_AUDIO_TARGETING("avx2")
+static Uint32 SDL_MixAudio_AVX2_S16(Uint8 *dst, const Uint8 *src, Uint32 len, int volume, int swap)
+{
+	__m256i vol = _mm256_set1_epi16((short)volume);
+	__m256i s, d, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i+32 <= len; i += 32 ) {
+		s = _mm256_loadu_si256((const __m256i *)(src+i));
+		d = _mm256_loadu_si256((const __m256i *)(dst+i));
+		if ( swap ) {
+			s = MIX_SWAP16_AVX2(s);
+			d = MIX_SWAP16_AVX2(d);
+		}
+		lo = _mm256_mullo_epi16(s, vol);
+		hi = _mm256_mulhi_epi16(s, vol);
+		s = _mm256_packs_epi32(MIX_DIV32_AVX2(_mm256_unpacklo_epi16(lo, hi)),
+		                       MIX_DIV32_AVX2(_mm256_unpackhi_epi16(lo, hi)));
+		d = _mm256_adds_epi16(d, s);
+		if ( swap ) {
+			d = MIX_SWAP16_AVX2(d);
+		}
+		_mm256_storeu_si256((__m256i *)(dst+i), d);
+	}
+	return(i);
+}
+
+/* Add 16-bit samples times the volume into the accumulator, using the
+   left volume for the even samples and the right one for the odd ones */
+SDL_AUDIO_TARGETING("sse2")
+static Uint32 SDL_MixAudioAccum_SSE2_S16(Sint32 *accum, const Uint8 *src, Uint32 len, int left, int right, int swap)
+{
+	__m128i vol = _mm_set_epi16((short)right, (short)left, (short)right, (short)left,
+	                            (short)right, (short)left, (short)right, (short)left);
+	__m128i s, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i+16 <= len; i += 16, accum += 8 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		if ( swap ) {
+			s = MIX_SWAP16_SSE2(s);
+		}
+		lo = _mm_mullo_epi16(s, vol);
+		hi = _mm_mulhi_epi16(s, vol);
+		_mm_storeu_si128((__m128i *)accum, _mm_add_epi32(
+		    _mm_loadu_si128((const __m128i *)accum), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128((__m128i *)(accum+4), _mm_add_epi32(
+		    _mm_loadu_si128((const __m128i *)(accum+4)), _mm_unpackhi_epi16(lo, hi)));
+	}
+	return(i);
+}
+
+SDL_AUDIO_TARGETING("avx2")
+static Uint32 SDL_MixAudioAccum_AVX2_S16(Sint32 *accum, const Uint8 *src, Uint32 len, int left, int right, int swap)
+{
+	__m256i vol = _mm256_set_epi16((short)right, (short)left, (short)right, (short)left,
+	                               (short)right, (short)left, (short)right, (short)left,
+	                               (short)right, (short)left, (short)right, (short)left,
+	                               (short)right, (short)left, (short)right, (short)left);
+	__m256i s, lo, hi, a, b;
+	Uint32 i;
+
+	for ( i = 0; i+32 <= len; i += 32, accum += 16 ) {
+		s = _mm256_loadu_si256((const __m256i *)(src+i));
+		if ( swap ) {
+			s = MIX_SWAP16_AVX2(s);
+		}
+		/* The 32-bit products, unpacked within each 128-bit half */
+		lo = _mm256_mullo_epi16(s, vol);
+		hi = _mm256_mulhi_epi16(s, vol);
+		a = _mm256_unpacklo_epi16(lo, hi);
+		b = _mm256_unpackhi_epi16(lo, hi);
+		_mm256_storeu_si256((__m256i *)accum, _mm256_add_epi32(
+		    _mm256_loadu_si256((const __m256i *)accum),
+		    _mm256_permute2x128_si256(a, b, 0x20)));
+		_mm256_storeu_si256((__m256i *)(accum+8), _mm256_add_epi32(
+		    _mm256_loadu_si256((const __m256i *)(accum+8)),
+		    _mm256_permute2x128_si256(a, b, 0x31)));
+	}
+	return(i);
+}
+
+/* Add 8-bit samples times the volume into the accumulator, flipping the
+   sign bit of unsigned samples.  The products fit in 16 bits. */
+SDL_AUDIO_TARGETING("sse2")
+static Uint32 SDL_MixAudioAccum_SSE2_8(Sint32 *accum, const Uint8 *src, Uint32 len, int left, int right, int sign)
+{
+	__m128i vol = _mm_set_epi16((short)right, (short)left, (short)right, (short)left,
+	                            (short)right, (short)left, (short)right, (short)left);
+	__m128i flip = _mm_set1_epi8((char)sign);
+	__m128i s, lo, hi;
+	Uint32 i;
+
+	for ( i = 0; i+16 <= len; i += 16, accum += 16 ) {
+		s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src+i)), flip);
+		lo = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpacklo_epi8(s, s), 8), vol);
+		hi = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpackhi_epi8(s, s), 8), vol);
+		_mm_storeu_si128((__m128i *)accum, _mm_add_epi32(
+		    _mm_loadu_si128((const __m128i *)accum),
+		    _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)));
+		_mm_storeu_si128((__m128i *)(accum+4), _mm_add_epi32(
+		    _mm_loadu_si128((const __m128i *)(accum+4)),
+		    _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)));
+		_mm_storeu_si128((__m128i *)(accum+8), _mm_add_epi32(
+		    _mm_loadu_si128((const __m128i *)(accum+8)),
+		    _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)));
+		_mm_storeu_si128((__m128i *)(accum+12), _mm_add_epi32(
+		    _mm_loadu_si128((const __m128i *)(accum+12)),
+		    _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)));
+	}
+	return(i);
+}
+
+SDL_AUDIO_TARGETING("avx2")
+static Uint32 SDL_MixAudioAccum_AVX2_8(Sint32 *accum, const Uint8 *src, Uint32 len, int left, int right, int sign)
+{
+	__m256i vol = _mm256_set_epi16((short)right, (short)left, (short)right, (short)left,
+	                               (short)right, (short)left, (short)right, (short)left,
+	                               (short)right, (short)left, (short)right, (short)left,
+	                               (short)right, (short)left, (short)right, (short)left);
+	__m128i flip = _mm_set1_epi8((char)sign);
+	__m256i p;
+	Uint32 i;
+
+	for ( i = 0; i+16 <= len; i += 16, accum += 16 ) {
+		p = _mm256_mullo_epi16(_mm256_cvtepi8_epi16(_mm_xor_si128(
+		        _mm_loadu_si128((const __m128i *)(src+i)), flip)), vol);
+		_mm256_storeu_si256((__m256i *)accum, _mm256_add_epi32(
+		    _mm256_loadu_si256((const __m256i *)accum),
+		    _mm256_cvtepi16_epi32(_mm256_castsi256_si128(p))));
+		_mm256_storeu_si256((__m256i *)(accum+8), _mm256_add_epi32(
+		    _mm256_loadu_si256((const __m256i *)(accum+8)),
+		    _mm256_cvtepi16_epi32(_mm256_extracti128_si256(p, 1))));
+	}
+	return(i);
+}
+
+/* Clip the accumulator to 16-bit samples */
+SDL_AUDIO_TARGETING("sse2")
+static Uint32 SDL_MixAudioClamp_SSE2_S16(Uint8 *dst, const Sint32 *accum, Uint32 len, int swap)
+{
+	__m128i lo, hi, d;
+	Uint32 i;
+
+	for ( i = 0; i+16 <= len; i += 16, accum += 8 ) {
+		lo = _mm_loadu_si128((const __m128i *)accum);
+		hi = _mm_loadu_si128((const __m128i *)(accum+4));
+		d = _mm_packs_epi32(MIX_DIV32_SSE2(lo), MIX_DIV32_SSE2(hi));
+		if ( swap ) {
+			d = MIX_SWAP16_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst+i), d);
+	}
+	return(i);
+}
+
+SDL_AUDIO_TARGETING("avx2")
+static Uint32 SDL_MixAudioClamp_AVX2_S16(Uint8 *dst, const Sint32 *accum, Uint32 len, int swap)
+{
+	__m256i lo, hi, d;
+	Uint32 i;
+
+	for ( i = 0; i+32 <= len; i += 32, accum += 16 ) {
+		lo = _mm256_loadu_si256((const __m256i *)accum);
+		hi = _mm256_loadu_si256((const __m256i *)(accum+8));
+		d = _mm256_packs_epi32(MIX_DIV32_AVX2(lo), MIX_DIV32_AVX2(hi));
+		/* Put the 64-bit quarters the pack interleaved back in order */
+		d = _mm256_permute4x64_epi64(d, 0xD8);
+		if ( swap ) {
+			d = MIX_SWAP16_AVX2(d);
+		}
+		_mm256_storeu_si256((__m256i *)(dst+i), d);
+	}
+	return(i);
+}
+#endif /* SDL_SSE_AUDIO */
+
+#if SDL_SSE_AUDIO
+/* Mix as much as the vector units can, returning the bytes done */
+static Uint32 SDL_MixAudioSIMD(Uint16 format, Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	if ( volume > SDL_MIX_MAXVOLUME ) {
+		/* The C loops wrap the scaled samples around, so leave it
+		   to them */
+		return(0);
+	}
+	switch (format) {
+		case AUDIO_U8:
+			if ( SDL_HasAVX2() ) {
+				return SDL_MixAudio_AVX2_U8(dst, src, len, volume);
+			}
+			if ( SDL_HasSSE2() ) {
+				return SDL_MixAudio_SSE2_U8(dst, src, len, volume);
+			}
+			break;
+		case AUDIO_S8:
+			if ( SDL_HasAVX2() ) {
+				return SDL_MixAudio_AVX2_S8(dst, src, len, volume);
+			}
+			if ( SDL_HasSSE2() ) {
+				return SDL_MixAudio_SSE2_S8(dst, src, len, volume);
+			}
+			break;
+		case AUDIO_S16LSB:
+		case AUDIO_S16MSB:
+			if ( SDL_HasAVX2() ) {
+				return SDL_MixAudio_AVX2_S16(dst, src, len, volume,
+				                             format != AUDIO_S16SYS);
+			}
+			if ( SDL_HasSSE2() ) {
+				return SDL_MixAudio_SSE2_S16(dst, src, len, volume,
+				                             format != AUDIO_S16SYS);
+			}
+			break;
+	}
+	return(0);
+}
+#endif
+
+/* The format the application mixes in */
+static Uint16 SDL_MixFormat(void)
+{
 	if ( current_audio ) {
 		if ( current_audio->convert.needed ) {
-			format = current_audio->convert.src_format;
+			return current_audio->convert.src_format;
 		} else {
-			format = current_audio->spec.format;
+			return current_audio->spec.format;
 		}
-	} else {
-  		/* HACK HACK HACK */
-		format = AUDIO_S16;
 	}
+	/* HACK HACK HACK */
+	return AUDIO_S16;
+}
+
+void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	Uint16 format;
+#if SDL_SSE_AUDIO
+	Uint32 done;
+#endif
+
+	if ( volume == 0 ) {
+		return;
+	}
+	/* Mix the user-level audio format */
+	format = SDL_MixFormat();
+#if SDL_SSE_AUDIO
+	/* Do the whole vectors first, and the rest below */
+	done = SDL_MixAudioSIMD(format, dst, src, len, volume);
+	dst += done;
+	src += done;
+	len -= done;
+#endif
 	switch (format) {
 
 		case AUDIO_U8: {
@@ -262,3 +648,244 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 	}
 }
 
+/* Add 'len' bytes of audio times the volume of each channel into the
+   accumulator, returning -1 if the format can't be mixed */
+static int SDL_MixAccum(Uint16 format, Sint32 *accum, const Uint8 *src, Uint32 len, const int *volume, int channels)
+{
+	Uint32 i, j;
+	int c;
+#if SDL_SSE_AUDIO
+	int left = volume[0];
+	int right = volume[channels > 1];
+	int vector;
+
+	/* The vectors alternate between two volumes */
+	for ( c = 0; c < channels; ++c ) {
+		if ( volume[c] != volume[c&(channels>1)] ||
+		     volume[c] > SDL_MIX_MAXVOLUME ) {
+			break;
+		}
+	}
+	vector = (c == channels);
+#endif
+
+	i = 0;
+	switch (format) {
+		case AUDIO_U8:
+		case AUDIO_S8:
+#if SDL_SSE_AUDIO
+			if ( vector ) {
+				int sign = (format == AUDIO_U8) ? 0x80 : 0;
+
+				if ( SDL_HasAVX2() ) {
+					i = SDL_MixAudioAccum_AVX2_8(accum, src, len, left, right, sign);
+				} else if ( SDL_HasSSE2() ) {
+					i = SDL_MixAudioAccum_SSE2_8(accum, src, len, left, right, sign);
+				}
+			}
+#endif
+			/* Start each channel on its first sample after the
+			   vectors, and do one channel at a time */
+			for ( c = 0; c < channels; ++c ) {
+				j = i + (c + channels - i % channels) % channels;
+				if ( format == AUDIO_U8 ) {
+					for ( ; j < len; j += channels ) {
+						accum[j] += (src[j]-128)*volume[c];
+					}
+				} else {
+					for ( ; j < len; j += channels ) {
+						accum[j] += ((Sint8)src[j])*volume[c];
+					}
+				}
+			}
+			break;
+
+		case AUDIO_S16LSB:
+		case AUDIO_S16MSB:
+#if SDL_SSE_AUDIO
+			if ( vector ) {
+				if ( SDL_HasAVX2() ) {
+					i = SDL_MixAudioAccum_AVX2_S16(accum, src, len, left, right,
+					                               format != AUDIO_S16SYS);
+				} else if ( SDL_HasSSE2() ) {
+					i = SDL_MixAudioAccum_SSE2_S16(accum, src, len, left, right,
+					                               format != AUDIO_S16SYS);
+				}
+			}
+#endif
+			for ( c = 0; c < channels; ++c ) {
+				j = i + 2*((c + channels - (i/2) % channels) % channels);
+				if ( format == AUDIO_S16LSB ) {
+					for ( ; j+1 < len; j += 2*channels ) {
+						accum[j/2] += ((Sint16)((src[j+1]<<8)|src[j]))*volume[c];
+					}
+				} else {
+					for ( ; j+1 < len; j += 2*channels ) {
+						accum[j/2] += ((Sint16)((src[j]<<8)|src[j+1]))*volume[c];
+					}
+				}
+			}
+			break;
+
+		default:
+			return(-1);
+	}
+	return(0);
+}
+
+/* Clip 'len' bytes of audio from the accumulator, returning -1 if the
+   format can't be mixed */
+static int SDL_MixClamp(Uint16 format, Uint8 *dst, const Sint32 *accum, Uint32 len)
+{
+	Uint32 i;
+	Sint32 sample;
+
+	switch (format) {
+		case AUDIO_U8:
+			for ( i = 0; i < len; ++i ) {
+				/* Pinned at 0xFE like the mix8 table */
+				sample = accum[i]/SDL_MIX_MAXVOLUME + 128;
+				if ( sample > 0xFE ) {
+					sample = 0xFE;
+				} else if ( sample < 0 ) {
+					sample = 0;
+				}
+				dst[i] = (Uint8)sample;
+			}
+			break;
+
+		case AUDIO_S8:
+			for ( i = 0; i < len; ++i ) {
+				sample = accum[i]/SDL_MIX_MAXVOLUME;
+				if ( sample > 127 ) {
+					sample = 127;
+				} else if ( sample < -128 ) {
+					sample = -128;
+				}
+				dst[i] = (Uint8)sample;
+			}
+			break;
+
+		case AUDIO_S16LSB:
+		case AUDIO_S16MSB:
+			i = 0;
+#if SDL_SSE_AUDIO
+			if ( SDL_HasAVX2() ) {
+				i = SDL_MixAudioClamp_AVX2_S16(dst, accum, len,
+				                               format != AUDIO_S16SYS);
+			} else if ( SDL_HasSSE2() ) {
+				i = SDL_MixAudioClamp_SSE2_S16(dst, accum, len,
+				                               format != AUDIO_S16SYS);
+			}
+#endif
+			for ( ; i+1 < len; i += 2 ) {
+				sample = accum[i/2]/SDL_MIX_MAXVOLUME;
+				if ( sample > 32767 ) {
+					sample = 32767;
+				} else if ( sample < -32768 ) {
+					sample = -32768;
+				}
+				if ( format == AUDIO_S16LSB ) {
+					dst[i] = sample&0xFF;
+					dst[i+1] = (sample>>8)&0xFF;
+				} else {
+					dst[i] = (sample>>8)&0xFF;
+					dst[i+1] = sample&0xFF;
+				}
+			}
+			break;
+
+		default:
+			return(-1);
+	}
+	return(0);
+}
+
+void SDL_MixAudioAccum (Sint32 *accum, const Uint8 *src, Uint32 len, int volume)
+{
+	if ( volume == 0 ) {
+		return;
+	}
+	if ( SDL_MixAccum(SDL_MixFormat(), accum, src, len, &volume, 1) < 0 ) {
+		SDL_SetError("SDL_MixAudioAccum(): unknown audio format");
+	}
+}
+
+void SDL_MixAudioClamp (Uint8 *dst, const Sint32 *accum, Uint32 len)
+{
+	if ( SDL_MixClamp(SDL_MixFormat(), dst, accum, len) < 0 ) {
+		SDL_SetError("SDL_MixAudioClamp(): unknown audio format");
+	}
+}
+
+/* The number of samples mixed at a time, a multiple of every channel
+   count and of the vector sizes, small enough to stay in the cache */
+#define MIX_VOICE_BLOCK	768
+
+void SDL_MixAudioVoices (Uint8 *dst, const SDL_AudioVoice *voices, int numvoices, Uint32 len)
+{
+	Sint32 accum[MIX_VOICE_BLOCK];
+	int volume[6];
+	Uint16 format;
+	int channels;
+	int full = SDL_MIX_MAXVOLUME;
+	Uint32 block, pos, n;
+	int i;
+
+	if ( numvoices <= 0 ) {
+		return;
+	}
+	format = SDL_MixFormat();
+	channels = current_audio ? current_audio->mix_channels : 2;
+	if ( (channels < 1) || (channels > 6) ) {
+		channels = 2;
+	}
+	block = MIX_VOICE_BLOCK * ((format & 0xFF) / 8);
+
+	/* Mix the voices into the accumulator a block at a time, so the
+	   destination is only read and clipped once */
+	for ( pos = 0; pos < len; pos += block ) {
+		n = len - pos;
+		if ( n > block ) {
+			n = block;
+		}
+		SDL_memset(accum, 0, sizeof(accum));
+		if ( SDL_MixAccum(format, accum, dst+pos, n, &full, 1) < 0 ) {
+			SDL_SetError("SDL_MixAudioVoices(): unknown audio format");
+			return;
+		}
+		for ( i = 0; i < numvoices; ++i ) {
+			const SDL_AudioVoice *voice = &voices[i];
+			int left = voice->left_volume;
+			int right = voice->right_volume;
+			Uint32 vlen;
+
+			if ( (voice->src == NULL) || (voice->len <= pos) ||
+			     ((left == 0) && (right == 0)) ) {
+				continue;
+			}
+			vlen = voice->len - pos;
+			if ( vlen > n ) {
+				vlen = n;
+			}
+			switch (channels) {
+				case 1:
+					volume[0] = (left + right) / 2;
+					break;
+				case 6:
+					/* Front, center and LFE, rear */
+					volume[0] = volume[4] = left;
+					volume[1] = volume[5] = right;
+					volume[2] = volume[3] = (left + right) / 2;
+					break;
+				default:
+					volume[0] = volume[2] = left;
+					volume[1] = volume[3] = right;
+					break;
+			}
+			SDL_MixAccum(format, accum, voice->src+pos, vlen,
+			             volume, channels);
+		}
+		SDL_MixClamp(format, dst+pos, accum, n);
+	}
+}
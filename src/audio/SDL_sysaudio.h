@@ -70,6 +70,12 @@ struct SDL_AudioDevice {
 	/* An audio conversion block for audio format emulation */
 	SDL_AudioCVT convert;
 
+	/* A conversion stream, when the rate changes on the audio thread */
+	SDL_AudioStream *convert_stream;
+
+	/* The number of channels the application mixes in */
+	Uint8 mix_channels;
+
 	/* Current state flags */
 	int enabled;
 	int paused;
@@ -79,6 +79,7 @@
 #define CPU_HAS_ALTIVEC	0x00000100
 #define CPU_HAS_ARM_SIMD 0x00000200
 #define CPU_HAS_NEON     0x00000400
+#define CPU_HAS_AVX2     0x00000800
 
 #if SDL_ALTIVEC_BLITTERS && HAVE_SETJMP && !__MACOSX__ && !__OpenBSD__
 /* This is the brute force way of detecting instruction sets...
@@ -395,6 +396,107 @@ static __inline__ int CPU_haveSSE2(void)
 	return 0;
 }
 
+/* AVX2 detection
+ * Not public - for internal x86 blitters' and mixers' use only
+ */
+static __inline__ void CPU_getCPUIDRegs(int func, int subfunc, int regs[4])
+{
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#if defined(__GNUC__) && defined(__i386__)
+	__asm__ (
+"        pushl   %%ebx                                                 \n"
+"        cpuid                                                         \n"
+"        movl    %%ebx,%%esi                                           \n"
+"        popl    %%ebx                                                 \n"
+	: "=a" (regs[0]), "=S" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+	: "a" (func), "c" (subfunc)
+	);
+#elif defined(__GNUC__) && defined(__x86_64__)
+	__asm__ (
+"        movq    %%rbx,%%rsi         # Keep clear of the red zone      \n"
+"        cpuid                                                         \n"
+"        xchgq   %%rbx,%%rsi                                           \n"
+	: "=a" (regs[0]), "=S" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+	: "a" (func), "c" (subfunc)
+	);
+#endif
+}
+
+static __inline__ int CPU_haveAVX2(void)
+{
+	int avx2 = 0;
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	if ( CPU_haveCPUID() ) {
+		int regs[4];
+		unsigned int xcr0;
+
+		CPU_getCPUIDRegs(0, 0, regs);
+		if ( regs[0] < 7 ) {
+			return 0;
+		}
+		/* The OS has to save the YMM registers (OSXSAVE + XCR0) */
+		CPU_getCPUIDRegs(1, 0, regs);
+		if ( (regs[2] & 0x18000000) != 0x18000000 ) {
+			return 0;
+		}
+		__asm__ (".byte 0x0f, 0x01, 0xd0" : "=a" (xcr0) : "c" (0) : "%edx");
+		if ( (xcr0 & 0x06) != 0x06 ) {
+			return 0;
+		}
+		CPU_getCPUIDRegs(7, 0, regs);
+		avx2 = (regs[1] & 0x00000020);
+	}
+#endif
+	return avx2;
+}
+
+/* Size of the last level cache, in bytes, or 0 if unknown
+ * Not public - for internal x86 blitters' use only
+ */
+static int CPU_getLastCacheSize(void)
+{
+	int size = 0;
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	if ( CPU_haveCPUID() ) {
+		int regs[4];
+		int maxfunc, i;
+
+		CPU_getCPUIDRegs(0, 0, regs);
+		maxfunc = regs[0];
+		if ( maxfunc >= 4 ) {
+			/* Deterministic cache parameters, one subleaf per cache */
+			for ( i = 0; i < 16; ++i ) {
+				int ways, partitions, linesize, sets;
+
+				CPU_getCPUIDRegs(4, i, regs);
+				if ( (regs[0] & 0x1F) == 0 ) {
+					break;
+				}
+				ways = ((regs[1] >> 22) & 0x3FF) + 1;
+				partitions = ((regs[1] >> 12) & 0x3FF) + 1;
+				linesize = (regs[1] & 0xFFF) + 1;
+				sets = regs[2] + 1;
+				if ( ways * partitions * linesize * sets > size ) {
+					size = ways * partitions * linesize * sets;
+				}
+			}
+		}
+		if ( size == 0 ) {
+			/* AMD reports the L2 and L3 sizes in the extended leaves */
+			CPU_getCPUIDRegs(0x80000000, 0, regs);
+			if ( (unsigned int)regs[0] >= 0x80000006 ) {
+				CPU_getCPUIDRegs(0x80000006, 0, regs);
+				size = ((unsigned int)regs[2] >> 16) * 1024;
+				if ( ((unsigned int)regs[3] >> 18) * 512 * 1024 > (unsigned int)size ) {
+					size = ((unsigned int)regs[3] >> 18) * 512 * 1024;
+				}
+			}
+		}
+	}
+#endif
+	return size;
+}
+
 static __inline__ int CPU_haveAltiVec(void)
 {
 	volatile int altivec = 0;
@@ -606,6 +708,9 @@ static Uint32 SDL_GetCPUFeatures(void)
 		if ( CPU_haveNEON() ) {
 			SDL_CPUFeatures |= CPU_HAS_NEON;
 		}
+		if ( CPU_haveAVX2() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX2;
+		}
 	}
 	return SDL_CPUFeatures;
 }
@@ -690,6 +795,24 @@ SDL_bool SDL_HasNEON(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasAVX2(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX2 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+static int SDL_CPUCacheSize = -1;
+
+int SDL_GetCPUCacheSize(void)
+{
+	if ( SDL_CPUCacheSize < 0 ) {
+		SDL_CPUCacheSize = CPU_getLastCacheSize();
+	}
+	return SDL_CPUCacheSize;
+}
+
 #ifdef TEST_MAIN
 
 #include <stdio.h>
@@ -706,6 +829,8 @@ int main()
 	printf("AltiVec: %d\n", SDL_HasAltiVec());
 	printf("ARM SIMD: %d\n", SDL_HasARMSIMD());
 	printf("NEON: %d\n", SDL_HasNEON());
+	printf("AVX2: %d\n", SDL_HasAVX2());
+	printf("Cache size: %d\n", SDL_GetCPUCacheSize());
 	return 0;
 }
 
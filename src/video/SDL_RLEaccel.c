@@ -51,7 +51,9 @@
  *
  * Encoding of colorkeyed surfaces:
  *
- *   Encoded pixels always have the same format as the target surface.
+ *   Encoded pixels have the format of the source surface. They are copied
+ *   as is to targets of the same format, and converted a run at a time by
+ *   the map's blitter for others.
  *   <skip> and <run> are unsigned 8 bit integers, except for 32 bit depth
  *   where they are 16 bit. This makes the pixel data aligned at all times.
  *   Segments never wrap around from one scan line to the next.
@@ -87,8 +89,10 @@
  */
 
 #include "SDL_video.h"
+#include "SDL_cpuinfo.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
+#include "SDL_pixels_c.h"
 #include "SDL_RLEaccel_c.h"
 
 /* Force MMX to 0; this blows up on almost every major compiler now. --ryan. */
@@ -98,7 +102,6 @@
 
 #ifdef MMX_ASMBLIT
 #include "mmx.h"
-#include "SDL_cpuinfo.h"
 #endif
 
 #ifndef MAX
@@ -836,6 +839,132 @@ static void RLEClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 }
 
 
+/*
+ * Colorkeyed RLE surfaces are blitted to destinations of other formats by
+ * converting their runs with the map's blitter.  Runs are often short,
+ * so rather than calling the blitter on each, they are gathered with the
+ * destination pixels under them into batches, converted (or blended) in
+ * one call per batch and then copied back into place.  Long runs are
+ * worth a call of their own.
+ */
+#define RLE_CONVERT_BATCH 512
+#define RLE_CONVERT_DIRECT 64
+
+typedef struct {
+    SDL_loblit convert;
+    SDL_BlitInfo info;
+    int sbpp, dbpp;
+    int n;			/* pixels in the batch */
+    int pieces;
+    Uint8 *piece_dst[RLE_CONVERT_BATCH];
+    int piece_len[RLE_CONVERT_BATCH];
+    Uint8 sbuf[RLE_CONVERT_BATCH * 4];
+    Uint8 dbuf[RLE_CONVERT_BATCH * 4];
+} RLEConvertBatch;
+
+static void RLEConvertFlush(RLEConvertBatch *b)
+{
+    Uint8 *d = b->dbuf;
+    int i;
+
+    if(!b->n)
+	return;
+    b->info.s_width = b->info.d_width = b->n;
+    b->convert(&b->info);
+    for(i = 0; i < b->pieces; i++) {
+	SDL_memcpy(b->piece_dst[i], d, b->piece_len[i] * b->dbpp);
+	d += b->piece_len[i] * b->dbpp;
+    }
+    b->n = b->pieces = 0;
+}
+
+static void RLEConvertRun(RLEConvertBatch *b, Uint8 *src, Uint8 *dst, int len)
+{
+    if(len >= RLE_CONVERT_DIRECT) {
+	SDL_BlitInfo info = b->info;
+	info.s_pixels = src;
+	info.d_pixels = dst;
+	info.s_width = info.d_width = len;
+	b->convert(&info);
+	return;
+    }
+    while(len) {
+	int n = MIN(len, RLE_CONVERT_BATCH - b->n);
+	SDL_memcpy(b->sbuf + b->n * b->sbpp, src, n * b->sbpp);
+	SDL_memcpy(b->dbuf + b->n * b->dbpp, dst, n * b->dbpp);
+	b->piece_dst[b->pieces] = dst;
+	b->piece_len[b->pieces] = n;
+	b->pieces++;
+	b->n += n;
+	if(b->n == RLE_CONVERT_BATCH)
+	    RLEConvertFlush(b);
+	src += n * b->sbpp;
+	dst += n * b->dbpp;
+	len -= n;
+    }
+}
+
+/* top clipping has already been taken care of */
+static void RLEConvertBlit(SDL_Surface *src, Uint8 *srcbuf, SDL_Surface *dst,
+			   Uint8 *dstbuf, SDL_Rect *srcrect)
+{
+    RLEConvertBatch batch;
+    int sbpp = src->format->BytesPerPixel;
+    int dbpp = dst->format->BytesPerPixel;
+    int w = src->w;
+    int linecount = srcrect->h;
+    int left = srcrect->x;
+    int right = left + srcrect->w;
+    int ofs = 0;
+
+    batch.convert = src->map->sw_data->blit;
+    batch.info.s_pixels = batch.sbuf;
+    batch.info.s_height = 1;
+    batch.info.s_skip = 0;
+    batch.info.d_pixels = batch.dbuf;
+    batch.info.d_height = 1;
+    batch.info.d_skip = 0;
+    batch.info.aux_data = NULL;
+    batch.info.src = src->format;
+    batch.info.table = src->map->table;
+    batch.info.dst = dst->format;
+    batch.sbpp = sbpp;
+    batch.dbpp = dbpp;
+    batch.n = batch.pieces = 0;
+
+    dstbuf -= left * dbpp;
+    for(;;) {
+	int run, start, end;
+	if(sbpp == 4) {
+	    ofs += ((Uint16 *)srcbuf)[0];
+	    run = ((Uint16 *)srcbuf)[1];
+	    srcbuf += 4;
+	} else {
+	    ofs += srcbuf[0];
+	    run = srcbuf[1];
+	    srcbuf += 2;
+	}
+	if(run) {
+	    /* clip to left and right borders */
+	    start = MAX(ofs, left);
+	    end = MIN(ofs + run, right);
+	    if(start < end)
+		RLEConvertRun(&batch, srcbuf + (start - ofs) * sbpp,
+			      dstbuf + start * dbpp, end - start);
+	    srcbuf += run * sbpp;
+	    ofs += run;
+	} else if(!ofs)
+	    break;
+	if(ofs == w) {
+	    ofs = 0;
+	    dstbuf += dst->pitch;
+	    if(!--linecount)
+		break;
+	}
+    }
+    RLEConvertFlush(&batch);
+}
+
 /* blit a colorkeyed RLE surface */
 int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		SDL_Surface *dst, SDL_Rect *dstrect)
@@ -857,7 +986,7 @@ int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	x = dstrect->x;
 	y = dstrect->y;
 	dstbuf = (Uint8 *)dst->pixels
-	         + y * dst->pitch + x * src->format->BytesPerPixel;
+	         + y * dst->pitch + x * dst->format->BytesPerPixel;
 	srcbuf = (Uint8 *)src->map->sw_data->aux_data;
 
 	{
@@ -898,8 +1027,11 @@ int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 
 	alpha = (src->flags & SDL_SRCALPHA) == SDL_SRCALPHA
 	        ? src->format->alpha : 255;
-	/* if left or right edge clipping needed, call clip blit */
-	if ( srcrect->x || srcrect->w != src->w ) {
+	/* the surface decodes itself with the copying blitters */
+	if ( !src->map->identity && dst != src ) {
+	    RLEConvertBlit(src, srcbuf, dst, dstbuf, srcrect);
+	} else if ( srcrect->x || srcrect->w != src->w ) {
+	    /* if left or right edge clipping needed, call clip blit */
 	    RLEClipBlit(w, srcbuf, dst, dstbuf, srcrect, alpha);
 	} else {
 	    SDL_PixelFormat *fmt = src->format;
@@ -1396,14 +1528,311 @@ static int uncopy_32(Uint32 *dst, void *src, int n,
 #define ISTRANSL(pixel, fmt)	\
     ((unsigned)((((pixel) & fmt->Amask) >> fmt->Ashift) - 1U) < 254U)
 
+/* the vector extension the run scanners below may use: 0 (none), 1 (SSE2)
+   or 2 (AVX2) */
+static int RLESimdLevel(void)
+{
+#if SDL_AVX2_BLITTERS
+    if(SDL_HasAVX2())
+	return 2;
+#endif
+#if SDL_SSE2_BLITTERS
+    if(SDL_HasSSE2())
+	return 1;
+#endif
+    return 0;
+}
+
+/*
+ * The run scanners return the end of the run of pixels from x (up to w)
+ * whose test (opaque, translucent or colorkey) is 'want'.  The SSE2 and
+ * AVX2 versions test 4 to 32 pixels at a time and return at the first
+ * pixel failing the test, or where fewer pixels than a vector remain,
+ * leaving the scalar loop to finish the row.
+ */
+#if SDL_SSE2_BLITTERS
+static int SDL_TARGETING("sse2")
+RLEAlphaRunSSE2(const Uint32 *src, int x, int w, const SDL_PixelFormat *sf,
+		int transl, int want)
+{
+    const __m128i amask = _mm_set1_epi32((int)sf->Amask);
+    const __m128i ashift = _mm_cvtsi32_si128(sf->Ashift);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi32(255);
+    const int stop = want ? 0xf : 0;
+
+    for(; x + 4 <= w; x += 4) {
+	__m128i a = _mm_loadu_si128((const __m128i *)(src + x));
+	int bits;
+	a = _mm_srl_epi32(_mm_and_si128(a, amask), ashift);
+	if(transl)
+	    a = _mm_and_si128(_mm_cmpgt_epi32(a, zero),
+			      _mm_cmplt_epi32(a, c255));
+	else
+	    a = _mm_cmpeq_epi32(a, c255);
+	bits = _mm_movemask_ps(_mm_castsi128_ps(a)) ^ stop;
+	if(bits)
+	    return x + __builtin_ctz(bits);
+    }
+    return x;
+}
+#endif /* SDL_SSE2_BLITTERS */
+
+#if SDL_AVX2_BLITTERS
+static int SDL_TARGETING("avx2")
+RLEAlphaRunAVX2(const Uint32 *src, int x, int w, const SDL_PixelFormat *sf,
+		int transl, int want)
+{
+    const __m256i amask = _mm256_set1_epi32((int)sf->Amask);
+    const __m128i ashift = _mm_cvtsi32_si128(sf->Ashift);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi32(255);
+    const int stop = want ? 0xff : 0;
+
+    for(; x + 8 <= w; x += 8) {
+	__m256i a = _mm256_loadu_si256((const __m256i *)(src + x));
+	int bits;
+	a = _mm256_srl_epi32(_mm256_and_si256(a, amask), ashift);
+	if(transl)
+	    a = _mm256_andnot_si256(_mm256_cmpeq_epi32(a, c255),
+				    _mm256_cmpgt_epi32(a, zero));
+	else
+	    a = _mm256_cmpeq_epi32(a, c255);
+	bits = _mm256_movemask_ps(_mm256_castsi256_ps(a)) ^ stop;
+	if(bits)
+	    return x + __builtin_ctz(bits);
+    }
+    return x;
+}
+#endif /* SDL_AVX2_BLITTERS */
+
+static int RLEAlphaRun(const Uint32 *src, int x, int w,
+		       const SDL_PixelFormat *sf, int transl, int want,
+		       int simd)
+{
+#if SDL_AVX2_BLITTERS
+    if(simd == 2)
+	x = RLEAlphaRunAVX2(src, x, w, sf, transl, want);
+#endif
+#if SDL_SSE2_BLITTERS
+    if(simd)
+	x = RLEAlphaRunSSE2(src, x, w, sf, transl, want);
+#endif
+    if(transl) {
+	while(x < w && !ISTRANSL(src[x], sf) == !want)
+	    x++;
+    } else {
+	while(x < w && !ISOPAQUE(src[x], sf) == !want)
+	    x++;
+    }
+    return x;
+}
+
+/*
+ * Large surfaces are encoded by the blit threads, each one encoding a band
+ * of rows into its own buffer, and the bands are then joined in order.
+ * A rows function encodes rows y0 to y1-1 at dst, returning the end of
+ * its output and setting *lastline to the end of the last line which
+ * isn't blank, if any.
+ */
+typedef Uint8 *(*RLERowsFunc)(const void *info, int y0, int y1,
+			      Uint8 *dst, Uint8 **lastline);
+
+typedef struct {
+    Uint8 *buf;
+    Uint8 *end;
+    Uint8 *lastline;
+} RLEBand;
+
+typedef struct {
+    RLERowsFunc rows;
+    const void *info;
+    int h;
+    int rowsize;		/* worst case size of an encoded row */
+    RLEBand *band;
+} RLEBands;
+
+static void RLEEncodeBand(void *data, int index, int count)
+{
+    RLEBands *bands = (RLEBands *)data;
+    RLEBand *band = &bands->band[index];
+    int y0 = index * bands->h / count;
+    int y1 = (index + 1) * bands->h / count;
+
+    band->buf = (Uint8 *)SDL_malloc((y1 - y0) * bands->rowsize);
+    if(band->buf)
+	band->end = bands->rows(bands->info, y0, y1,
+				band->buf, &band->lastline);
+}
+
+/* encode all the rows of the surface at dst, and return the end of the
+   last line which isn't blank, or dst if they all are */
+static Uint8 *RLEEncodeRows(SDL_Surface *surface, RLERowsFunc rows,
+			    const void *info, int rowsize, Uint8 *dst)
+{
+    RLEBands bands;
+    Uint8 *lastline = NULL;
+    int count, i;
+
+    count = SDL_BlitThreadsCount(surface->w * surface->h);
+    if(count > surface->h)
+	count = surface->h;
+    bands.band = NULL;
+    if(count > 1)
+	bands.band = (RLEBand *)SDL_calloc(count, sizeof(RLEBand));
+    if(bands.band) {
+	bands.rows = rows;
+	bands.info = info;
+	bands.h = surface->h;
+	bands.rowsize = rowsize;
+	SDL_BlitThreadsRun(RLEEncodeBand, &bands, count);
+
+	/* join the bands, unless one ran out of memory */
+	for(i = 0; i < count && bands.band[i].buf; i++)
+	    ;
+	if(i == count) {
+	    lastline = dst;
+	    for(i = 0; i < count; i++) {
+		RLEBand *band = &bands.band[i];
+		SDL_memcpy(dst, band->buf, band->end - band->buf);
+		if(band->lastline)
+		    lastline = dst + (band->lastline - band->buf);
+		dst += band->end - band->buf;
+	    }
+	}
+	for(i = 0; i < count; i++)
+	    SDL_free(bands.band[i].buf);
+	SDL_free(bands.band);
+	if(lastline)
+	    return lastline;
+    }
+
+    rows(info, 0, surface->h, dst, &lastline);
+    return lastline ? lastline : dst;
+}
+
+/* the parameters of an alpha encoding, shared by the bands */
+typedef struct {
+    SDL_Surface *surface;
+    SDL_PixelFormat *df;
+    int max_opaque_run;
+    int (*copy_opaque)(void *, Uint32 *, int,
+		       SDL_PixelFormat *, SDL_PixelFormat *);
+    int (*copy_transl)(void *, Uint32 *, int,
+		       SDL_PixelFormat *, SDL_PixelFormat *);
+    int simd;
+} RLEAlphaInfo;
+
+/* opaque counts are 8 or 16 bits, depending on target depth */
+#define ADD_OPAQUE_COUNTS(n, m)			\
+	if(df->BytesPerPixel == 4) {		\
+	    ((Uint16 *)dst)[0] = n;		\
+	    ((Uint16 *)dst)[1] = m;		\
+	    dst += 4;				\
+	} else {				\
+	    dst[0] = n;				\
+	    dst[1] = m;				\
+	    dst += 2;				\
+	}
+
+/* translucent counts are always 16 bit */
+#define ADD_TRANSL_COUNTS(n, m)		\
+	(((Uint16 *)dst)[0] = n, ((Uint16 *)dst)[1] = m, dst += 4)
+
+static Uint8 *RLEAlphaRows(const void *data, int y0, int y1,
+			   Uint8 *dst, Uint8 **lastline)
+{
+    const RLEAlphaInfo *info = (const RLEAlphaInfo *)data;
+    SDL_Surface *surface = info->surface;
+    SDL_PixelFormat *sf = surface->format;
+    SDL_PixelFormat *df = info->df;
+    int max_opaque_run = info->max_opaque_run;
+    int max_transl_run = 65535;
+    int simd = info->simd;
+    int x, y;
+    int w = surface->w;
+    Uint32 *src = (Uint32 *)((Uint8 *)surface->pixels + y0 * surface->pitch);
+
+    for(y = y0; y < y1; y++) {
+	int runstart, skipstart;
+	int blankline = 0;
+	/* First encode all opaque pixels of a scan line */
+	x = 0;
+	do {
+	    int run, skip, len;
+	    skipstart = x;
+	    x = RLEAlphaRun(src, x, w, sf, 0, 0, simd);
+	    runstart = x;
+	    x = RLEAlphaRun(src, x, w, sf, 0, 1, simd);
+	    skip = runstart - skipstart;
+	    if(skip == w)
+		blankline = 1;
+	    run = x - runstart;
+	    while(skip > max_opaque_run) {
+		ADD_OPAQUE_COUNTS(max_opaque_run, 0);
+		skip -= max_opaque_run;
+	    }
+	    len = MIN(run, max_opaque_run);
+	    ADD_OPAQUE_COUNTS(skip, len);
+	    dst += info->copy_opaque(dst, src + runstart, len, sf, df);
+	    runstart += len;
+	    run -= len;
+	    while(run) {
+		len = MIN(run, max_opaque_run);
+		ADD_OPAQUE_COUNTS(0, len);
+		dst += info->copy_opaque(dst, src + runstart, len, sf, df);
+		runstart += len;
+		run -= len;
+	    }
+	} while(x < w);
+
+	/* Make sure the next output address is 32-bit aligned */
+	dst += (uintptr_t)dst & 2;
+
+	/* Next, encode all translucent pixels of the same scan line */
+	x = 0;
+	do {
+	    int run, skip, len;
+	    skipstart = x;
+	    x = RLEAlphaRun(src, x, w, sf, 1, 0, simd);
+	    runstart = x;
+	    x = RLEAlphaRun(src, x, w, sf, 1, 1, simd);
+	    skip = runstart - skipstart;
+	    blankline &= (skip == w);
+	    run = x - runstart;
+	    while(skip > max_transl_run) {
+		ADD_TRANSL_COUNTS(max_transl_run, 0);
+		skip -= max_transl_run;
+	    }
+	    len = MIN(run, max_transl_run);
+	    ADD_TRANSL_COUNTS(skip, len);
+	    dst += info->copy_transl(dst, src + runstart, len, sf, df);
+	    runstart += len;
+	    run -= len;
+	    while(run) {
+		len = MIN(run, max_transl_run);
+		ADD_TRANSL_COUNTS(0, len);
+		dst += info->copy_transl(dst, src + runstart, len, sf, df);
+		runstart += len;
+		run -= len;
+	    }
+	    if(!blankline)
+		*lastline = dst;
+	} while(x < w);
+
+	src += surface->pitch >> 2;
+    }
+    return dst;
+}
+
 /* convert surface to be quickly alpha-blittable onto dest, if possible */
 static int RLEAlphaSurface(SDL_Surface *surface)
 {
     SDL_Surface *dest;
     SDL_PixelFormat *df;
     int maxsize = 0;
+    int rowsize;
     int max_opaque_run;
-    int max_transl_run = 65535;
     unsigned masksum;
     Uint8 *rlebuf, *dst;
     int (*copy_opaque)(void *, Uint32 *, int,
@@ -1448,7 +1877,8 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 
 	/* worst case is alternating opaque and translucent pixels,
 	   with room for alignment padding between lines */
-	maxsize = surface->h * (2 + (4 + 2) * (surface->w + 1)) + 2;
+	rowsize = 2 + (4 + 2) * (surface->w + 1);
+	maxsize = surface->h * rowsize + 2;
 	break;
     case 4:
 	if(masksum != 0x00ffffff)
@@ -1458,7 +1888,8 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	max_opaque_run = 255;	/* runs stored as short ints */
 
 	/* worst case is alternating opaque and translucent pixels */
-	maxsize = surface->h * 2 * 4 * (surface->w + 1) + 4;
+	rowsize = 2 * 4 * (surface->w + 1);
+	maxsize = surface->h * rowsize + 4;
 	break;
     default:
 	return -1;		/* anything else unsupported right now */
@@ -1490,102 +1921,16 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 
     /* Do the actual encoding */
     {
-	int x, y;
-	int h = surface->h, w = surface->w;
-	SDL_PixelFormat *sf = surface->format;
-	Uint32 *src = (Uint32 *)surface->pixels;
-	Uint8 *lastline = dst;	/* end of last non-blank line */
-
-	/* opaque counts are 8 or 16 bits, depending on target depth */
-#define ADD_OPAQUE_COUNTS(n, m)			\
-	if(df->BytesPerPixel == 4) {		\
-	    ((Uint16 *)dst)[0] = n;		\
-	    ((Uint16 *)dst)[1] = m;		\
-	    dst += 4;				\
-	} else {				\
-	    dst[0] = n;				\
-	    dst[1] = m;				\
-	    dst += 2;				\
-	}
-
-	/* translucent counts are always 16 bit */
-#define ADD_TRANSL_COUNTS(n, m)		\
-	(((Uint16 *)dst)[0] = n, ((Uint16 *)dst)[1] = m, dst += 4)
-
-	for(y = 0; y < h; y++) {
-	    int runstart, skipstart;
-	    int blankline = 0;
-	    /* First encode all opaque pixels of a scan line */
-	    x = 0;
-	    do {
-		int run, skip, len;
-		skipstart = x;
-		while(x < w && !ISOPAQUE(src[x], sf))
-		    x++;
-		runstart = x;
-		while(x < w && ISOPAQUE(src[x], sf))
-		    x++;
-		skip = runstart - skipstart;
-		if(skip == w)
-		    blankline = 1;
-		run = x - runstart;
-		while(skip > max_opaque_run) {
-		    ADD_OPAQUE_COUNTS(max_opaque_run, 0);
-		    skip -= max_opaque_run;
-		}
-		len = MIN(run, max_opaque_run);
-		ADD_OPAQUE_COUNTS(skip, len);
-		dst += copy_opaque(dst, src + runstart, len, sf, df);
-		runstart += len;
-		run -= len;
-		while(run) {
-		    len = MIN(run, max_opaque_run);
-		    ADD_OPAQUE_COUNTS(0, len);
-		    dst += copy_opaque(dst, src + runstart, len, sf, df);
-		    runstart += len;
-		    run -= len;
-		}
-	    } while(x < w);
-
-	    /* Make sure the next output address is 32-bit aligned */
-	    dst += (uintptr_t)dst & 2;
-
-	    /* Next, encode all translucent pixels of the same scan line */
-	    x = 0;
-	    do {
-		int run, skip, len;
-		skipstart = x;
-		while(x < w && !ISTRANSL(src[x], sf))
-		    x++;
-		runstart = x;
-		while(x < w && ISTRANSL(src[x], sf))
-		    x++;
-		skip = runstart - skipstart;
-		blankline &= (skip == w);
-		run = x - runstart;
-		while(skip > max_transl_run) {
-		    ADD_TRANSL_COUNTS(max_transl_run, 0);
-		    skip -= max_transl_run;
-		}
-		len = MIN(run, max_transl_run);
-		ADD_TRANSL_COUNTS(skip, len);
-		dst += copy_transl(dst, src + runstart, len, sf, df);
-		runstart += len;
-		run -= len;
-		while(run) {
-		    len = MIN(run, max_transl_run);
-		    ADD_TRANSL_COUNTS(0, len);
-		    dst += copy_transl(dst, src + runstart, len, sf, df);
-		    runstart += len;
-		    run -= len;
-		}
-		if(!blankline)
-		    lastline = dst;
-	    } while(x < w);
-
-	    src += surface->pitch >> 2;
-	}
-	dst = lastline;		/* back up past trailing blank lines */
+	RLEAlphaInfo info;
+	info.surface = surface;
+	info.df = df;
+	info.max_opaque_run = max_opaque_run;
+	info.copy_opaque = copy_opaque;
+	info.copy_transl = copy_transl;
+	info.simd = RLESimdLevel();
+
+	/* back up past trailing blank lines */
+	dst = RLEEncodeRows(surface, RLEAlphaRows, &info, rowsize, dst);
 	ADD_OPAQUE_COUNTS(0, 0);
     }
 
@@ -1640,54 +1985,97 @@ static getpix_func getpixes[4] = {
     getpix_8, getpix_16, getpix_24, getpix_32
 };
 
-static int RLEColorkeySurface(SDL_Surface *surface)
+/*
+ * The vector colorkey scanners compare bytes, with the key and mask
+ * repeated for each pixel of 1, 2 or 4 bytes; a pixel is the key when
+ * all its bytes are, which folding the byte mask down to the first byte
+ * of each pixel tells.
+ */
+#if SDL_SSE2_BLITTERS
+static int SDL_TARGETING("sse2")
+RLEColorkeyRunSSE2(Uint8 *srcbuf, int x, int w, int bpp,
+		   Uint32 ckey, Uint32 rgbmask, int want)
 {
-        Uint8 *rlebuf, *dst;
-	int maxn;
-	int y;
-	Uint8 *srcbuf, *lastline;
-	int maxsize = 0;
-	int bpp = surface->format->BytesPerPixel;
-	getpix_func getpix;
-	Uint32 ckey, rgbmask;
-	int w, h;
+    const __m128i key = _mm_set1_epi32((int)ckey);
+    const __m128i mask = _mm_set1_epi32((int)rgbmask);
+    const int first = bpp == 1 ? 0xffff : bpp == 2 ? 0x5555 : 0x1111;
+    const int stop = want ? first : 0;
+    const int n = 16 / bpp;
+
+    for(; x + n <= w; x += n) {
+	__m128i p = _mm_loadu_si128((const __m128i *)(srcbuf + x * bpp));
+	int bits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(p, mask),
+						    key));
+	if(bpp >= 2)
+	    bits &= bits >> 1;
+	if(bpp == 4)
+	    bits &= bits >> 2;
+	bits = (bits & first) ^ stop;
+	if(bits)
+	    return x + __builtin_ctz(bits) / bpp;
+    }
+    return x;
+}
+#endif /* SDL_SSE2_BLITTERS */
 
-	/* calculate the worst case size for the compressed surface */
-	switch(bpp) {
-	case 1:
-	    /* worst case is alternating opaque and transparent pixels,
-	       starting with an opaque pixel */
-	    maxsize = surface->h * 3 * (surface->w / 2 + 1) + 2;
-	    break;
-	case 2:
-	case 3:
-	    /* worst case is solid runs, at most 255 pixels wide */
-	    maxsize = surface->h * (2 * (surface->w / 255 + 1)
-				    + surface->w * bpp) + 2;
-	    break;
-	case 4:
-	    /* worst case is solid runs, at most 65535 pixels wide */
-	    maxsize = surface->h * (4 * (surface->w / 65535 + 1)
-				    + surface->w * 4) + 4;
-	    break;
-	}
+#if SDL_AVX2_BLITTERS
+static int SDL_TARGETING("avx2")
+RLEColorkeyRunAVX2(Uint8 *srcbuf, int x, int w, int bpp,
+		   Uint32 ckey, Uint32 rgbmask, int want)
+{
+    const __m256i key = _mm256_set1_epi32((int)ckey);
+    const __m256i mask = _mm256_set1_epi32((int)rgbmask);
+    const unsigned first = bpp == 1 ? 0xffffffff
+			 : bpp == 2 ? 0x55555555 : 0x11111111;
+    const unsigned stop = want ? first : 0;
+    const int n = 32 / bpp;
+
+    for(; x + n <= w; x += n) {
+	__m256i p = _mm256_loadu_si256((const __m256i *)(srcbuf + x * bpp));
+	unsigned bits = (unsigned)_mm256_movemask_epi8(
+	    _mm256_cmpeq_epi8(_mm256_and_si256(p, mask), key));
+	if(bpp >= 2)
+	    bits &= bits >> 1;
+	if(bpp == 4)
+	    bits &= bits >> 2;
+	bits = (bits & first) ^ stop;
+	if(bits)
+	    return x + __builtin_ctz(bits) / bpp;
+    }
+    return x;
+}
+#endif /* SDL_AVX2_BLITTERS */
 
-	rlebuf = (Uint8 *)SDL_malloc(maxsize);
-	if ( rlebuf == NULL ) {
-		SDL_OutOfMemory();
-		return(-1);
-	}
+/* the parameters of a colorkey encoding, shared by the bands; simd is
+   only set for 1, 2 and 4 byte pixels, for which simd_ckey and
+   simd_rgbmask repeat the key and mask to fill 32 bits */
+typedef struct {
+    SDL_Surface *surface;
+    Uint32 ckey, rgbmask;
+    Uint32 simd_ckey, simd_rgbmask;
+    int simd;
+} RLEColorkeyInfo;
+
+static int RLEColorkeyRun(const RLEColorkeyInfo *info, Uint8 *srcbuf,
+			  int x, int w, int bpp, int want)
+{
+    getpix_func getpix = getpixes[bpp - 1];
 
-	/* Set up the conversion */
-	srcbuf = (Uint8 *)surface->pixels;
-	maxn = bpp == 4 ? 65535 : 255;
-	dst = rlebuf;
-	rgbmask = ~surface->format->Amask;
-	ckey = surface->format->colorkey & rgbmask;
-	lastline = dst;
-	getpix = getpixes[bpp - 1];
-	w = surface->w;
-	h = surface->h;
+#if SDL_AVX2_BLITTERS
+    if(info->simd == 2)
+	x = RLEColorkeyRunAVX2(srcbuf, x, w, bpp, info->simd_ckey,
+			       info->simd_rgbmask, want);
+#endif
+#if SDL_SSE2_BLITTERS
+    if(info->simd)
+	x = RLEColorkeyRunSSE2(srcbuf, x, w, bpp, info->simd_ckey,
+			       info->simd_rgbmask, want);
+#endif
+    while(x < w
+	  && ((getpix(srcbuf + x * bpp) & info->rgbmask) == info->ckey) == want)
+	x++;
+    return x;
+}
 
 #define ADD_COUNTS(n, m)			\
 	if(bpp == 4) {				\
@@ -1700,7 +2088,18 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 	    dst += 2;				\
 	}
 
-	for(y = 0; y < h; y++) {
+static Uint8 *RLEColorkeyRows(const void *data, int y0, int y1,
+			      Uint8 *dst, Uint8 **lastline)
+{
+	const RLEColorkeyInfo *info = (const RLEColorkeyInfo *)data;
+	SDL_Surface *surface = info->surface;
+	int bpp = surface->format->BytesPerPixel;
+	int maxn = bpp == 4 ? 65535 : 255;
+	int w = surface->w;
+	int y;
+	Uint8 *srcbuf = (Uint8 *)surface->pixels + y0 * surface->pitch;
+
+	for(y = y0; y < y1; y++) {
 	    int x = 0;
 	    int blankline = 0;
 	    do {
@@ -1709,11 +2108,9 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 		int skipstart = x;
 
 		/* find run of transparent, then opaque pixels */
-		while(x < w && (getpix(srcbuf + x * bpp) & rgbmask) == ckey)
-		    x++;
+		x = RLEColorkeyRun(info, srcbuf, x, w, bpp, 1);
 		runstart = x;
-		while(x < w && (getpix(srcbuf + x * bpp) & rgbmask) != ckey)
-		    x++;
+		x = RLEColorkeyRun(info, srcbuf, x, w, bpp, 0);
 		skip = runstart - skipstart;
 		if(skip == w)
 		    blankline = 1;
@@ -1739,12 +2136,68 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 		    run -= len;
 		}
 		if(!blankline)
-		    lastline = dst;
+		    *lastline = dst;
 	    } while(x < w);
 
 	    srcbuf += surface->pitch;
 	}
-	dst = lastline;		/* back up bast trailing blank lines */
+	return dst;
+}
+
+static int RLEColorkeySurface(SDL_Surface *surface)
+{
+        Uint8 *rlebuf, *dst;
+	int maxsize = 0;
+	int rowsize = 0;
+	int bpp = surface->format->BytesPerPixel;
+	RLEColorkeyInfo info;
+
+	/* calculate the worst case size for the compressed surface */
+	switch(bpp) {
+	case 1:
+	    /* worst case is alternating opaque and transparent pixels,
+	       starting with an opaque pixel */
+	    rowsize = 3 * (surface->w / 2 + 1);
+	    maxsize = surface->h * rowsize + 2;
+	    break;
+	case 2:
+	case 3:
+	    /* worst case is solid runs, at most 255 pixels wide */
+	    rowsize = 2 * (surface->w / 255 + 1) + surface->w * bpp;
+	    maxsize = surface->h * rowsize + 2;
+	    break;
+	case 4:
+	    /* worst case is solid runs, at most 65535 pixels wide */
+	    rowsize = 4 * (surface->w / 65535 + 1) + surface->w * 4;
+	    maxsize = surface->h * rowsize + 4;
+	    break;
+	}
+
+	rlebuf = (Uint8 *)SDL_malloc(maxsize);
+	if ( rlebuf == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+
+	/* Set up the conversion */
+	info.surface = surface;
+	info.rgbmask = ~surface->format->Amask;
+	info.ckey = surface->format->colorkey & info.rgbmask;
+	info.simd = 0;
+	if(bpp != 3) {
+	    /* the vector scanners see whole bytes, so the key and mask
+	       must be cut down to the pixel size, and then repeated */
+	    Uint32 repeat = bpp == 1 ? 0x01010101 : bpp == 2 ? 0x00010001 : 1;
+	    Uint32 pixmask = bpp == 4 ? 0xffffffff : (1U << (bpp * 8)) - 1;
+	    if((info.ckey & ~pixmask) == 0) {
+		info.simd_ckey = info.ckey * repeat;
+		info.simd_rgbmask = (info.rgbmask & pixmask) * repeat;
+		info.simd = RLESimdLevel();
+	    }
+	}
+
+	/* back up past trailing blank lines */
+	dst = RLEEncodeRows(surface, RLEColorkeyRows, &info, rowsize, rlebuf);
 	ADD_COUNTS(0, 0);
 
 #undef ADD_COUNTS
@@ -1939,3 +2392,326 @@ void SDL_UnRLESurface(SDL_Surface *surface, int recode)
 }
 
 
+
+/*
+ * RLE cache files hold the encoded stream of a surface, so that it can be
+ * loaded straight back as an RLE accelerated surface without encoding it
+ * again.  The stream is in native byte order, and is laid out for the
+ * destination the surface was blitted to, so the files are only meant to
+ * be read back on the machine that wrote them:
+ *
+ *   "SRLE", version, byte order, width, height, flags (SDL_SRCCOLORKEY,
+ *   SDL_SRCALPHA and SDL_RLEACCELOK), depth, R/G/B/A masks, colorkey,
+ *   alpha, number of palette colours and the colours, stream length and
+ *   the stream itself.
+ *
+ * All the header fields are little endian.
+ */
+#define RLE_FILE_VERSION	1
+
+/* the length of the RLE stream of a surface, checking that it holds no
+   more than the surface's lines and pixels, or -1 if it's corrupt or
+   longer than maxlen */
+static int RLEStreamLength(SDL_Surface *surface, const Uint8 *rle, int maxlen)
+{
+	int w = surface->w;
+	int h = surface->h;
+	int alpha = !(surface->flags & SDL_SRCCOLORKEY);
+	int bpp = surface->format->BytesPerPixel;
+	int ofs = 0;
+	int y, part;
+
+	if ( alpha ) {
+		const RLEDestFormat *df = (const RLEDestFormat *)rle;
+		if ( maxlen < (int)sizeof(*df) ) {
+			return(-1);
+		}
+		bpp = df->BytesPerPixel;
+		if ( bpp != 2 && bpp != 4 ) {
+			return(-1);
+		}
+		ofs = sizeof(*df);
+	}
+
+	for ( y = 0; ; ++y ) {
+		/* alpha lines have opaque, then translucent segments */
+		for ( part = 0; part <= alpha; ++part ) {
+			int countsize = (part || bpp == 4) ? 2 : 1;
+			int pixsize = part ? 4 : bpp;
+			int x = 0;
+
+			if ( part ) {
+				ofs += ofs & 2;
+			}
+			do {
+				int skip, run;
+
+				if ( maxlen - ofs < 2 * countsize ) {
+					return(-1);
+				}
+				if ( countsize == 2 ) {
+					skip = ((const Uint16 *)(rle + ofs))[0];
+					run = ((const Uint16 *)(rle + ofs))[1];
+				} else {
+					skip = rle[ofs];
+					run = rle[ofs + 1];
+				}
+				ofs += 2 * countsize;
+				if ( !part && !x && !skip && !run ) {
+					return(ofs);	/* end of the stream */
+				}
+				x += skip + run;
+				if ( y >= h || x > w ) {
+					return(-1);
+				}
+				if ( (maxlen - ofs) / pixsize < run ) {
+					return(-1);
+				}
+				ofs += run * pixsize;
+			} while ( x < w );
+		}
+	}
+}
+
+int SDL_SaveRLE_RW(SDL_Surface *surface, SDL_RWops *dst, int freedst)
+{
+	SDL_PixelFormat *fmt = surface->format;
+	SDL_Palette *palette = fmt->palette;
+	Uint8 *rle = NULL;
+	int length = -1;
+	int i;
+
+	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
+		rle = (Uint8 *)surface->map->sw_data->aux_data;
+		length = RLEStreamLength(surface, rle, 0x7FFFFFFF);
+	}
+	if ( dst ) {
+		if ( length < 0 ) {
+			SDL_SetError("Surface is not RLE encoded, blit it first");
+		} else {
+			SDL_ClearError();
+			SDL_RWwrite(dst, "SRLE", 1, 4);
+			SDL_WriteLE16(dst, RLE_FILE_VERSION);
+			SDL_WriteLE16(dst, SDL_BYTEORDER);
+			SDL_WriteLE32(dst, surface->w);
+			SDL_WriteLE32(dst, surface->h);
+			SDL_WriteLE32(dst, surface->flags &
+			    (SDL_SRCCOLORKEY|SDL_SRCALPHA|SDL_RLEACCELOK));
+			SDL_WriteLE16(dst, fmt->BitsPerPixel);
+			SDL_WriteLE32(dst, fmt->Rmask);
+			SDL_WriteLE32(dst, fmt->Gmask);
+			SDL_WriteLE32(dst, fmt->Bmask);
+			SDL_WriteLE32(dst, fmt->Amask);
+			SDL_WriteLE32(dst, fmt->colorkey);
+			SDL_WriteLE16(dst, fmt->alpha);
+			SDL_WriteLE16(dst, palette ? palette->ncolors : 0);
+			for ( i = 0; palette && i < palette->ncolors; ++i ) {
+				SDL_RWwrite(dst, &palette->colors[i].b, 1, 1);
+				SDL_RWwrite(dst, &palette->colors[i].g, 1, 1);
+				SDL_RWwrite(dst, &palette->colors[i].r, 1, 1);
+				SDL_RWwrite(dst, &palette->colors[i].unused, 1, 1);
+			}
+			SDL_WriteLE32(dst, length);
+			if ( SDL_RWwrite(dst, rle, 1, length) != length ) {
+				SDL_Error(SDL_EFWRITE);
+			}
+		}
+	}
+
+	if ( freedst && dst ) {
+		SDL_RWclose(dst);
+	}
+	return((SDL_strcmp(SDL_GetError(), "") == 0) ? 0 : -1);
+}
+
+/* blit a loaded surface to dst straight from its RLE stream, if dst is
+   one SDL_CalculateBlit() would have encoded it for, or else decode it,
+   leaving the next blit to encode it again */
+static int RLEInstallSurface(SDL_Surface *surface, SDL_Surface *dst, Uint8 *rle)
+{
+	SDL_PixelFormat *sf = surface->format;
+	SDL_blit blit = NULL;
+
+	if ( dst ) {
+		/* map without encoding, as there are no pixels */
+		Uint32 rleok = surface->flags & SDL_RLEACCELOK;
+		int mapped;
+
+		surface->flags &= ~SDL_RLEACCELOK;
+		mapped = SDL_MapSurface(surface, dst);
+		surface->flags |= rleok;
+		if ( mapped == 0 && rleok &&
+		     (surface->flags & SDL_HWACCEL) != SDL_HWACCEL ) {
+			if ( surface->flags & SDL_SRCCOLORKEY ) {
+				SDL_loblit convert = NULL;
+				if ( !surface->map->identity ) {
+					convert = SDL_CalculateRLEConvert(surface);
+				}
+				if ( (surface->map->identity || convert) &&
+				     !((surface->flags & SDL_SRCALPHA) &&
+				       sf->Amask) ) {
+					if ( convert ) {
+						surface->map->sw_data->blit = convert;
+					}
+					blit = SDL_RLEBlit;
+				}
+			} else {
+				RLEDestFormat *r = (RLEDestFormat *)rle;
+				SDL_PixelFormat *df = dst->format;
+				if ( r->BytesPerPixel == df->BytesPerPixel &&
+				     r->Rmask == df->Rmask &&
+				     r->Gmask == df->Gmask &&
+				     r->Bmask == df->Bmask &&
+				     r->Amask == df->Amask ) {
+					blit = SDL_RLEAlphaBlit;
+				}
+			}
+		}
+	}
+
+	surface->map->sw_data->aux_data = rle;
+	surface->flags |= SDL_RLEACCEL;
+	if ( blit ) {
+		surface->map->sw_blit = blit;
+		return(0);
+	}
+	SDL_UnRLESurface(surface, 1);
+	if ( surface->flags & SDL_RLEACCEL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	SDL_InvalidateMap(surface->map);
+	return(0);
+}
+
+SDL_Surface *SDL_LoadRLE_RW(SDL_RWops *src, int freesrc, SDL_Surface *dst)
+{
+	SDL_bool was_error = SDL_TRUE;
+	long fp_offset = 0;
+	SDL_Surface *surface = NULL;
+	Uint8 *rle = NULL;
+	char magic[4];
+	Uint16 version, byteorder, depth, alpha, ncolors;
+	Uint32 w, h, flags, Rmask, Gmask, Bmask, Amask, colorkey, length;
+	int i;
+
+	if ( src == NULL ) {
+		goto done;
+	}
+
+	/* Read in the header */
+	fp_offset = SDL_RWtell(src);
+	SDL_ClearError();
+	if ( SDL_RWread(src, magic, 1, 4) != 4 ) {
+		SDL_Error(SDL_EFREAD);
+		goto done;
+	}
+	if ( SDL_strncmp(magic, "SRLE", 4) != 0 ) {
+		SDL_SetError("File is not an SDL RLE cache");
+		goto done;
+	}
+	version		= SDL_ReadLE16(src);
+	byteorder	= SDL_ReadLE16(src);
+	w		= SDL_ReadLE32(src);
+	h		= SDL_ReadLE32(src);
+	flags		= SDL_ReadLE32(src);
+	depth		= SDL_ReadLE16(src);
+	Rmask		= SDL_ReadLE32(src);
+	Gmask		= SDL_ReadLE32(src);
+	Bmask		= SDL_ReadLE32(src);
+	Amask		= SDL_ReadLE32(src);
+	colorkey	= SDL_ReadLE32(src);
+	alpha		= SDL_ReadLE16(src);
+	ncolors		= SDL_ReadLE16(src);
+	if ( version != RLE_FILE_VERSION || byteorder != SDL_BYTEORDER ) {
+		SDL_SetError("RLE cache from another SDL version or machine");
+		goto done;
+	}
+	if ( w >= 16384 || h >= 65536 ||
+	     (depth != 8 && depth != 15 && depth != 16 &&
+	      depth != 24 && depth != 32) ) {
+		SDL_SetError("RLE cache with bad dimensions or depth");
+		goto done;
+	}
+	if ( !(flags & SDL_SRCCOLORKEY) &&
+	     (depth != 32 || !Amask || !(flags & SDL_SRCALPHA)) ) {
+		SDL_SetError("RLE cache without colorkey or alpha channel");
+		goto done;
+	}
+
+	/* Create the surface without pixels, the stream stands for them */
+	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, 0, 0, depth,
+	                               Rmask, Gmask, Bmask, Amask);
+	if ( surface == NULL ) {
+		goto done;
+	}
+	surface->w = w;
+	surface->h = h;
+	surface->pitch = SDL_CalculatePitch(surface);
+	SDL_SetClipRect(surface, NULL);
+	surface->flags &= ~(SDL_SRCCOLORKEY|SDL_SRCALPHA|SDL_RLEACCELOK);
+	surface->flags |= flags & (SDL_SRCCOLORKEY|SDL_SRCALPHA|SDL_RLEACCELOK);
+	surface->format->colorkey = colorkey;
+	surface->format->alpha = (Uint8)alpha;
+
+	if ( surface->format->palette ) {
+		SDL_Palette *palette = surface->format->palette;
+		if ( ncolors > palette->ncolors ) {
+			SDL_SetError("RLE cache with bad palette");
+			goto done;
+		}
+		for ( i = 0; i < ncolors; ++i ) {
+			SDL_RWread(src, &palette->colors[i].b, 1, 1);
+			SDL_RWread(src, &palette->colors[i].g, 1, 1);
+			SDL_RWread(src, &palette->colors[i].r, 1, 1);
+			SDL_RWread(src, &palette->colors[i].unused, 1, 1);
+		}
+		palette->ncolors = ncolors;
+	} else if ( ncolors ) {
+		SDL_SetError("RLE cache with bad palette");
+		goto done;
+	}
+
+	/* Read and check the stream */
+	length = SDL_ReadLE32(src);
+	if ( length >= 0x7FFFFFFF ) {
+		SDL_SetError("RLE cache with bad stream");
+		goto done;
+	}
+	rle = (Uint8 *)SDL_malloc(length ? length : 1);
+	if ( rle == NULL ) {
+		SDL_OutOfMemory();
+		goto done;
+	}
+	if ( SDL_RWread(src, rle, 1, length) != (int)length ) {
+		SDL_Error(SDL_EFREAD);
+		goto done;
+	}
+	if ( RLEStreamLength(surface, rle, length) != (int)length ) {
+		SDL_SetError("RLE cache with bad stream");
+		goto done;
+	}
+
+	/* the surface owns the stream from now on */
+	if ( RLEInstallSurface(surface, dst, rle) == 0 ) {
+		was_error = SDL_FALSE;
+	}
+	rle = NULL;
+done:
+	if ( was_error ) {
+		if ( src ) {
+			SDL_RWseek(src, fp_offset, RW_SEEK_SET);
+		}
+		if ( surface ) {
+			SDL_FreeSurface(surface);
+		}
+		surface = NULL;
+	}
+	if ( rle ) {
+		SDL_free(rle);
+	}
+	if ( freesrc && src ) {
+		SDL_RWclose(src);
+	}
+	return(surface);
+}
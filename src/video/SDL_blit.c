@@ -39,40 +39,208 @@
 #include "mmx.h"
 #endif
 
-/* The general purpose software blit routine */
-static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
-			SDL_Surface *dst, SDL_Rect *dstrect)
-{
-	int okay;
-	int src_locked;
-	int dst_locked;
+#if !SDL_THREADS_DISABLED
+#include "SDL_thread.h"
 
-	/* Everything is okay at the beginning...  */
-	okay = 1;
+/* Optional pool of worker threads sharing out large software blits.
+   It is started by SDL_VideoInit() if SDL_VIDEO_BLIT_THREADS asks for
+   more than one thread, and each job is split between the workers and
+   the calling thread.
+*/
+#define SDL_MAX_BLIT_THREADS	16
+#define SDL_BLIT_THRESHOLD	(256*256)
+
+typedef struct {
+	SDL_Thread *thread;
+	SDL_sem *go;
+	int index;
+} SDL_BlitWorker;
+
+static struct {
+	int nthreads;		/* number of workers, plus the caller */
+	int threshold;		/* smallest blit worth splitting, in pixels */
+	int quit;
+	SDL_mutex *lock;
+	SDL_sem *done;
+	SDL_BlitJob job;
+	void *data;
+	int count;
+	SDL_BlitWorker workers[SDL_MAX_BLIT_THREADS-1];
+} blit_pool;
+
+static int SDLCALL SDL_BlitWorkerThread(void *data)
+{
+	SDL_BlitWorker *worker = (SDL_BlitWorker *)data;
 
-	/* Lock the destination if it's in hardware */
-	dst_locked = 0;
-	if ( SDL_MUSTLOCK(dst) ) {
-		if ( SDL_LockSurface(dst) < 0 ) {
-			okay = 0;
-		} else {
-			dst_locked = 1;
+	for ( ; ; ) {
+		SDL_SemWait(worker->go);
+		if ( blit_pool.quit ) {
+			break;
 		}
+		blit_pool.job(blit_pool.data, worker->index, blit_pool.count);
+		SDL_SemPost(blit_pool.done);
 	}
-	/* Lock the source if it's in hardware */
-	src_locked = 0;
-	if ( SDL_MUSTLOCK(src) ) {
-		if ( SDL_LockSurface(src) < 0 ) {
-			okay = 0;
-		} else {
-			src_locked = 1;
+	return(0);
+}
+
+void SDL_BlitThreadsInit(void)
+{
+	const char *env;
+	int nthreads, i;
+
+	if ( blit_pool.nthreads ) {
+		return;
+	}
+	env = SDL_getenv("SDL_VIDEO_BLIT_THREADS");
+	nthreads = env ? SDL_atoi(env) : 0;
+	if ( nthreads < 2 ) {
+		return;
+	}
+	if ( nthreads > SDL_MAX_BLIT_THREADS ) {
+		nthreads = SDL_MAX_BLIT_THREADS;
+	}
+	env = SDL_getenv("SDL_VIDEO_BLIT_THRESHOLD");
+	blit_pool.threshold = env ? SDL_atoi(env) : SDL_BLIT_THRESHOLD;
+
+	blit_pool.quit = 0;
+	blit_pool.lock = SDL_CreateMutex();
+	blit_pool.done = SDL_CreateSemaphore(0);
+	if ( !blit_pool.lock || !blit_pool.done ) {
+		SDL_BlitThreadsQuit();
+		return;
+	}
+	blit_pool.nthreads = 1;
+	for ( i = 0; i < nthreads-1; ++i ) {
+		SDL_BlitWorker *worker = &blit_pool.workers[i];
+
+		worker->index = i+1;
+		worker->go = SDL_CreateSemaphore(0);
+		if ( worker->go ) {
+			worker->thread = SDL_CreateThread(SDL_BlitWorkerThread, worker);
+		}
+		if ( !worker->thread ) {
+			if ( worker->go ) {
+				SDL_DestroySemaphore(worker->go);
+				worker->go = NULL;
+			}
+			break;
 		}
+		++blit_pool.nthreads;
+	}
+}
+
+void SDL_BlitThreadsQuit(void)
+{
+	int i;
+
+	blit_pool.quit = 1;
+	for ( i = 0; i < blit_pool.nthreads-1; ++i ) {
+		SDL_BlitWorker *worker = &blit_pool.workers[i];
+
+		SDL_SemPost(worker->go);
+		SDL_WaitThread(worker->thread, NULL);
+		SDL_DestroySemaphore(worker->go);
+		worker->thread = NULL;
+		worker->go = NULL;
+	}
+	if ( blit_pool.done ) {
+		SDL_DestroySemaphore(blit_pool.done);
+		blit_pool.done = NULL;
+	}
+	if ( blit_pool.lock ) {
+		SDL_DestroyMutex(blit_pool.lock);
+		blit_pool.lock = NULL;
+	}
+	blit_pool.nthreads = 0;
+}
+
+int SDL_BlitThreadsCount(int pixels)
+{
+	if ( blit_pool.nthreads < 2 || pixels < blit_pool.threshold ) {
+		return(1);
 	}
+	return(blit_pool.nthreads);
+}
+
+void SDL_BlitThreadsRun(SDL_BlitJob job, void *data, int count)
+{
+	int i;
+
+	if ( count > blit_pool.nthreads ) {
+		count = blit_pool.nthreads;
+	}
+	if ( count < 2 ) {
+		job(data, 0, 1);
+		return;
+	}
+	SDL_mutexP(blit_pool.lock);
+	blit_pool.job = job;
+	blit_pool.data = data;
+	blit_pool.count = count;
+	for ( i = 0; i < count-1; ++i ) {
+		SDL_SemPost(blit_pool.workers[i].go);
+	}
+	job(data, 0, count);
+	for ( i = 0; i < count-1; ++i ) {
+		SDL_SemWait(blit_pool.done);
+	}
+	SDL_mutexV(blit_pool.lock);
+}
+
+#else
+
+void SDL_BlitThreadsInit(void)
+{
+}
 
+void SDL_BlitThreadsQuit(void)
+{
+}
+
+int SDL_BlitThreadsCount(int pixels)
+{
+	return(1);
+}
+
+void SDL_BlitThreadsRun(SDL_BlitJob job, void *data, int count)
+{
+	job(data, 0, 1);
+}
+
+#endif /* !SDL_THREADS_DISABLED */
+
+/* Horizontal bands of a blit, run by SDL_BlitThreadsRun() */
+typedef struct {
+	SDL_loblit blit;
+	SDL_BlitInfo *info;
+	int s_pitch;
+	int d_pitch;
+} SDL_BlitBands;
+
+static void SDL_BlitBand(void *data, int band, int bands)
+{
+	SDL_BlitBands *bandinfo = (SDL_BlitBands *)data;
+	SDL_BlitInfo info = *bandinfo->info;
+	int y, h;
+
+	y = (band * info.d_height) / bands;
+	h = ((band+1) * info.d_height) / bands - y;
+	info.s_pixels += y * bandinfo->s_pitch;
+	info.d_pixels += y * bandinfo->d_pitch;
+	info.s_height = h;
+	info.d_height = h;
+	bandinfo->blit(&info);
+}
+
+/* The software blit routine proper, for surfaces which are locked */
+void SDL_SoftBlitLocked(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect)
+{
 	/* Set up source and destination buffer pointers, and BLIT! */
-	if ( okay  && srcrect->w && srcrect->h ) {
+	if ( srcrect->w && srcrect->h ) {
 		SDL_BlitInfo info;
 		SDL_loblit RunBlit;
+		int bands;
 
 		/* Set up the blit information */
 		info.s_pixels = (Uint8 *)src->pixels +
@@ -93,8 +261,59 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		info.dst = dst->format;
 		RunBlit = src->map->sw_data->blit;
 
-		/* Run the actual software blit */
-		RunBlit(&info);
+		/* Run the actual software blit, split into bands if it's
+		   large enough and the rows don't overlap */
+		bands = SDL_BlitThreadsCount(info.d_width*info.d_height);
+		if ( bands > info.d_height ) {
+			bands = info.d_height;
+		}
+		if ( bands > 1 && src != dst ) {
+			SDL_BlitBands bandinfo;
+
+			bandinfo.blit = RunBlit;
+			bandinfo.info = &info;
+			bandinfo.s_pitch = src->pitch;
+			bandinfo.d_pitch = dst->pitch;
+			SDL_BlitThreadsRun(SDL_BlitBand, &bandinfo, bands);
+		} else {
+			RunBlit(&info);
+		}
+	}
+}
+
+/* The general purpose software blit routine */
+int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	int okay;
+	int src_locked;
+	int dst_locked;
+
+	/* Everything is okay at the beginning...  */
+	okay = 1;
+
+	/* Lock the destination if it's in hardware */
+	dst_locked = 0;
+	if ( SDL_MUSTLOCK(dst) ) {
+		if ( SDL_LockSurface(dst) < 0 ) {
+			okay = 0;
+		} else {
+			dst_locked = 1;
+		}
+	}
+	/* Lock the source if it's in hardware */
+	src_locked = 0;
+	if ( SDL_MUSTLOCK(src) ) {
+		if ( SDL_LockSurface(src) < 0 ) {
+			okay = 0;
+		} else {
+			src_locked = 1;
+		}
+	}
+
+	/* Set up source and destination buffer pointers, and BLIT! */
+	if ( okay ) {
+		SDL_SoftBlitLocked(src, srcrect, dst, dstrect);
 	}
 
 	/* We need to unlock the surfaces if they're locked */
@@ -229,6 +448,43 @@ static void SDL_BlitCopyOverlap(SDL_BlitInfo *info)
 	}
 }
 
+SDL_loblit SDL_CalculateRLEConvert(SDL_Surface *surface)
+{
+	struct private_swaccel *sdata = surface->map->sw_data;
+	void *aux_data = sdata->aux_data;
+	SDL_loblit convert = NULL;
+	int blit_index = 1;
+
+	/* The same colorkey blit as without RLE.  The runs have no
+	   colorkeyed pixels in them, so every pixel passes the test, and
+	   the output matches the colorkey blitters, whose conversion can
+	   differ from the plain blitters' (565 to 8888, for one). */
+	if ( surface->flags & SDL_SRCALPHA
+	     && (surface->format->alpha != SDL_ALPHA_OPAQUE
+		 || surface->format->Amask) ) {
+	        blit_index |= 2;
+	}
+	if ( surface->map->dst->format->BitsPerPixel >= 8 ) {
+		switch ( surface->format->BytesPerPixel ) {
+		    case 1:
+			convert = SDL_CalculateBlit1(surface, blit_index);
+			break;
+		    case 2:
+		    case 3:
+		    case 4:
+			convert = SDL_CalculateBlitN(surface, blit_index);
+			break;
+		}
+	}
+
+	/* The RLE data takes the place of any the blitter would need */
+	if ( sdata->aux_data != aux_data ) {
+		sdata->aux_data = aux_data;
+		convert = NULL;
+	}
+	return(convert);
+}
+
 /* Figure out which of many blit routines to set up on a surface */
 int SDL_CalculateBlit(SDL_Surface *surface)
 {
@@ -341,11 +597,18 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 	if(surface->flags & SDL_RLEACCELOK
 	   && (surface->flags & SDL_HWACCEL) != SDL_HWACCEL) {
 
-	        if(surface->map->identity
-		   && (blit_index == 1
-		       || (blit_index == 3 && !surface->format->Amask))) {
-		        if ( SDL_RLESurface(surface) == 0 )
+	        if(blit_index == 1
+		   || (blit_index == 3 && !surface->format->Amask)) {
+		        /* other formats are converted a run at a time */
+		        SDL_loblit convert = NULL;
+		        if(!surface->map->identity)
+			        convert = SDL_CalculateRLEConvert(surface);
+		        if((surface->map->identity || convert)
+			   && SDL_RLESurface(surface) == 0) {
+			        if(convert)
+				        surface->map->sw_data->blit = convert;
 			        surface->map->sw_blit = SDL_RLEBlit;
+		        }
 		} else if(blit_index == 2 && surface->format->Amask) {
 		        if ( SDL_RLESurface(surface) == 0 )
 			        surface->map->sw_blit = SDL_RLEAlphaBlit;
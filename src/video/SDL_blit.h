@@ -28,6 +28,19 @@
 
 extern SDL_bool SDL_HasARMSIMD(void);		/* whether CPU has ARM SIMD (ARMv6) features */
 extern SDL_bool SDL_HasNEON (void);		/* whether CPU has ARM NEON features.        */
+extern SDL_bool SDL_HasAVX2 (void);		/* whether CPU and OS support x86 AVX2.      */
+extern int SDL_GetCPUCacheSize (void);		/* last level cache size in bytes, 0 if unknown */
+
+/* x86 SSE2/AVX2 intrinsics blitters.  They are built with per-function
+   target attributes, so the rest of the library keeps the baseline
+   instruction set, and are picked at runtime from the CPU features. */
+#if SDL_ASSEMBLY_ROUTINES && (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SDL_SSE2_BLITTERS 1
+#define SDL_AVX2_BLITTERS 1
+#define SDL_TARGETING(x) __attribute__((target(x)))
+#include <immintrin.h>
+#endif
 
 /* The structure passed to the low level blit functions */
 typedef struct {
@@ -72,6 +85,27 @@ typedef struct SDL_BlitMap {
 
 /* Functions found in SDL_blit.c */
 extern int SDL_CalculateBlit(SDL_Surface *surface);
+extern int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect);
+/* SDL_SoftBlit() without the surface locking, for callers that lock
+   the surfaces once for many blits */
+extern void SDL_SoftBlitLocked(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect);
+/* The blitter converting the opaque runs of a colorkeyed RLE surface to
+   a destination of another format, or NULL if there's none.  While the
+   surface is RLE accelerated, this is the map's sw_data->blit. */
+extern SDL_loblit SDL_CalculateRLEConvert(SDL_Surface *surface);
+
+/* The worker threads for large blits: SDL_BlitThreadsCount() says how many
+   threads a job over the given number of pixels should use, and
+   SDL_BlitThreadsRun() calls job(data, index, count) once for each index
+   from 0 to count-1, in parallel, returning when all have finished.
+ */
+typedef void (*SDL_BlitJob)(void *data, int index, int count);
+extern void SDL_BlitThreadsInit(void);
+extern void SDL_BlitThreadsQuit(void);
+extern int SDL_BlitThreadsCount(int pixels);
+extern void SDL_BlitThreadsRun(SDL_BlitJob job, void *data, int count);
 
 /* Functions found in SDL_blit_{0,1,N,A}.c */
 extern SDL_loblit SDL_CalculateBlit0(SDL_Surface *surface, int complex);
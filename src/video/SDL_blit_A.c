@@ -1493,6 +1493,568 @@ static void BlitRGBtoRGBPixelAlphaARMNEON(SDL_BlitInfo *info)
 }
 #endif
 
+#if SDL_SSE2_BLITTERS
+/*
+ * x86 SSE2/AVX2 per-pixel alpha blitters.
+ *
+ * Channels are blended in 16-bit lanes as (d*(256-A) + s*A + round) >> 8,
+ * which is exactly what BlitRGBtoRGBPixelAlpha (round = 0) and
+ * ALPHA_BLEND (round = 255) compute, without the intermediate overflow.
+ * Vectors whose pixels are all transparent are skipped, and when the
+ * scalar blitter copies opaque pixels unblended, so do these.
+ */
+typedef struct {
+	Uint32 sshift[3];	/* source R, G, B byte positions ... */
+	Uint32 dshift[3];	/* ... and where they go in the destination */
+	int swizzle;		/* non-zero if the byte positions differ */
+	Uint32 ashift;		/* source alpha byte position */
+	Uint32 rgbmask;		/* destination bits written by the blend */
+	Uint32 keepmask;	/* destination bits always preserved */
+	Uint32 round;
+	int opaque;		/* copy opaque pixels instead of blending */
+} PixelAlphaBlend;
+
+static int PixelAlphaFormatOK(const SDL_PixelFormat *fmt)
+{
+	return fmt->BytesPerPixel == 4 &&
+	       fmt->Rloss == 0 && fmt->Gloss == 0 && fmt->Bloss == 0 &&
+	       fmt->Rshift % 8 == 0 && fmt->Gshift % 8 == 0 &&
+	       fmt->Bshift % 8 == 0 &&
+	       (fmt->Amask == 0 || (fmt->Aloss == 0 && fmt->Ashift % 8 == 0));
+}
+
+static void SetupPixelAlphaBlend(PixelAlphaBlend *pb, SDL_BlitInfo *info,
+                                 int fast)
+{
+	SDL_PixelFormat *sf = info->src;
+	SDL_PixelFormat *df = info->dst;
+
+	pb->sshift[0] = sf->Rshift;
+	pb->sshift[1] = sf->Gshift;
+	pb->sshift[2] = sf->Bshift;
+	pb->dshift[0] = df->Rshift;
+	pb->dshift[1] = df->Gshift;
+	pb->dshift[2] = df->Bshift;
+	pb->swizzle = (sf->Rshift != df->Rshift || sf->Gshift != df->Gshift ||
+	               sf->Bshift != df->Bshift);
+	pb->ashift = sf->Ashift;
+	pb->rgbmask = df->Rmask | df->Gmask | df->Bmask;
+	if ( fast ) {
+		/* BlitRGBtoRGBPixelAlpha: whatever is in the top byte stays */
+		pb->keepmask = ~pb->rgbmask;
+		pb->round = 0;
+		pb->opaque = 1;
+	} else {
+		/* BlitNtoNPixelAlpha: destination alpha is kept, padding is cleared */
+		pb->keepmask = df->Amask;
+		pb->round = 255;
+		pb->opaque = 0;
+	}
+}
+
+static __inline__ Uint32 PixelAlphaSwizzle(const PixelAlphaBlend *pb, Uint32 s)
+{
+	if ( !pb->swizzle ) {
+		return s & pb->rgbmask;
+	}
+	return (((s >> pb->sshift[0]) & 0xFF) << pb->dshift[0]) |
+	       (((s >> pb->sshift[1]) & 0xFF) << pb->dshift[1]) |
+	       (((s >> pb->sshift[2]) & 0xFF) << pb->dshift[2]);
+}
+
+/* The C version of the vector blend, for the row tails */
+static void PixelAlphaBlendTail(const PixelAlphaBlend *pb,
+                                Uint32 *srcp, Uint32 *dstp, int width)
+{
+	while ( width-- ) {
+		Uint32 s = *srcp++;
+		Uint32 d = *dstp;
+		Uint32 alpha = (s >> pb->ashift) & 0xFF;
+		if ( alpha ) {
+			Uint32 sw = PixelAlphaSwizzle(pb, s);
+			if ( alpha == SDL_ALPHA_OPAQUE && pb->opaque ) {
+				*dstp = sw | (d & pb->keepmask);
+			} else {
+				Uint32 out = 0;
+				int shift;
+				for ( shift = 0; shift < 32; shift += 8 ) {
+					Uint32 sc = (sw >> shift) & 0xFF;
+					Uint32 dc = (d >> shift) & 0xFF;
+					out |= ((dc * (256 - alpha) + sc * alpha
+					         + pb->round) >> 8) << shift;
+				}
+				*dstp = (out & pb->rgbmask) | (d & pb->keepmask);
+			}
+		}
+		++dstp;
+	}
+}
+
+/* The same for the ARGB8888->RGB565/RGB555 blitters, with 5-bit alpha */
+static void PixelAlphaBlendTail16(Uint32 *srcp, Uint16 *dstp, int width,
+                                  int rshift, int gbits)
+{
+	const Uint32 gmask = (1 << gbits) - 1;
+	while ( width-- ) {
+		Uint32 s = *srcp++;
+		unsigned alpha = s >> 27;
+		if ( alpha ) {
+			Uint32 sr = (s >> 19) & 0x1F;
+			Uint32 sg = (s >> (16 - gbits)) & gmask;
+			Uint32 sb = (s >> 3) & 0x1F;
+			if ( alpha != (SDL_ALPHA_OPAQUE >> 3) ) {
+				Uint32 d = *dstp;
+				Uint32 dr = (d >> rshift) & 0x1F;
+				Uint32 dg = (d >> 5) & gmask;
+				Uint32 db = d & 0x1F;
+				sr = (dr * (32 - alpha) + sr * alpha) >> 5;
+				sg = (dg * (32 - alpha) + sg * alpha) >> 5;
+				sb = (db * (32 - alpha) + sb * alpha) >> 5;
+			}
+			*dstp = (Uint16)((sr << rshift) | (sg << 5) | sb);
+		}
+		++dstp;
+	}
+}
+
+typedef struct {
+	__m128i schan[3];
+	__m128i dchan[3];
+	__m128i ashift;
+	__m128i rgbmask;
+	__m128i keepmask;
+	__m128i round;
+} PixelAlphaBlendSSE2;
+
+static void SDL_TARGETING("sse2")
+SetupPixelAlphaBlendSSE2(PixelAlphaBlendSSE2 *v, const PixelAlphaBlend *pb)
+{
+	int i;
+	for ( i = 0; i < 3; ++i ) {
+		v->schan[i] = _mm_cvtsi32_si128(pb->sshift[i]);
+		v->dchan[i] = _mm_cvtsi32_si128(pb->dshift[i]);
+	}
+	v->ashift = _mm_cvtsi32_si128(pb->ashift);
+	v->rgbmask = _mm_set1_epi32(pb->rgbmask);
+	v->keepmask = _mm_set1_epi32(pb->keepmask);
+	v->round = _mm_set1_epi16((short)pb->round);
+}
+
+static __inline__ __m128i SDL_TARGETING("sse2")
+PixelAlphaSwizzleSSE2(const PixelAlphaBlendSSE2 *v, const PixelAlphaBlend *pb,
+                      __m128i s)
+{
+	const __m128i bytemask = _mm_set1_epi32(0xFF);
+	__m128i out;
+	int i;
+
+	if ( !pb->swizzle ) {
+		return _mm_and_si128(s, v->rgbmask);
+	}
+	out = _mm_setzero_si128();
+	for ( i = 0; i < 3; ++i ) {
+		__m128i c = _mm_and_si128(_mm_srl_epi32(s, v->schan[i]), bytemask);
+		out = _mm_or_si128(out, _mm_sll_epi32(c, v->dchan[i]));
+	}
+	return out;
+}
+
+/* Blend 2 pixels held in 16-bit lanes */
+static __inline__ __m128i SDL_TARGETING("sse2")
+BlendChannelsSSE2(__m128i s, __m128i d, __m128i a, __m128i round)
+{
+	const __m128i c256 = _mm_set1_epi16(256);
+	__m128i x = _mm_mullo_epi16(d, _mm_sub_epi16(c256, a));
+	x = _mm_add_epi16(x, _mm_mullo_epi16(s, a));
+	return _mm_srli_epi16(_mm_add_epi16(x, round), 8);
+}
+
+static void SDL_TARGETING("sse2")
+BlitPixelAlphaSSE2(SDL_BlitInfo *info, int fast)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	PixelAlphaBlend pb;
+	PixelAlphaBlendSSE2 v;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(0xFF);
+
+	SetupPixelAlphaBlend(&pb, info, fast);
+	SetupPixelAlphaBlendSSE2(&v, &pb);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 4 ) {
+			__m128i s = _mm_loadu_si128((__m128i *)srcp);
+			__m128i a = _mm_and_si128(_mm_srl_epi32(s, v.ashift), amask);
+			__m128i transparent = _mm_cmpeq_epi32(a, zero);
+			__m128i opaque = _mm_cmpeq_epi32(a, amask);
+			int tbits = _mm_movemask_epi8(transparent);
+
+			/* Skip runs of fully transparent pixels */
+			if ( tbits != 0xFFFF ) {
+				__m128i d = _mm_loadu_si128((__m128i *)dstp);
+				__m128i sw = PixelAlphaSwizzleSSE2(&v, &pb, s);
+				__m128i keep = _mm_and_si128(d, v.keepmask);
+				__m128i out;
+
+				if ( pb.opaque &&
+				     _mm_movemask_epi8(opaque) == 0xFFFF ) {
+					out = _mm_or_si128(sw, keep);
+				} else {
+					__m128i a16 = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+					__m128i alo = _mm_unpacklo_epi32(a16, a16);
+					__m128i ahi = _mm_unpackhi_epi32(a16, a16);
+					__m128i lo = BlendChannelsSSE2(
+					        _mm_unpacklo_epi8(sw, zero),
+					        _mm_unpacklo_epi8(d, zero), alo, v.round);
+					__m128i hi = BlendChannelsSSE2(
+					        _mm_unpackhi_epi8(sw, zero),
+					        _mm_unpackhi_epi8(d, zero), ahi, v.round);
+					out = _mm_and_si128(_mm_packus_epi16(lo, hi), v.rgbmask);
+					out = _mm_or_si128(out, keep);
+					if ( pb.opaque ) {
+						__m128i copy = _mm_or_si128(sw, keep);
+						out = _mm_or_si128(_mm_andnot_si128(opaque, out),
+						                   _mm_and_si128(opaque, copy));
+					}
+				}
+				if ( tbits ) {
+					out = _mm_or_si128(_mm_andnot_si128(transparent, out),
+					                   _mm_and_si128(transparent, d));
+				}
+				_mm_storeu_si128((__m128i *)dstp, out);
+			}
+			srcp += 4;
+			dstp += 4;
+			n -= 4;
+		}
+		PixelAlphaBlendTail(&pb, srcp, dstp, n);
+		srcp += n + srcskip;
+		dstp += n + dstskip;
+	}
+}
+
+/* fast ARGB888->(A)RGB888 blending with pixel alpha */
+static void SDL_TARGETING("sse2") BlitRGBtoRGBPixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitPixelAlphaSSE2(info, 1);
+}
+
+/* 32-bit N->N blending with pixel alpha, byte-sized channels */
+static void SDL_TARGETING("sse2") Blit32to32PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitPixelAlphaSSE2(info, 0);
+}
+
+/* Pack the low 16 bits of each 32-bit lane, without signed saturation */
+static __inline__ __m128i SDL_TARGETING("sse2")
+PackLow16SSE2(__m128i lo, __m128i hi)
+{
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+
+/* ARGB8888 -> RGB565/RGB555 with the 5-bit alpha of BlitARGBto565PixelAlpha */
+static __inline__ void SDL_TARGETING("sse2")
+BlitARGBto16PixelAlphaSSE2(SDL_BlitInfo *info, int rshift, int gbits)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c5 = _mm_set1_epi32(0x1F);
+	const __m128i gmask32 = _mm_set1_epi32((1 << gbits) - 1);
+	const __m128i gmask = _mm_set1_epi16((1 << gbits) - 1);
+	const __m128i rbmask = _mm_set1_epi16(0x1F);
+	const __m128i c32 = _mm_set1_epi16(32);
+	const __m128i opaque5 = _mm_set1_epi16(SDL_ALPHA_OPAQUE >> 3);
+	const __m128i rcount = _mm_cvtsi32_si128(rshift);
+	const __m128i gcount = _mm_cvtsi32_si128(16 - gbits);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 8 ) {
+			__m128i s0 = _mm_loadu_si128((__m128i *)srcp);
+			__m128i s1 = _mm_loadu_si128((__m128i *)(srcp + 4));
+			__m128i a = _mm_packs_epi32(_mm_srli_epi32(s0, 27),
+			                            _mm_srli_epi32(s1, 27));
+			__m128i transparent = _mm_cmpeq_epi16(a, zero);
+			int tbits = _mm_movemask_epi8(transparent);
+
+			if ( tbits != 0xFFFF ) {
+				__m128i d = _mm_loadu_si128((__m128i *)dstp);
+				__m128i sr, sg, sb, s, out;
+
+				sr = _mm_packs_epi32(
+				        _mm_and_si128(_mm_srli_epi32(s0, 19), c5),
+				        _mm_and_si128(_mm_srli_epi32(s1, 19), c5));
+				sg = _mm_packs_epi32(
+				        _mm_and_si128(_mm_srl_epi32(s0, gcount), gmask32),
+				        _mm_and_si128(_mm_srl_epi32(s1, gcount), gmask32));
+				sb = _mm_packs_epi32(
+				        _mm_and_si128(_mm_srli_epi32(s0, 3), c5),
+				        _mm_and_si128(_mm_srli_epi32(s1, 3), c5));
+				s = _mm_or_si128(_mm_sll_epi16(sr, rcount),
+				        _mm_or_si128(_mm_slli_epi16(sg, 5), sb));
+				if ( _mm_movemask_epi8(_mm_cmpeq_epi16(a, opaque5)) == 0xFFFF ) {
+					out = s;
+				} else {
+					__m128i ia = _mm_sub_epi16(c32, a);
+					__m128i dr = _mm_and_si128(_mm_srl_epi16(d, rcount), rbmask);
+					__m128i dg = _mm_and_si128(_mm_srli_epi16(d, 5), gmask);
+					__m128i db = _mm_and_si128(d, rbmask);
+					__m128i opaque = _mm_cmpeq_epi16(a, opaque5);
+					dr = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dr, ia),
+					                    _mm_mullo_epi16(sr, a)), 5);
+					dg = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dg, ia),
+					                    _mm_mullo_epi16(sg, a)), 5);
+					db = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(db, ia),
+					                    _mm_mullo_epi16(sb, a)), 5);
+					out = _mm_or_si128(_mm_sll_epi16(dr, rcount),
+					        _mm_or_si128(_mm_slli_epi16(dg, 5), db));
+					out = _mm_or_si128(_mm_andnot_si128(opaque, out),
+					                   _mm_and_si128(opaque, s));
+				}
+				if ( tbits ) {
+					out = _mm_or_si128(_mm_andnot_si128(transparent, out),
+					                   _mm_and_si128(transparent, d));
+				}
+				_mm_storeu_si128((__m128i *)dstp, out);
+			}
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		PixelAlphaBlendTail16(srcp, dstp, n, rshift, gbits);
+		srcp += n + srcskip;
+		dstp += n + dstskip;
+	}
+}
+
+static void SDL_TARGETING("sse2") BlitARGBto565PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaSSE2(info, 11, 6);
+}
+
+static void SDL_TARGETING("sse2") BlitARGBto555PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaSSE2(info, 10, 5);
+}
+#endif /* SDL_SSE2_BLITTERS */
+
+#if SDL_AVX2_BLITTERS
+static void SDL_TARGETING("avx2")
+BlitPixelAlphaAVX2(SDL_BlitInfo *info, int fast)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	PixelAlphaBlend pb;
+	Uint8 control[3][32];
+	__m256i swizzle, alo_shuf, ahi_shuf, rgbmask, keepmask, round;
+	__m128i ashift;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c255 = _mm256_set1_epi32(0xFF);
+	const __m256i c256 = _mm256_set1_epi16(256);
+	int i, j;
+
+	SetupPixelAlphaBlend(&pb, info, fast);
+
+	/* Byte shuffles moving RGB into place, and spreading the alpha of
+	   pixels 0,1 (alo) and 2,3 (ahi) of each lane over 16-bit channels */
+	for ( i = 0; i < 32; i += 4 ) {
+		for ( j = 0; j < 4; ++j ) {
+			control[0][i + j] = 0x80;
+		}
+		for ( j = 0; j < 3; ++j ) {
+			control[0][i + pb.dshift[j] / 8] =
+			        (Uint8)(i % 16 + pb.sshift[j] / 8);
+		}
+	}
+	for ( i = 0; i < 32; i += 2 ) {
+		control[1][i] = (Uint8)(i % 16 / 8 * 4 + pb.ashift / 8);
+		control[2][i] = (Uint8)(control[1][i] + 8);
+		control[1][i + 1] = control[2][i + 1] = 0x80;
+	}
+	swizzle = _mm256_loadu_si256((__m256i *)control[0]);
+	alo_shuf = _mm256_loadu_si256((__m256i *)control[1]);
+	ahi_shuf = _mm256_loadu_si256((__m256i *)control[2]);
+	ashift = _mm_cvtsi32_si128(pb.ashift);
+	rgbmask = _mm256_set1_epi32(pb.rgbmask);
+	keepmask = _mm256_set1_epi32(pb.keepmask);
+	round = _mm256_set1_epi16((short)pb.round);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 8 ) {
+			__m256i s = _mm256_loadu_si256((__m256i *)srcp);
+			__m256i a = _mm256_and_si256(_mm256_srl_epi32(s, ashift), c255);
+			__m256i transparent = _mm256_cmpeq_epi32(a, zero);
+			__m256i opaque = _mm256_cmpeq_epi32(a, c255);
+			int tbits = _mm256_movemask_epi8(transparent);
+
+			/* Skip runs of fully transparent pixels */
+			if ( tbits != -1 ) {
+				__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+				__m256i sw, keep, out;
+
+				if ( pb.swizzle ) {
+					sw = _mm256_shuffle_epi8(s, swizzle);
+				} else {
+					sw = _mm256_and_si256(s, rgbmask);
+				}
+				keep = _mm256_and_si256(d, keepmask);
+				if ( pb.opaque && _mm256_movemask_epi8(opaque) == -1 ) {
+					out = _mm256_or_si256(sw, keep);
+				} else {
+					__m256i alo = _mm256_shuffle_epi8(s, alo_shuf);
+					__m256i ahi = _mm256_shuffle_epi8(s, ahi_shuf);
+					__m256i lo, hi;
+					lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero),
+					                        _mm256_sub_epi16(c256, alo));
+					lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(
+					        _mm256_unpacklo_epi8(sw, zero), alo));
+					lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+					hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero),
+					                        _mm256_sub_epi16(c256, ahi));
+					hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(
+					        _mm256_unpackhi_epi8(sw, zero), ahi));
+					hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+					out = _mm256_and_si256(_mm256_packus_epi16(lo, hi), rgbmask);
+					out = _mm256_or_si256(out, keep);
+					if ( pb.opaque ) {
+						out = _mm256_blendv_epi8(out,
+						        _mm256_or_si256(sw, keep), opaque);
+					}
+				}
+				if ( tbits ) {
+					out = _mm256_blendv_epi8(out, d, transparent);
+				}
+				_mm256_storeu_si256((__m256i *)dstp, out);
+			}
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		PixelAlphaBlendTail(&pb, srcp, dstp, n);
+		srcp += n + srcskip;
+		dstp += n + dstskip;
+	}
+}
+
+static void SDL_TARGETING("avx2") BlitRGBtoRGBPixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitPixelAlphaAVX2(info, 1);
+}
+
+static void SDL_TARGETING("avx2") Blit32to32PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitPixelAlphaAVX2(info, 0);
+}
+
+static __inline__ void SDL_TARGETING("avx2")
+BlitARGBto16PixelAlphaAVX2(SDL_BlitInfo *info, int rshift, int gbits)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c5 = _mm256_set1_epi32(0x1F);
+	const __m256i gmask32 = _mm256_set1_epi32((1 << gbits) - 1);
+	const __m256i gmask = _mm256_set1_epi16((1 << gbits) - 1);
+	const __m256i rbmask = _mm256_set1_epi16(0x1F);
+	const __m256i c32 = _mm256_set1_epi16(32);
+	const __m256i opaque5 = _mm256_set1_epi16(SDL_ALPHA_OPAQUE >> 3);
+	const __m128i rcount = _mm_cvtsi32_si128(rshift);
+	const __m128i gcount = _mm_cvtsi32_si128(16 - gbits);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 16 ) {
+			__m256i s0 = _mm256_loadu_si256((__m256i *)srcp);
+			__m256i s1 = _mm256_loadu_si256((__m256i *)(srcp + 8));
+			__m256i a, transparent, opaque;
+			int tbits;
+
+			/* packs works within 128-bit lanes, so fix up the order */
+#define PACK16(lo, hi) _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8)
+			a = PACK16(_mm256_srli_epi32(s0, 27), _mm256_srli_epi32(s1, 27));
+			transparent = _mm256_cmpeq_epi16(a, zero);
+			opaque = _mm256_cmpeq_epi16(a, opaque5);
+			tbits = _mm256_movemask_epi8(transparent);
+
+			if ( tbits != -1 ) {
+				__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+				__m256i sr, sg, sb, s, out;
+
+				sr = PACK16(_mm256_and_si256(_mm256_srli_epi32(s0, 19), c5),
+				            _mm256_and_si256(_mm256_srli_epi32(s1, 19), c5));
+				sg = PACK16(_mm256_and_si256(_mm256_srl_epi32(s0, gcount), gmask32),
+				            _mm256_and_si256(_mm256_srl_epi32(s1, gcount), gmask32));
+				sb = PACK16(_mm256_and_si256(_mm256_srli_epi32(s0, 3), c5),
+				            _mm256_and_si256(_mm256_srli_epi32(s1, 3), c5));
+#undef PACK16
+				s = _mm256_or_si256(_mm256_sll_epi16(sr, rcount),
+				        _mm256_or_si256(_mm256_slli_epi16(sg, 5), sb));
+				if ( _mm256_movemask_epi8(opaque) == -1 ) {
+					out = s;
+				} else {
+					__m256i ia = _mm256_sub_epi16(c32, a);
+					__m256i dr = _mm256_and_si256(_mm256_srl_epi16(d, rcount), rbmask);
+					__m256i dg = _mm256_and_si256(_mm256_srli_epi16(d, 5), gmask);
+					__m256i db = _mm256_and_si256(d, rbmask);
+					dr = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(dr, ia),
+					                       _mm256_mullo_epi16(sr, a)), 5);
+					dg = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(dg, ia),
+					                       _mm256_mullo_epi16(sg, a)), 5);
+					db = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(db, ia),
+					                       _mm256_mullo_epi16(sb, a)), 5);
+					out = _mm256_or_si256(_mm256_sll_epi16(dr, rcount),
+					        _mm256_or_si256(_mm256_slli_epi16(dg, 5), db));
+					out = _mm256_blendv_epi8(out, s, opaque);
+				}
+				if ( tbits ) {
+					out = _mm256_blendv_epi8(out, d, transparent);
+				}
+				_mm256_storeu_si256((__m256i *)dstp, out);
+			}
+			srcp += 16;
+			dstp += 16;
+			n -= 16;
+		}
+		PixelAlphaBlendTail16(srcp, dstp, n, rshift, gbits);
+		srcp += n + srcskip;
+		dstp += n + dstskip;
+	}
+}
+
+static void SDL_TARGETING("avx2") BlitARGBto565PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaAVX2(info, 11, 6);
+}
+
+static void SDL_TARGETING("avx2") BlitARGBto555PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaAVX2(info, 10, 5);
+}
+#endif /* SDL_AVX2_BLITTERS */
+
+
 /* fast RGB888->(A)RGB888 blending with surface alpha=128 special case */
 static void BlitRGBtoRGBSurfaceAlpha128(SDL_BlitInfo *info)
 {
@@ -2896,6 +3458,22 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Gmask == 0xff00
 	       && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
 		   || (sf->Bmask == 0xff && df->Bmask == 0x1f))) {
+#if SDL_AVX2_BLITTERS
+		if(SDL_HasAVX2()) {
+		    if(df->Gmask == 0x7e0)
+			return BlitARGBto565PixelAlphaAVX2;
+		    else if(df->Gmask == 0x3e0)
+			return BlitARGBto555PixelAlphaAVX2;
+		}
+#endif
+#if SDL_SSE2_BLITTERS
+		if(SDL_HasSSE2()) {
+		    if(df->Gmask == 0x7e0)
+			return BlitARGBto565PixelAlphaSSE2;
+		    else if(df->Gmask == 0x3e0)
+			return BlitARGBto555PixelAlphaSSE2;
+		}
+#endif
 		if(df->Gmask == 0x7e0)
 		    return BlitARGBto565PixelAlpha;
 		else if(df->Gmask == 0x3e0)
@@ -2936,6 +3514,14 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 #if SDL_ARM_SIMD_BLITTERS
 			if (SDL_HasARMSIMD())
 				return BlitRGBtoRGBPixelAlphaARMSIMD;
+#endif
+#if SDL_AVX2_BLITTERS
+			if (SDL_HasAVX2())
+				return BlitRGBtoRGBPixelAlphaAVX2;
+#endif
+#if SDL_SSE2_BLITTERS
+			if (SDL_HasSSE2())
+				return BlitRGBtoRGBPixelAlphaSSE2;
 #endif
 			return BlitRGBtoRGBPixelAlpha;
 		}
@@ -2945,6 +3531,16 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	        !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_HasAltiVec())
 		return Blit32to32PixelAlphaAltivec;
 	    else
+#endif
+#if SDL_SSE2_BLITTERS
+	    if (sf->Amask && PixelAlphaFormatOK(sf) && PixelAlphaFormatOK(df)) {
+#if SDL_AVX2_BLITTERS
+		if (SDL_HasAVX2())
+		    return Blit32to32PixelAlphaAVX2;
+#endif
+		if (SDL_HasSSE2())
+		    return Blit32to32PixelAlphaSSE2;
+	    }
 #endif
 		return BlitNtoNPixelAlpha;
 
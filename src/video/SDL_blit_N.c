@@ -41,7 +41,9 @@ enum blit_features {
 	BLIT_FEATURE_HAS_MMX = 1,
 	BLIT_FEATURE_HAS_ALTIVEC = 2,
 	BLIT_FEATURE_ALTIVEC_DONT_USE_PREFETCH = 4,
-	BLIT_FEATURE_HAS_ARM_SIMD = 8
+	BLIT_FEATURE_HAS_ARM_SIMD = 8,
+	BLIT_FEATURE_HAS_SSE2 = 16,
+	BLIT_FEATURE_HAS_AVX2 = 32
 };
 
 #if SDL_ALTIVEC_BLITTERS
@@ -906,7 +908,8 @@ static enum blit_features GetBlitFeatures( void )
 #endif
 #else
 /* Feature 1 is has-MMX */
-#define GetBlitFeatures() ((SDL_HasMMX() ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_HasARMSIMD() ? BLIT_FEATURE_HAS_ARM_SIMD : 0))
+#define GetBlitFeatures() ((SDL_HasMMX() ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_HasARMSIMD() ? BLIT_FEATURE_HAS_ARM_SIMD : 0) | \
+                           (SDL_HasSSE2() ? BLIT_FEATURE_HAS_SSE2 : 0) | (SDL_HasAVX2() ? BLIT_FEATURE_HAS_AVX2 : 0))
 #endif
 
 #if SDL_ARM_SIMD_BLITTERS
@@ -939,6 +942,406 @@ static void Blit_RGB444_RGB888ARMSIMD(SDL_BlitInfo *info)
 }
 #endif
 
+#if SDL_SSE2_BLITTERS
+/*
+ * x86 SSE2/AVX2 N->N converters.
+ *
+ * For 16- and 32-bit layouts whose channels are at most 8 bits wide,
+ * DISEMBLE_RGB followed by ASSEMBLE_RGBA boils down to masking the source
+ * bits that survive and shifting them by a fixed distance per channel.
+ * Channels moving by the same distance share one mask, so a swizzle or a
+ * 888->565 pack costs two or three mask-and-shift steps per vector.  The
+ * results are identical to BlitNtoN/BlitNtoNCopyAlpha.  16-bit pixels are
+ * widened to 32-bit lanes on load and narrowed again on store.
+ */
+typedef struct {
+	Uint32 keep;		/* bits that stay where they are */
+	Uint32 lmask[4];	/* bits moving up, grouped by distance */
+	Uint32 lshift[4];
+	int lmoves;
+	Uint32 rmask[4];	/* bits moving down, grouped by distance */
+	Uint32 rshift[4];
+	int rmoves;
+	Uint32 fill;		/* constant bits, e.g. the per-surface alpha */
+	Uint32 ckey;		/* colorkey, already masked with rgbmask */
+	Uint32 rgbmask;
+	int srcbpp;
+	int dstbpp;
+} VectorBlit;
+
+static int VectorFormatOK(const SDL_PixelFormat *fmt)
+{
+	/* The loss fields wrap around for channels wider than 8 bits */
+	return (fmt->BytesPerPixel == 2 || fmt->BytesPerPixel == 4) &&
+	       fmt->Rloss <= 8 && fmt->Gloss <= 8 &&
+	       fmt->Bloss <= 8 && fmt->Aloss <= 8;
+}
+
+static void AddVectorMove(Uint32 *masks, Uint32 *shifts, int *moves,
+                          Uint32 mask, Uint32 shift)
+{
+	int i;
+	for ( i = 0; i < *moves; ++i ) {
+		if ( shifts[i] == shift ) {
+			masks[i] |= mask;
+			return;
+		}
+	}
+	masks[i] = mask;
+	shifts[i] = shift;
+	++*moves;
+}
+
+static void SetupVectorChannel(VectorBlit *vb,
+                               Uint32 smask, int sshift, int sloss,
+                               Uint32 dmask, int dshift, int dloss)
+{
+	Uint32 mask;
+	int distance;
+
+	if ( !smask || !dmask ) {
+		return;
+	}
+	/* ((pixel & smask) >> sshift << sloss) >> dloss << dshift */
+	if ( sloss >= dloss ) {
+		mask = smask;
+		distance = dshift + (sloss - dloss) - sshift;
+	} else {
+		mask = smask & (smask << (dloss - sloss));
+		distance = dshift - sshift - (dloss - sloss);
+	}
+	if ( distance > 0 ) {
+		AddVectorMove(vb->lmask, vb->lshift, &vb->lmoves, mask, distance);
+	} else if ( distance < 0 ) {
+		AddVectorMove(vb->rmask, vb->rshift, &vb->rmoves, mask, -distance);
+	} else {
+		vb->keep |= mask;
+	}
+}
+
+static void SetupVectorBlit(VectorBlit *vb, SDL_BlitInfo *info)
+{
+	SDL_PixelFormat *srcfmt = info->src;
+	SDL_PixelFormat *dstfmt = info->dst;
+
+	SDL_memset(vb, 0, sizeof(*vb));
+	vb->srcbpp = srcfmt->BytesPerPixel;
+	vb->dstbpp = dstfmt->BytesPerPixel;
+	vb->rgbmask = ~srcfmt->Amask;
+	vb->ckey = srcfmt->colorkey & vb->rgbmask;
+	SetupVectorChannel(vb, srcfmt->Rmask, srcfmt->Rshift, srcfmt->Rloss,
+	                   dstfmt->Rmask, dstfmt->Rshift, dstfmt->Rloss);
+	SetupVectorChannel(vb, srcfmt->Gmask, srcfmt->Gshift, srcfmt->Gloss,
+	                   dstfmt->Gmask, dstfmt->Gshift, dstfmt->Gloss);
+	SetupVectorChannel(vb, srcfmt->Bmask, srcfmt->Bshift, srcfmt->Bloss,
+	                   dstfmt->Bmask, dstfmt->Bshift, dstfmt->Bloss);
+	if ( srcfmt->Amask && dstfmt->Amask ) {
+		/* COPY_ALPHA, as in BlitNtoNCopyAlpha */
+		SetupVectorChannel(vb,
+		                   srcfmt->Amask, srcfmt->Ashift, srcfmt->Aloss,
+		                   dstfmt->Amask, dstfmt->Ashift, dstfmt->Aloss);
+	} else if ( dstfmt->Amask ) {
+		/* SET_ALPHA, as in BlitNtoN */
+		vb->fill = (srcfmt->alpha >> dstfmt->Aloss) << dstfmt->Ashift;
+	}
+}
+
+/* The C version of the vector conversion, for the row tails */
+static __inline__ Uint32 VectorConvertPixel(const VectorBlit *vb, Uint32 pixel)
+{
+	Uint32 out = vb->fill | (pixel & vb->keep);
+	int i;
+	for ( i = 0; i < vb->lmoves; ++i ) {
+		out |= (pixel & vb->lmask[i]) << vb->lshift[i];
+	}
+	for ( i = 0; i < vb->rmoves; ++i ) {
+		out |= (pixel & vb->rmask[i]) >> vb->rshift[i];
+	}
+	return out;
+}
+
+static __inline__ void VectorBlitTail(const VectorBlit *vb,
+                                      Uint8 *src, Uint8 *dst,
+                                      int width, int keyed)
+{
+	while ( width-- ) {
+		Uint32 pixel;
+		if ( vb->srcbpp == 2 ) {
+			pixel = *(Uint16 *)src;
+		} else {
+			pixel = *(Uint32 *)src;
+		}
+		if ( !keyed || (pixel & vb->rgbmask) != vb->ckey ) {
+			pixel = VectorConvertPixel(vb, pixel);
+			if ( vb->dstbpp == 2 ) {
+				*(Uint16 *)dst = (Uint16)pixel;
+			} else {
+				*(Uint32 *)dst = pixel;
+			}
+		}
+		src += vb->srcbpp;
+		dst += vb->dstbpp;
+	}
+}
+
+typedef struct {
+	__m128i keep;
+	__m128i lmask[4];
+	__m128i lshift[4];
+	__m128i rmask[4];
+	__m128i rshift[4];
+	__m128i fill;
+	__m128i ckey;
+	__m128i rgbmask;
+} VectorBlitSSE2;
+
+static void SDL_TARGETING("sse2")
+SetupVectorBlitSSE2(VectorBlitSSE2 *v, const VectorBlit *vb)
+{
+	int i;
+	for ( i = 0; i < 4; ++i ) {
+		v->lmask[i] = _mm_set1_epi32(vb->lmask[i]);
+		v->lshift[i] = _mm_cvtsi32_si128(vb->lshift[i]);
+		v->rmask[i] = _mm_set1_epi32(vb->rmask[i]);
+		v->rshift[i] = _mm_cvtsi32_si128(vb->rshift[i]);
+	}
+	v->keep = _mm_set1_epi32(vb->keep);
+	v->fill = _mm_set1_epi32(vb->fill);
+	v->ckey = _mm_set1_epi32(vb->ckey);
+	v->rgbmask = _mm_set1_epi32(vb->rgbmask);
+}
+
+static __inline__ __m128i SDL_TARGETING("sse2")
+ConvertPixelsSSE2(const VectorBlitSSE2 *v, const VectorBlit *vb, __m128i pixels)
+{
+	__m128i out = _mm_or_si128(v->fill, _mm_and_si128(pixels, v->keep));
+	int i;
+	for ( i = 0; i < vb->lmoves; ++i ) {
+		__m128i c = _mm_and_si128(pixels, v->lmask[i]);
+		out = _mm_or_si128(out, _mm_sll_epi32(c, v->lshift[i]));
+	}
+	for ( i = 0; i < vb->rmoves; ++i ) {
+		__m128i c = _mm_and_si128(pixels, v->rmask[i]);
+		out = _mm_or_si128(out, _mm_srl_epi32(c, v->rshift[i]));
+	}
+	return out;
+}
+
+/* Pack the low 16 bits of each 32-bit lane, without signed saturation */
+static __inline__ __m128i SDL_TARGETING("sse2")
+Pack32to16SSE2(__m128i lo, __m128i hi)
+{
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+
+/* Converts 8 pixels per step; a colorkey keeps the destination pixels
+   whose source matches the key */
+static __inline__ void SDL_TARGETING("sse2")
+BlitNtoNVectorSSE2(SDL_BlitInfo *info, int keyed)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	VectorBlit vb;
+	VectorBlitSSE2 v;
+	const __m128i zero = _mm_setzero_si128();
+	__m128i klo = zero, khi = zero;
+
+	SetupVectorBlit(&vb, info);
+	SetupVectorBlitSSE2(&v, &vb);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 8 ) {
+			__m128i lo, hi;
+			if ( vb.srcbpp == 2 ) {
+				__m128i s = _mm_loadu_si128((__m128i *)src);
+				lo = _mm_unpacklo_epi16(s, zero);
+				hi = _mm_unpackhi_epi16(s, zero);
+			} else {
+				lo = _mm_loadu_si128((__m128i *)src);
+				hi = _mm_loadu_si128((__m128i *)(src + 16));
+			}
+			if ( keyed ) {
+				klo = _mm_cmpeq_epi32(_mm_and_si128(lo, v.rgbmask), v.ckey);
+				khi = _mm_cmpeq_epi32(_mm_and_si128(hi, v.rgbmask), v.ckey);
+			}
+			lo = ConvertPixelsSSE2(&v, &vb, lo);
+			hi = ConvertPixelsSSE2(&v, &vb, hi);
+			if ( vb.dstbpp == 2 ) {
+				__m128i d = Pack32to16SSE2(lo, hi);
+				if ( keyed ) {
+					__m128i k = _mm_packs_epi32(klo, khi);
+					__m128i old = _mm_loadu_si128((__m128i *)dst);
+					d = _mm_or_si128(_mm_andnot_si128(k, d),
+					                 _mm_and_si128(k, old));
+				}
+				_mm_storeu_si128((__m128i *)dst, d);
+			} else {
+				if ( keyed ) {
+					__m128i oldlo = _mm_loadu_si128((__m128i *)dst);
+					__m128i oldhi = _mm_loadu_si128((__m128i *)(dst + 16));
+					lo = _mm_or_si128(_mm_andnot_si128(klo, lo),
+					                  _mm_and_si128(klo, oldlo));
+					hi = _mm_or_si128(_mm_andnot_si128(khi, hi),
+					                  _mm_and_si128(khi, oldhi));
+				}
+				_mm_storeu_si128((__m128i *)dst, lo);
+				_mm_storeu_si128((__m128i *)(dst + 16), hi);
+			}
+			src += 8 * vb.srcbpp;
+			dst += 8 * vb.dstbpp;
+			n -= 8;
+		}
+		VectorBlitTail(&vb, src, dst, n, keyed);
+		src += n * vb.srcbpp + srcskip;
+		dst += n * vb.dstbpp + dstskip;
+	}
+}
+
+static void SDL_TARGETING("sse2") BlitNtoNSSE2(SDL_BlitInfo *info)
+{
+	BlitNtoNVectorSSE2(info, 0);
+}
+
+static void SDL_TARGETING("sse2") BlitNtoNKeySSE2(SDL_BlitInfo *info)
+{
+	BlitNtoNVectorSSE2(info, 1);
+}
+#endif /* SDL_SSE2_BLITTERS */
+
+#if SDL_AVX2_BLITTERS
+typedef struct {
+	__m256i keep;
+	__m256i lmask[4];
+	__m128i lshift[4];
+	__m256i rmask[4];
+	__m128i rshift[4];
+	__m256i fill;
+	__m256i ckey;
+	__m256i rgbmask;
+} VectorBlitAVX2;
+
+static void SDL_TARGETING("avx2")
+SetupVectorBlitAVX2(VectorBlitAVX2 *v, const VectorBlit *vb)
+{
+	int i;
+	for ( i = 0; i < 4; ++i ) {
+		v->lmask[i] = _mm256_set1_epi32(vb->lmask[i]);
+		v->lshift[i] = _mm_cvtsi32_si128(vb->lshift[i]);
+		v->rmask[i] = _mm256_set1_epi32(vb->rmask[i]);
+		v->rshift[i] = _mm_cvtsi32_si128(vb->rshift[i]);
+	}
+	v->keep = _mm256_set1_epi32(vb->keep);
+	v->fill = _mm256_set1_epi32(vb->fill);
+	v->ckey = _mm256_set1_epi32(vb->ckey);
+	v->rgbmask = _mm256_set1_epi32(vb->rgbmask);
+}
+
+static __inline__ __m256i SDL_TARGETING("avx2")
+ConvertPixelsAVX2(const VectorBlitAVX2 *v, const VectorBlit *vb, __m256i pixels)
+{
+	__m256i out = _mm256_or_si256(v->fill, _mm256_and_si256(pixels, v->keep));
+	int i;
+	for ( i = 0; i < vb->lmoves; ++i ) {
+		__m256i c = _mm256_and_si256(pixels, v->lmask[i]);
+		out = _mm256_or_si256(out, _mm256_sll_epi32(c, v->lshift[i]));
+	}
+	for ( i = 0; i < vb->rmoves; ++i ) {
+		__m256i c = _mm256_and_si256(pixels, v->rmask[i]);
+		out = _mm256_or_si256(out, _mm256_srl_epi32(c, v->rshift[i]));
+	}
+	return out;
+}
+
+/* Pack 16 lanes down to 16 bits, fixing up the per-lane order of packs */
+static __inline__ __m256i SDL_TARGETING("avx2")
+Pack32to16AVX2(__m256i lo, __m256i hi)
+{
+	lo = _mm256_srai_epi32(_mm256_slli_epi32(lo, 16), 16);
+	hi = _mm256_srai_epi32(_mm256_slli_epi32(hi, 16), 16);
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+}
+
+/* Same as BlitNtoNVectorSSE2, 16 pixels per step */
+static __inline__ void SDL_TARGETING("avx2")
+BlitNtoNVectorAVX2(SDL_BlitInfo *info, int keyed)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	VectorBlit vb;
+	VectorBlitAVX2 v;
+	__m256i klo = _mm256_setzero_si256(), khi = klo;
+
+	SetupVectorBlit(&vb, info);
+	SetupVectorBlitAVX2(&v, &vb);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 16 ) {
+			__m256i lo, hi;
+			if ( vb.srcbpp == 2 ) {
+				lo = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)src));
+				hi = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)(src + 16)));
+			} else {
+				lo = _mm256_loadu_si256((__m256i *)src);
+				hi = _mm256_loadu_si256((__m256i *)(src + 32));
+			}
+			if ( keyed ) {
+				klo = _mm256_cmpeq_epi32(_mm256_and_si256(lo, v.rgbmask), v.ckey);
+				khi = _mm256_cmpeq_epi32(_mm256_and_si256(hi, v.rgbmask), v.ckey);
+			}
+			lo = ConvertPixelsAVX2(&v, &vb, lo);
+			hi = ConvertPixelsAVX2(&v, &vb, hi);
+			if ( vb.dstbpp == 2 ) {
+				__m256i d = Pack32to16AVX2(lo, hi);
+				if ( keyed ) {
+					__m256i k = _mm256_permute4x64_epi64(
+					        _mm256_packs_epi32(klo, khi), 0xD8);
+					__m256i old = _mm256_loadu_si256((__m256i *)dst);
+					d = _mm256_blendv_epi8(d, old, k);
+				}
+				_mm256_storeu_si256((__m256i *)dst, d);
+			} else {
+				if ( keyed ) {
+					__m256i oldlo = _mm256_loadu_si256((__m256i *)dst);
+					__m256i oldhi = _mm256_loadu_si256((__m256i *)(dst + 32));
+					lo = _mm256_blendv_epi8(lo, oldlo, klo);
+					hi = _mm256_blendv_epi8(hi, oldhi, khi);
+				}
+				_mm256_storeu_si256((__m256i *)dst, lo);
+				_mm256_storeu_si256((__m256i *)(dst + 32), hi);
+			}
+			src += 16 * vb.srcbpp;
+			dst += 16 * vb.dstbpp;
+			n -= 16;
+		}
+		VectorBlitTail(&vb, src, dst, n, keyed);
+		src += n * vb.srcbpp + srcskip;
+		dst += n * vb.dstbpp + dstskip;
+	}
+}
+
+static void SDL_TARGETING("avx2") BlitNtoNAVX2(SDL_BlitInfo *info)
+{
+	BlitNtoNVectorAVX2(info, 0);
+}
+
+static void SDL_TARGETING("avx2") BlitNtoNKeyAVX2(SDL_BlitInfo *info)
+{
+	BlitNtoNVectorAVX2(info, 1);
+}
+#endif /* SDL_AVX2_BLITTERS */
+
 /* This is now endian dependent */
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 #define HI	1
@@ -2404,6 +2807,205 @@ static void BlitNtoNCopyAlpha(SDL_BlitInfo *info)
 	}
 }
 
+/*
+ * Specialized versions of BlitNtoN and BlitNtoNCopyAlpha for the common
+ * 15/16/24/32-bit layouts, generated from the tables below so that every
+ * channel shift and mask is a compile time constant.  They are used in
+ * place of the generic blitters, and give exactly the same results.
+ *
+ * Each layout is the bytes per pixel, then the shift and number of bits
+ * of the red, green and blue channels.
+ */
+#define LAYOUT_RGB565	2, 11,5, 5,6, 0,5
+#define LAYOUT_BGR565	2, 0,5, 5,6, 11,5
+#define LAYOUT_RGB555	2, 10,5, 5,5, 0,5
+#define LAYOUT_BGR555	2, 0,5, 5,5, 10,5
+#define LAYOUT_RGB444	2, 8,4, 4,4, 0,4
+#define LAYOUT_RGB24	3, 16,8, 8,8, 0,8
+#define LAYOUT_BGR24	3, 0,8, 8,8, 16,8
+#define LAYOUT_XRGB8888	4, 16,8, 8,8, 0,8
+#define LAYOUT_XBGR8888	4, 0,8, 8,8, 16,8
+#define LAYOUT_RGBX8888	4, 24,8, 16,8, 8,8
+#define LAYOUT_BGRX8888	4, 8,8, 16,8, 24,8
+
+/* The layout pairs, except those always handled by other blitters */
+#define SPECIALIZED_BLITS(X)						\
+	X(RGB565, BGR565)	X(RGB565, RGB555)	X(RGB565, BGR555)	\
+	X(RGB565, RGB444)	X(RGB565, RGB24)	X(RGB565, BGR24)	\
+	X(BGR565, RGB565)	X(BGR565, RGB555)	X(BGR565, BGR555)	\
+	X(BGR565, RGB444)	X(BGR565, RGB24)	X(BGR565, BGR24)	\
+	X(BGR565, XRGB8888)	X(BGR565, XBGR8888)	X(BGR565, RGBX8888)	\
+	X(BGR565, BGRX8888)						\
+	X(RGB555, RGB565)	X(RGB555, BGR565)	X(RGB555, BGR555)	\
+	X(RGB555, RGB444)	X(RGB555, RGB24)	X(RGB555, BGR24)	\
+	X(RGB555, XRGB8888)	X(RGB555, XBGR8888)	X(RGB555, RGBX8888)	\
+	X(RGB555, BGRX8888)						\
+	X(BGR555, RGB565)	X(BGR555, BGR565)	X(BGR555, RGB555)	\
+	X(BGR555, RGB444)	X(BGR555, RGB24)	X(BGR555, BGR24)	\
+	X(BGR555, XRGB8888)	X(BGR555, XBGR8888)	X(BGR555, RGBX8888)	\
+	X(BGR555, BGRX8888)						\
+	X(RGB444, RGB565)	X(RGB444, BGR565)	X(RGB444, RGB555)	\
+	X(RGB444, BGR555)	X(RGB444, RGB24)	X(RGB444, BGR24)	\
+	X(RGB444, XRGB8888)	X(RGB444, XBGR8888)	X(RGB444, RGBX8888)	\
+	X(RGB444, BGRX8888)						\
+	X(RGB24, RGB565)	X(RGB24, BGR565)	X(RGB24, RGB555)	\
+	X(RGB24, BGR555)	X(RGB24, RGB444)				\
+	X(BGR24, RGB565)	X(BGR24, BGR565)	X(BGR24, RGB555)	\
+	X(BGR24, BGR555)	X(BGR24, RGB444)				\
+	X(XRGB8888, BGR565)	X(XRGB8888, RGB555)	X(XRGB8888, BGR555)	\
+	X(XRGB8888, RGB444)						\
+	X(XBGR8888, RGB565)	X(XBGR8888, BGR565)	X(XBGR8888, RGB555)	\
+	X(XBGR8888, BGR555)	X(XBGR8888, RGB444)				\
+	X(RGBX8888, RGB565)	X(RGBX8888, BGR565)	X(RGBX8888, RGB555)	\
+	X(RGBX8888, BGR555)	X(RGBX8888, RGB444)				\
+	X(BGRX8888, RGB565)	X(BGRX8888, BGR565)	X(BGRX8888, RGB555)	\
+	X(BGRX8888, BGR555)	X(BGRX8888, RGB444)
+
+#define CHANNEL_MASK(shift, bits)	(((1 << (bits)) - 1) << (shift))
+
+/* Move a channel as RGB_FROM_PIXEL followed by PIXEL_FROM_RGB would */
+#define CONVERT_CHANNEL(Pixel, sshift, sbits, dshift, dbits)		\
+	((((Pixel) >> (sshift)) & ((1 << (sbits)) - 1))			\
+	 << (8 - (sbits)) >> (8 - (dbits)) << (dshift))
+
+#define STORE_PIXEL(buf, bpp, Pixel)					\
+do {									\
+	switch (bpp) {							\
+		case 2:							\
+			*((Uint16 *)(buf)) = (Uint16)(Pixel);		\
+		break;							\
+									\
+		case 3:							\
+			if(SDL_BYTEORDER == SDL_LIL_ENDIAN) {		\
+				(buf)[0] = (Uint8)(Pixel);		\
+				(buf)[1] = (Uint8)((Pixel) >> 8);	\
+				(buf)[2] = (Uint8)((Pixel) >> 16);	\
+			} else {					\
+				(buf)[0] = (Uint8)((Pixel) >> 16);	\
+				(buf)[1] = (Uint8)((Pixel) >> 8);	\
+				(buf)[2] = (Uint8)(Pixel);		\
+			}						\
+		break;							\
+									\
+		case 4:							\
+			*((Uint32 *)(buf)) = (Pixel);			\
+		break;							\
+	}								\
+} while(0)
+
+/* The alpha channel is copied (COPY_ALPHA) or set (SET_ALPHA) with
+   values from the formats, as it isn't part of the layouts */
+typedef struct {
+	Uint32 Amask;
+	int Ashift;
+	int Aloss;
+	int dAloss;
+	int dAshift;
+	Uint32 Afill;
+} SpecializedAlpha;
+
+static void SetupSpecializedAlpha(SDL_BlitInfo *info, SpecializedAlpha *a)
+{
+	SDL_PixelFormat *srcfmt = info->src;
+	SDL_PixelFormat *dstfmt = info->dst;
+
+	SDL_memset(a, 0, sizeof(*a));
+	if ( !dstfmt->Amask ) {
+		return;
+	}
+	if ( srcfmt->Amask ) {
+		/* as BlitNtoNCopyAlpha */
+		a->Amask = srcfmt->Amask;
+		a->Ashift = srcfmt->Ashift;
+		a->Aloss = srcfmt->Aloss;
+		a->dAloss = dstfmt->Aloss;
+		a->dAshift = dstfmt->Ashift;
+	} else {
+		/* as BlitNtoN */
+		a->Afill = (srcfmt->alpha >> dstfmt->Aloss) << dstfmt->Ashift;
+	}
+}
+
+#define SPECIALIZED_BLIT_FUNC(name, sbpp, srs, srb, sgs, sgb, sbs, sbb,	\
+			      dbpp, drs, drb, dgs, dgb, dbs, dbb)	\
+static void name(SDL_BlitInfo *info)					\
+{									\
+	int width = info->d_width;					\
+	int height = info->d_height;					\
+	Uint8 *src = info->s_pixels;					\
+	int srcskip = info->s_skip;					\
+	Uint8 *dst = info->d_pixels;					\
+	int dstskip = info->d_skip;					\
+	SpecializedAlpha a;						\
+									\
+	SetupSpecializedAlpha(info, &a);				\
+	while ( height-- ) {						\
+		int n;							\
+		for ( n = width; n; --n ) {				\
+			Uint32 Pixel;					\
+			Uint32 out;					\
+			RETRIEVE_RGB_PIXEL(src, sbpp, Pixel);		\
+			out = CONVERT_CHANNEL(Pixel, srs, srb, drs, drb) | \
+			      CONVERT_CHANNEL(Pixel, sgs, sgb, dgs, dgb) | \
+			      CONVERT_CHANNEL(Pixel, sbs, sbb, dbs, dbb) | \
+			      (((((Pixel & a.Amask) >> a.Ashift) << a.Aloss) \
+			         >> a.dAloss) << a.dAshift) | a.Afill;	\
+			STORE_PIXEL(dst, dbpp, out);			\
+			src += sbpp;					\
+			dst += dbpp;					\
+		}							\
+		src += srcskip;						\
+		dst += dstskip;						\
+	}								\
+}
+
+#define SPECIALIZED_BLIT_ENTRY(sbpp, srs, srb, sgs, sgb, sbs, sbb,	\
+			       dbpp, drs, drb, dgs, dgb, dbs, dbb, name) \
+	{ sbpp, CHANNEL_MASK(srs, srb), CHANNEL_MASK(sgs, sgb),		\
+	  CHANNEL_MASK(sbs, sbb), dbpp, CHANNEL_MASK(drs, drb),		\
+	  CHANNEL_MASK(dgs, dgb), CHANNEL_MASK(dbs, dbb), name },
+
+/* Extra level of expansion, so the layouts are split into arguments */
+#define SPECIALIZED_BLIT_FUNC_(name, s, d)	SPECIALIZED_BLIT_FUNC(name, s, d)
+#define SPECIALIZED_BLIT_ENTRY_(s, d, name)	SPECIALIZED_BLIT_ENTRY(s, d, name)
+#define DEFINE_SPECIALIZED_BLIT(S, D)					\
+	SPECIALIZED_BLIT_FUNC_(Blit_##S##_to_##D, LAYOUT_##S, LAYOUT_##D)
+#define SPECIALIZED_BLIT(S, D)						\
+	SPECIALIZED_BLIT_ENTRY_(LAYOUT_##S, LAYOUT_##D, Blit_##S##_to_##D)
+
+SPECIALIZED_BLITS(DEFINE_SPECIALIZED_BLIT)
+
+static const struct {
+	int srcbpp;
+	Uint32 srcR, srcG, srcB;
+	int dstbpp;
+	Uint32 dstR, dstG, dstB;
+	SDL_loblit blitfunc;
+} specialized_blit[] = {
+	SPECIALIZED_BLITS(SPECIALIZED_BLIT)
+};
+
+/* Find a specialized replacement for BlitNtoN/BlitNtoNCopyAlpha */
+static SDL_loblit FindSpecializedBlit(SDL_PixelFormat *srcfmt,
+                                      SDL_PixelFormat *dstfmt)
+{
+	int i;
+
+	for ( i = 0; i < SDL_arraysize(specialized_blit); ++i ) {
+		if ( specialized_blit[i].srcbpp == srcfmt->BytesPerPixel &&
+		     specialized_blit[i].srcR == srcfmt->Rmask &&
+		     specialized_blit[i].srcG == srcfmt->Gmask &&
+		     specialized_blit[i].srcB == srcfmt->Bmask &&
+		     specialized_blit[i].dstbpp == dstfmt->BytesPerPixel &&
+		     specialized_blit[i].dstR == dstfmt->Rmask &&
+		     specialized_blit[i].dstG == dstfmt->Gmask &&
+		     specialized_blit[i].dstB == dstfmt->Bmask ) {
+			return specialized_blit[i].blitfunc;
+		}
+	}
+	return NULL;
+}
+
 static void BlitNto1Key(SDL_BlitInfo *info)
 {
 	int width = info->d_width;
@@ -3084,6 +3686,18 @@ static const struct blit_table normal_blit_2[] = {
       0, NULL, Blit_RGB565_RGBA8888, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
     { 0x0000F800,0x000007E0,0x0000001F, 4, 0x0000FF00,0x00FF0000,0xFF000000,
       0, NULL, Blit_RGB565_BGRA8888, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#if SDL_AVX2_BLITTERS
+    { 0x00000000,0x00000000,0x00000000, 2, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_AVX2, NULL, BlitNtoNAVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_AVX2, NULL, BlitNtoNAVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
+#if SDL_SSE2_BLITTERS
+    { 0x00000000,0x00000000,0x00000000, 2, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSE2, NULL, BlitNtoNSSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSE2, NULL, BlitNtoNSSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
 
     /* Default for 16-bit RGB source, used if no other blitter matches */
     { 0,0,0, 0, 0,0,0, 0, NULL, BlitNtoN, 0 }
@@ -3168,6 +3782,18 @@ static const struct blit_table normal_blit_4[] = {
 #if SDL_ARM_SIMD_BLITTERS
     { 0x000000FF,0x0000FF00,0x00FF0000, 4, 0x00FF0000,0x0000FF00,0x000000FF,
       BLIT_FEATURE_HAS_ARM_SIMD, NULL, Blit_BGR888_RGB888ARMSIMD, NO_ALPHA | COPY_ALPHA },
+#endif
+#if SDL_AVX2_BLITTERS
+    { 0x00000000,0x00000000,0x00000000, 2, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_AVX2, NULL, BlitNtoNAVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_AVX2, NULL, BlitNtoNAVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
+#if SDL_SSE2_BLITTERS
+    { 0x00000000,0x00000000,0x00000000, 2, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSE2, NULL, BlitNtoNSSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSE2, NULL, BlitNtoNSSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
 #endif
     { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
       0, NULL, Blit_RGB888_RGB565, NO_ALPHA },
@@ -3236,6 +3862,16 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 	       because RLE is the preferred fast way to deal with this.
 	       If a particular case turns out to be useful we'll add it. */
 
+#if SDL_AVX2_BLITTERS
+	    if((GetBlitFeatures() & BLIT_FEATURE_HAS_AVX2)
+	       && VectorFormatOK(srcfmt) && VectorFormatOK(dstfmt))
+		return BlitNtoNKeyAVX2;
+#endif
+#if SDL_SSE2_BLITTERS
+	    if((GetBlitFeatures() & BLIT_FEATURE_HAS_SSE2)
+	       && VectorFormatOK(srcfmt) && VectorFormatOK(dstfmt))
+		return BlitNtoNKeySSE2;
+#endif
 	    if(srcfmt->BytesPerPixel == 2
 	       && surface->map->identity)
 		return Blit2to2Key;
@@ -3278,8 +3914,14 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 	} else {
 		/* Now the meat, choose the blitter we want */
 		Uint32 a_need = NO_ALPHA;
+		Uint32 features = GetBlitFeatures();
 		if(dstfmt->Amask)
 		    a_need = srcfmt->Amask ? COPY_ALPHA : SET_ALPHA;
+#if SDL_SSE2_BLITTERS
+		/* The vector converters only handle channels up to 8 bits */
+		if(!VectorFormatOK(srcfmt) || !VectorFormatOK(dstfmt))
+		    features &= ~(BLIT_FEATURE_HAS_SSE2 | BLIT_FEATURE_HAS_AVX2);
+#endif
 		table = normal_blit[srcfmt->BytesPerPixel-1];
 		for ( which=0; table[which].dstbpp; ++which ) {
 			if ( MASKOK(srcfmt->Rmask, table[which].srcR) &&
@@ -3290,7 +3932,7 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 			    MASKOK(dstfmt->Bmask, table[which].dstB) &&
 			    dstfmt->BytesPerPixel == table[which].dstbpp &&
 			    (a_need & table[which].alpha) == a_need &&
-			    ((table[which].blit_features & GetBlitFeatures()) == table[which].blit_features) )
+			    ((table[which].blit_features & features) == table[which].blit_features) )
 				break;
 		}
 		sdata->aux_data = table[which].aux_data;
@@ -3316,6 +3958,12 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 			    blitfun = BlitNtoNCopyAlpha;
 			}
 		}
+		if(blitfun == BlitNtoN || blitfun == BlitNtoNCopyAlpha) {
+			SDL_loblit specialized = FindSpecializedBlit(srcfmt, dstfmt);
+			if ( specialized ) {
+				blitfun = specialized;
+			}
+		}
 	}
 
 #ifdef DEBUG_ASM
@@ -39,6 +39,7 @@ volatile int SDL_cursorstate = CURSOR_VISIBLE;
 SDL_Cursor *SDL_cursor = NULL;
 static SDL_Cursor *SDL_defcursor = NULL;
 SDL_mutex *SDL_cursorlock = NULL;
+Uint32 SDL_cursorvideodraws = 0;
 
 /* Public functions */
 void SDL_CursorQuit(void)
@@ -601,6 +602,9 @@ void SDL_DrawCursorNoLock(SDL_Surface *screen)
 	if ( (area.w == 0) || (area.h == 0) ) {
 		return;
 	}
+	if ( screen == SDL_VideoSurface ) {
+		++SDL_cursorvideodraws;
+	}
 
 	/* Copy mouse background */
 	{ int w, h, screenbpp;
@@ -670,6 +674,65 @@ void SDL_DrawCursor(SDL_Surface *screen)
 	}
 }
 
+/*
+ * Draw the part of the cursor inside 'rect' of the video surface, which
+ * was just refreshed from the shadow surface, saving the new background
+ * under it.  The rest of the cursor and its saved background are left
+ * alone.
+ */
+void SDL_DrawCursorRect(const SDL_Rect *rect)
+{
+	SDL_Surface *screen = SDL_VideoSurface;
+	SDL_Rect mouse, area;
+	int x1, y1, x2, y2;
+
+	SDL_MouseRect(&mouse);
+	x1 = (mouse.x > rect->x) ? mouse.x : rect->x;
+	y1 = (mouse.y > rect->y) ? mouse.y : rect->y;
+	x2 = (mouse.x+mouse.w < rect->x+rect->w) ? mouse.x+mouse.w : rect->x+rect->w;
+	y2 = (mouse.y+mouse.h < rect->y+rect->h) ? mouse.y+mouse.h : rect->y+rect->h;
+	if ( (x1 >= x2) || (y1 >= y2) ) {
+		return;
+	}
+	if ( SDL_MUSTLOCK(screen) ) {
+		if ( SDL_LockSurface(screen) < 0 ) {
+			return;
+		}
+	}
+
+	/* Copy this part of the mouse background */
+	{ int w, h, screenbpp;
+	  Uint8 *src, *dst;
+
+	  screenbpp = screen->format->BytesPerPixel;
+	  dst = SDL_cursor->save[0] +
+	        ((y1 - mouse.y) * mouse.w + (x1 - mouse.x)) * screenbpp;
+	  src = (Uint8 *)screen->pixels + y1 * screen->pitch +
+	                                  x1 * screenbpp;
+	  w = (x2 - x1) * screenbpp;
+	  for ( h = y2 - y1; h; --h ) {
+		  SDL_memcpy(dst, src, w);
+		  dst += mouse.w * screenbpp;
+		  src += screen->pitch;
+	  }
+	}
+
+	/* Draw this part of the mouse cursor */
+	area.x = x1 - SDL_cursor->area.x;
+	area.y = y1 - SDL_cursor->area.y;
+	area.w = x2 - x1;
+	area.h = y2 - y1;
+	if ( (area.x == 0) && (area.w == SDL_cursor->area.w) ) {
+		SDL_DrawCursorFast(screen, &area);
+	} else {
+		SDL_DrawCursorSlow(screen, &area);
+	}
+
+	if ( SDL_MUSTLOCK(screen) ) {
+		SDL_UnlockSurface(screen);
+	}
+}
+
 void SDL_EraseCursorNoLock(SDL_Surface *screen)
 {
 	SDL_Rect area;
@@ -679,6 +742,9 @@ void SDL_EraseCursorNoLock(SDL_Surface *screen)
 	if ( (area.w == 0) || (area.h == 0) ) {
 		return;
 	}
+	if ( screen == SDL_VideoSurface ) {
+		++SDL_cursorvideodraws;
+	}
 
 	/* Copy mouse background */
 	{ int w, h, screenbpp;
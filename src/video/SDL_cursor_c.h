@@ -30,6 +30,7 @@ extern void SDL_DrawCursor(SDL_Surface *screen);
 extern void SDL_DrawCursorNoLock(SDL_Surface *screen);
 extern void SDL_EraseCursor(SDL_Surface *screen);
 extern void SDL_EraseCursorNoLock(SDL_Surface *screen);
+extern void SDL_DrawCursorRect(const SDL_Rect *rect);
 extern void SDL_UpdateCursor(SDL_Surface *screen);
 extern void SDL_ResetCursor(void);
 extern void SDL_MoveCursor(int x, int y);
@@ -63,6 +64,9 @@ extern void SDL_UnlockCursor(void);
 extern SDL_Cursor *SDL_cursor;
 extern void SDL_MouseRect(SDL_Rect *area);
 
+/* Counts the times the cursor was drawn or erased on the video surface */
+extern Uint32 SDL_cursorvideodraws;
+
 /* State definitions for the SDL cursor */
 #define CURSOR_VISIBLE	0x01
 #define CURSOR_USINGSW	0x10
@@ -24,6 +24,7 @@
 /* General (mostly internal) pixel/color manipulation routines for SDL */
 
 #include "SDL_endian.h"
+#include "SDL_mutex.h"
 #include "SDL_video.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
@@ -336,22 +337,83 @@ Uint16 SDL_CalculatePitch(SDL_Surface *surface)
 	return((Uint16)pitch);
 }
 /*
- * Match an RGB value to a particular palette index
+ * Palette lookup cache.
+ *
+ * Palettes are searched linearly, which is slow when many colors are
+ * matched to the same palette, e.g. by SDL_MapRGB() in a loop.  Palettes
+ * that get searched often get an 8x8x8 grid of the RGB cube, listing for
+ * each cell the palette entries that can be the closest match to a color
+ * in that cell.  Searching that short list, in palette order, gives the
+ * same result as searching the whole palette.
+ *
+ * The palette colors can be changed in place by the application, so the
+ * cache keeps a copy of them and compares it on each lookup.
  */
-Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
+#define PALETTE_CACHE_ENTRIES	4
+#define PALETTE_CACHE_BUILD	256	/* Lookups before the grid is built */
+#define PALETTE_GRID_BITS	3
+#define PALETTE_GRID_CELLS	(1 << (3 * PALETTE_GRID_BITS))
+#define PALETTE_GRID_SHIFT	(8 - PALETTE_GRID_BITS)
+
+typedef struct SDL_PaletteCache {
+	SDL_Palette *pal;
+	int ncolors;
+	SDL_Color colors[256];
+	int lookups;
+	Uint32 *cells;		/* PALETTE_GRID_CELLS+1 offsets into list */
+	Uint8 *list;
+} SDL_PaletteCache;
+
+static SDL_PaletteCache SDL_palette_cache[PALETTE_CACHE_ENTRIES];
+static int SDL_palette_cache_next = 0;
+static int SDL_palette_cache_active = 0;
+static SDL_mutex *SDL_palette_cache_lock = NULL;
+
+void SDL_PaletteCacheInit(void)
+{
+	SDL_PaletteCacheQuit();
+#if !SDL_THREADS_DISABLED
+	SDL_palette_cache_lock = SDL_CreateMutex();
+	if ( SDL_palette_cache_lock == NULL ) {
+		return;
+	}
+#endif
+	SDL_palette_cache_active = 1;
+}
+
+void SDL_PaletteCacheQuit(void)
+{
+	int i;
+
+	SDL_palette_cache_active = 0;
+	for ( i=0; i<PALETTE_CACHE_ENTRIES; ++i ) {
+		if ( SDL_palette_cache[i].cells ) {
+			SDL_free(SDL_palette_cache[i].cells);
+		}
+		SDL_memset(&SDL_palette_cache[i], 0, sizeof(SDL_palette_cache[i]));
+	}
+	if ( SDL_palette_cache_lock != NULL ) {
+		SDL_DestroyMutex(SDL_palette_cache_lock);
+		SDL_palette_cache_lock = NULL;
+	}
+}
+
+static Uint8 SDL_FindColorLinear(const SDL_Color *colors, int ncolors,
+                                 const Uint8 *index, Uint8 r, Uint8 g, Uint8 b)
 {
 	/* Do colorspace distance matching */
 	unsigned int smallest;
 	unsigned int distance;
 	int rd, gd, bd;
-	int i;
+	int i, n;
 	Uint8 pixel=0;
 		
 	smallest = ~0;
-	for ( i=0; i<pal->ncolors; ++i ) {
-		rd = pal->colors[i].r - r;
-		gd = pal->colors[i].g - g;
-		bd = pal->colors[i].b - b;
+	for ( n=0; n<ncolors; ++n ) {
+		i = index ? index[n] : n;
+		rd = colors[i].r - r;
+		gd = colors[i].g - g;
+		bd = colors[i].b - b;
 		distance = (rd*rd)+(gd*gd)+(bd*bd);
 		if ( distance < smallest ) {
 			pixel = i;
@@ -364,6 +426,144 @@ Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
 	return(pixel);
 }
 
+/* Squared distance from a color channel to the nearest and farthest
+   values of a grid cell */
+#define CELL_DIST(v, lo, hi, near, far)				\
+{								\
+	int dlo = (v) - (lo), dhi = (v) - (hi);			\
+	near = (dlo < 0) ? dlo : (dhi > 0) ? dhi : 0;		\
+	far = (dlo*dlo > dhi*dhi) ? dlo : dhi;			\
+	near *= near;						\
+	far *= far;						\
+}
+
+static int SDL_BuildPaletteGrid(SDL_PaletteCache *cache)
+{
+	const int size = 1 << PALETTE_GRID_SHIFT;
+	unsigned int nearest[256], limit, far;
+	int cell, i, n, total;
+	Uint32 *cells;
+	Uint8 *list;
+
+	/* Worst case every cell lists the whole palette */
+	cells = (Uint32 *)SDL_malloc((PALETTE_GRID_CELLS + 1) * sizeof(Uint32) +
+	                             PALETTE_GRID_CELLS * cache->ncolors);
+	if ( cells == NULL ) {
+		return(-1);
+	}
+	list = (Uint8 *)(cells + PALETTE_GRID_CELLS + 1);
+
+	total = 0;
+	for ( cell=0; cell<PALETTE_GRID_CELLS; ++cell ) {
+		int r0 = (cell >> (2 * PALETTE_GRID_BITS)) * size;
+		int g0 = ((cell >> PALETTE_GRID_BITS) & ((1 << PALETTE_GRID_BITS) - 1)) * size;
+		int b0 = (cell & ((1 << PALETTE_GRID_BITS) - 1)) * size;
+
+		/* No color in the cell is farther than 'limit' from its best
+		   match, so entries nearer than that are the only candidates */
+		limit = ~0;
+		for ( i=0; i<cache->ncolors; ++i ) {
+			unsigned int rn, rf, gn, gf, bn, bf;
+			CELL_DIST(cache->colors[i].r, r0, r0 + size - 1, rn, rf);
+			CELL_DIST(cache->colors[i].g, g0, g0 + size - 1, gn, gf);
+			CELL_DIST(cache->colors[i].b, b0, b0 + size - 1, bn, bf);
+			nearest[i] = rn + gn + bn;
+			far = rf + gf + bf;
+			if ( far < limit ) {
+				limit = far;
+			}
+		}
+		cells[cell] = total;
+		for ( i=0; i<cache->ncolors; ++i ) {
+			if ( nearest[i] <= limit ) {
+				list[total++] = (Uint8)i;
+			}
+		}
+	}
+	cells[PALETTE_GRID_CELLS] = total;
+
+	/* Give back the unused space */
+	n = (PALETTE_GRID_CELLS + 1) * sizeof(Uint32) + total;
+	cache->cells = (Uint32 *)SDL_realloc(cells, n);
+	if ( cache->cells == NULL ) {
+		cache->cells = cells;
+	}
+	cache->list = (Uint8 *)(cache->cells + PALETTE_GRID_CELLS + 1);
+	return(0);
+}
+
+#undef CELL_DIST
+
+static int SDL_FindColorCached(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
+{
+	SDL_PaletteCache *cache = NULL;
+	size_t size = pal->ncolors * sizeof(SDL_Color);
+	int i, pixel;
+
+	for ( i=0; i<PALETTE_CACHE_ENTRIES; ++i ) {
+		if ( SDL_palette_cache[i].pal == pal ) {
+			cache = &SDL_palette_cache[i];
+			break;
+		}
+	}
+	if ( cache == NULL ) {
+		cache = &SDL_palette_cache[SDL_palette_cache_next];
+		SDL_palette_cache_next = (SDL_palette_cache_next + 1) %
+		                         PALETTE_CACHE_ENTRIES;
+		cache->pal = pal;
+		cache->ncolors = -1;
+	}
+	if ( (cache->ncolors != pal->ncolors) ||
+	     (SDL_memcmp(cache->colors, pal->colors, size) != 0) ) {
+		/* New or changed palette, start over */
+		if ( cache->cells ) {
+			SDL_free(cache->cells);
+			cache->cells = NULL;
+		}
+		cache->ncolors = pal->ncolors;
+		SDL_memcpy(cache->colors, pal->colors, size);
+		cache->lookups = 0;
+	}
+
+	if ( !cache->cells && (++cache->lookups >= PALETTE_CACHE_BUILD) ) {
+		if ( SDL_BuildPaletteGrid(cache) < 0 ) {
+			cache->lookups = 0;
+		}
+	}
+	if ( cache->cells ) {
+		int cell = ((r >> PALETTE_GRID_SHIFT) << (2 * PALETTE_GRID_BITS)) |
+		           ((g >> PALETTE_GRID_SHIFT) << PALETTE_GRID_BITS) |
+		           (b >> PALETTE_GRID_SHIFT);
+		pixel = SDL_FindColorLinear(cache->colors,
+		                            cache->cells[cell+1] - cache->cells[cell],
+		                            cache->list + cache->cells[cell], r, g, b);
+	} else {
+		pixel = SDL_FindColorLinear(pal->colors, pal->ncolors, NULL, r, g, b);
+	}
+	return(pixel);
+}
+
+/*
+ * Match an RGB value to a particular palette index
+ */
+Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
+{
+	int pixel;
+
+	if ( !SDL_palette_cache_active ||
+	     (pal->ncolors <= 0) || (pal->ncolors > 256) ) {
+		return SDL_FindColorLinear(pal->colors, pal->ncolors, NULL, r, g, b);
+	}
+	if ( SDL_palette_cache_lock && (SDL_mutexP(SDL_palette_cache_lock) < 0) ) {
+		return SDL_FindColorLinear(pal->colors, pal->ncolors, NULL, r, g, b);
+	}
+	pixel = SDL_FindColorCached(pal, r, g, b);
+	if ( SDL_palette_cache_lock ) {
+		SDL_mutexV(SDL_palette_cache_lock);
+	}
+	return((Uint8)pixel);
+}
+
 /* Find the opaque pixel value corresponding to an RGB triple */
 Uint32 SDL_MapRGB
 (const SDL_PixelFormat * const format,
@@ -43,4 +43,6 @@ extern void SDL_FreeBlitMap(SDL_BlitMap *map);
 extern Uint16 SDL_CalculatePitch(SDL_Surface *surface);
 extern void SDL_DitherColors(SDL_Color *colors, int bpp);
 extern Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b);
+extern void SDL_PaletteCacheInit(void);
+extern void SDL_PaletteCacheQuit(void);
 extern void SDL_ApplyGamma(Uint16 *gamma, SDL_Color *colors, SDL_Color *output, int ncolors);
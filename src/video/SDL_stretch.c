@@ -28,218 +28,504 @@
 */
 
 #include "SDL_video.h"
+#include "SDL_sysvideo.h"
+#include "SDL_cpuinfo.h"
 #include "SDL_blit.h"
+#include "SDL_stretch_c.h"
 
 /* This isn't ready for general consumption yet - it should be folded
    into the general blitting mechanism.
 */
 
-#if ((defined(_MSC_VER) && defined(_M_IX86)) || \
-     (defined(__GNUC__) && defined(__i386__))) && SDL_ASSEMBLY_ROUTINES
-/* There's a bug with gcc 4.4.1 and -O2 where srcp doesn't get the correct
- * value after the first scanline.  FIXME? */
-/*#define USE_ASM_STRETCH*/
-#endif
-
-#ifdef USE_ASM_STRETCH
+/* The column and row steps of the nearest neighbour stretch, using the
+   same 16.16 stepping as the original row copy code, so that the output
+   doesn't change.
+ */
+void SDL_StretchNearestTable(int *table, int src_len, int dst_len)
+{
+	int i, s;
+	Uint32 pos, inc;
 
-#ifdef __WIN32__
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#elif defined(HAVE_MPROTECT)
-#include <sys/types.h>
-#include <sys/mman.h>
-#else
-#undef USE_ASM_STRETCH
-#endif
-#ifdef __GNUC__
-#define PAGE_ALIGNED __attribute__((__aligned__(4096)))
-#elif defined(_MSC_VER)
-#define PAGE_ALIGNED __declspec(align(4096))
-#else
-#undef USE_ASM_STRETCH
-#endif
-#endif /**/
+	pos = 0x10000;
+	inc = ((Uint32)src_len << 16) / dst_len;
+	s = -1;
+	for ( i=0; i<dst_len; ++i ) {
+		while ( pos >= 0x10000L ) {
+			++s;
+			pos -= 0x10000L;
+		}
+		table[i] = s;
+		pos += inc;
+	}
+}
 
-#ifdef USE_ASM_STRETCH
-#define PREFIX16	0x66
-#define STORE_BYTE	0xAA
-#define STORE_WORD	0xAB
-#define LOAD_BYTE	0xAC
-#define LOAD_WORD	0xAD
-#define RETURN		0xC3
+/* The bilinear source position of each destination pixel center, as the
+   first source pixel and the weight (0-255) of the one after it.
+ */
+static void SDL_StretchLinearTable(int *table, Uint8 *weight,
+                                   int src_len, int dst_len)
+{
+	int i, pos;
+	double scale = (double)src_len / dst_len;
 
-static PAGE_ALIGNED unsigned char copy_row[4096];
+	for ( i=0; i<dst_len; ++i ) {
+		pos = (int)(((i + 0.5) * scale - 0.5) * 256.0);
+		if ( pos < 0 ) {
+			pos = 0;
+		}
+		if ( (pos >> 8) >= (src_len - 1) ) {
+			pos = (src_len - 1) << 8;
+		}
+		table[i] = pos >> 8;
+		weight[i] = (Uint8)(pos & 0xFF);
+	}
+}
 
-static int generate_rowbytes(int src_w, int dst_w, int bpp)
+/* The source pixels averaged into each destination pixel by the box filter
+   start at table[i] and end before table[i+1], or after one pixel when
+   enlarging (see BOX_END)
+ */
+static void SDL_StretchBoxTable(int *table, int src_len, int dst_len)
 {
-	static struct {
-		int bpp;
-		int src_w;
-		int dst_w;
-		int status;
-	} last;
-
 	int i;
-	int pos, inc;
-	unsigned char *eip, *fence;
-	unsigned char load, store;
-#ifdef  __WIN32__
-	DWORD oldprot;
-#endif
 
-	/* See if we need to regenerate the copy buffer */
-	if ( (src_w == last.src_w) &&
-	     (dst_w == last.dst_w) && (bpp == last.bpp) ) {
-		return(last.status);
+	for ( i=0; i<=dst_len; ++i ) {
+		table[i] = (int)(((Uint32)i * src_len) / dst_len);
 	}
-	last.bpp = bpp;
-	last.src_w = src_w;
-	last.dst_w = dst_w;
-	last.status = -1;
+}
+#define BOX_END(table, i) \
+	((table[(i)+1] > table[i]) ? table[(i)+1] : table[i] + 1)
+
+#if SDL_AVX2_BLITTERS
+static void SDL_TARGETING("avx2")
+SDL_StretchRowNearest4AVX2(const Uint32 *src, Uint32 *dst, const int *xtab, int w)
+{
+	while ( w >= 8 ) {
+		__m256i idx = _mm256_loadu_si256((const __m256i *)xtab);
+		_mm256_storeu_si256((__m256i *)dst,
+			_mm256_i32gather_epi32((const int *)src, idx, 4));
+		xtab += 8;
+		dst += 8;
+		w -= 8;
+	}
+	while ( w-- ) {
+		*dst++ = src[*xtab++];
+	}
+}
+#endif
+
+void SDL_StretchRowNearest(const Uint8 *src, Uint8 *dst,
+                           const int *xtab, int w, int bpp)
+{
+	int i;
 
 	switch (bpp) {
 	    case 1:
-		load = LOAD_BYTE;
-		store = STORE_BYTE;
+		for ( i=0; i<w; ++i ) {
+			dst[i] = src[xtab[i]];
+		}
 		break;
 	    case 2:
+		for ( i=0; i<w; ++i ) {
+			((Uint16 *)dst)[i] = ((const Uint16 *)src)[xtab[i]];
+		}
+		break;
+	    case 3:
+		for ( i=0; i<w; ++i ) {
+			const Uint8 *p = src + xtab[i]*3;
+			*dst++ = p[0];
+			*dst++ = p[1];
+			*dst++ = p[2];
+		}
+		break;
 	    case 4:
-		load = LOAD_WORD;
-		store = STORE_WORD;
+#if SDL_AVX2_BLITTERS
+		if ( SDL_HasAVX2() ) {
+			SDL_StretchRowNearest4AVX2((const Uint32 *)src,
+			                           (Uint32 *)dst, xtab, w);
+			break;
+		}
+#endif
+		for ( i=0; i<w; ++i ) {
+			((Uint32 *)dst)[i] = ((const Uint32 *)src)[xtab[i]];
+		}
 		break;
-	    default:
-		SDL_SetError("ASM stretch of %d bytes isn't supported\n", bpp);
-		return(-1);
 	}
-	/* Make the code writeable */
-#ifdef __WIN32__
-	if (!VirtualProtect(copy_row, sizeof(copy_row), PAGE_READWRITE, &oldprot)) {
-		SDL_SetError("Couldn't make copy buffer writeable");
-		return(-1);
+}
+
+/* 16-bit pixels are filtered as 8 bits per channel, in four byte pixels */
+static void SDL_StretchExpand16(const SDL_PixelFormat *fmt,
+                                const Uint16 *src, Uint8 *dst, int w)
+{
+	while ( w-- ) {
+		Uint32 pixel = *src++;
+		*dst++ = (Uint8)(((pixel & fmt->Rmask) >> fmt->Rshift) << fmt->Rloss);
+		*dst++ = (Uint8)(((pixel & fmt->Gmask) >> fmt->Gshift) << fmt->Gloss);
+		*dst++ = (Uint8)(((pixel & fmt->Bmask) >> fmt->Bshift) << fmt->Bloss);
+		*dst++ = (Uint8)(((pixel & fmt->Amask) >> fmt->Ashift) << fmt->Aloss);
 	}
-#elif defined(HAVE_MPROTECT)
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_WRITE) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer writeable");
-		return(-1);
+}
+
+static void SDL_StretchPack16(const SDL_PixelFormat *fmt,
+                              const Uint8 *src, Uint16 *dst, int w)
+{
+	while ( w-- ) {
+		*dst++ = (Uint16)
+		         ((((Uint32)src[0] >> fmt->Rloss) << fmt->Rshift) |
+		          (((Uint32)src[1] >> fmt->Gloss) << fmt->Gshift) |
+		          (((Uint32)src[2] >> fmt->Bloss) << fmt->Bshift) |
+		          ((((Uint32)src[3] >> fmt->Aloss) << fmt->Ashift) & fmt->Amask));
+		src += 4;
+	}
+}
+
+/* Blend two rows of bytes: dst = (a*(256-w) + b*w + 128) >> 8 */
+#if SDL_SSE2_BLITTERS
+static void SDL_TARGETING("sse2")
+SDL_StretchBlendRowsSSE2(const Uint8 *a, const Uint8 *b, Uint8 *dst, int n, int w)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i wa = _mm_set1_epi16((short)(256 - w));
+	__m128i wb = _mm_set1_epi16((short)w);
+	__m128i round = _mm_set1_epi16(128);
+
+	while ( n >= 16 ) {
+		__m128i va = _mm_loadu_si128((const __m128i *)a);
+		__m128i vb = _mm_loadu_si128((const __m128i *)b);
+		__m128i lo = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+		__m128i hi = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(lo, hi));
+		a += 16;
+		b += 16;
+		dst += 16;
+		n -= 16;
 	}
+	while ( n-- ) {
+		*dst++ = (Uint8)((*a++ * (256 - w) + *b++ * w + 128) >> 8);
+	}
+}
 #endif
-	pos = 0x10000;
-	inc = (src_w << 16) / dst_w;
-	eip = copy_row;
-	fence = copy_row+sizeof(copy_row)-2;
-	for ( i=0; i<dst_w; ++i ) {
-		while ( pos >= 0x10000L ) {
-			if ( eip == fence ) {
-				return -1;
-			}
-			if ( bpp == 2 ) {
-				*eip++ = PREFIX16;
-			}
-			*eip++ = load;
-			pos -= 0x10000L;
-		}
-		if ( eip == fence ) {
-			return -1;
+
+static void SDL_StretchBlendRows(const Uint8 *a, const Uint8 *b, Uint8 *dst, int n, int w)
+{
+#if SDL_SSE2_BLITTERS
+	if ( SDL_HasSSE2() ) {
+		SDL_StretchBlendRowsSSE2(a, b, dst, n, w);
+		return;
+	}
+#endif
+	while ( n-- ) {
+		*dst++ = (Uint8)((*a++ * (256 - w) + *b++ * w + 128) >> 8);
+	}
+}
+
+/* Horizontal bilinear pass.  The source row is padded with one pixel, so
+   the neighbour of the last pixel (with a weight of 0) can always be read.
+ */
+#if SDL_SSE2_BLITTERS
+static void SDL_TARGETING("sse2")
+SDL_StretchLinearRow4SSE2(const Uint8 *src, Uint8 *dst, const int *xtab,
+                          const Uint8 *xweight, int w)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i round = _mm_set1_epi16(128);
+
+	while ( w >= 4 ) {
+		__m128i p[4], m[4], lo, hi;
+		int i;
+
+		for ( i=0; i<4; ++i ) {
+			int x = xweight[i];
+			__m128i wv = _mm_set_epi16(x, x, x, x, 256-x, 256-x, 256-x, 256-x);
+			p[i] = _mm_loadl_epi64((const __m128i *)(src + xtab[i]*4));
+			m[i] = _mm_mullo_epi16(_mm_unpacklo_epi8(p[i], zero), wv);
 		}
-		if ( bpp == 2 ) {
-			*eip++ = PREFIX16;
+		lo = _mm_add_epi16(_mm_unpacklo_epi64(m[0], m[1]),
+		                   _mm_unpackhi_epi64(m[0], m[1]));
+		hi = _mm_add_epi16(_mm_unpacklo_epi64(m[2], m[3]),
+		                   _mm_unpackhi_epi64(m[2], m[3]));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(lo, hi));
+		xtab += 4;
+		xweight += 4;
+		dst += 16;
+		w -= 4;
+	}
+	while ( w-- ) {
+		const Uint8 *p = src + *xtab++ * 4;
+		int x = *xweight++;
+		*dst++ = (Uint8)((p[0] * (256 - x) + p[4] * x + 128) >> 8);
+		*dst++ = (Uint8)((p[1] * (256 - x) + p[5] * x + 128) >> 8);
+		*dst++ = (Uint8)((p[2] * (256 - x) + p[6] * x + 128) >> 8);
+		*dst++ = (Uint8)((p[3] * (256 - x) + p[7] * x + 128) >> 8);
+	}
+}
+#endif
+
+static void SDL_StretchLinearRow(const Uint8 *src, Uint8 *dst, const int *xtab,
+                                 const Uint8 *xweight, int w, int bpp)
+{
+	int i, c;
+
+#if SDL_SSE2_BLITTERS
+	if ( (bpp == 4) && SDL_HasSSE2() ) {
+		SDL_StretchLinearRow4SSE2(src, dst, xtab, xweight, w);
+		return;
+	}
+#endif
+	for ( i=0; i<w; ++i ) {
+		const Uint8 *p = src + xtab[i]*bpp;
+		int x = xweight[i];
+		for ( c=0; c<bpp; ++c ) {
+			*dst++ = (Uint8)((p[c] * (256 - x) + p[c+bpp] * x + 128) >> 8);
 		}
-		*eip++ = store;
-		pos += inc;
 	}
-	*eip++ = RETURN;
+}
 
-	/* Make the code executable but not writeable */
-#ifdef __WIN32__
-	if (!VirtualProtect(copy_row, sizeof(copy_row), PAGE_EXECUTE_READ, &oldprot)) {
-		SDL_SetError("Couldn't make copy buffer executable");
-		return(-1);
+/* Add a row of bytes into the box filter column sums */
+#if SDL_SSE2_BLITTERS
+static void SDL_TARGETING("sse2")
+SDL_StretchSumRowSSE2(const Uint8 *src, Uint32 *sum, int n)
+{
+	__m128i zero = _mm_setzero_si128();
+
+	while ( n >= 16 ) {
+		__m128i v = _mm_loadu_si128((const __m128i *)src);
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+		__m128i *s = (__m128i *)sum;
+		_mm_storeu_si128(s+0, _mm_add_epi32(_mm_loadu_si128(s+0), _mm_unpacklo_epi16(lo, zero)));
+		_mm_storeu_si128(s+1, _mm_add_epi32(_mm_loadu_si128(s+1), _mm_unpackhi_epi16(lo, zero)));
+		_mm_storeu_si128(s+2, _mm_add_epi32(_mm_loadu_si128(s+2), _mm_unpacklo_epi16(hi, zero)));
+		_mm_storeu_si128(s+3, _mm_add_epi32(_mm_loadu_si128(s+3), _mm_unpackhi_epi16(hi, zero)));
+		src += 16;
+		sum += 16;
+		n -= 16;
 	}
-#elif defined(HAVE_MPROTECT)
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_EXEC) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer executable");
-		return(-1);
+	while ( n-- ) {
+		*sum++ += *src++;
 	}
+}
 #endif
-	last.status = 0;
-	return(0);
+
+static void SDL_StretchSumRow(const Uint8 *src, Uint32 *sum, int n)
+{
+#if SDL_SSE2_BLITTERS
+	if ( SDL_HasSSE2() ) {
+		SDL_StretchSumRowSSE2(src, sum, n);
+		return;
+	}
+#endif
+	while ( n-- ) {
+		*sum++ += *src++;
+	}
 }
 
-#endif /* USE_ASM_STRETCH */
-
-#define DEFINE_COPY_ROW(name, type)			\
-void name(type *src, int src_w, type *dst, int dst_w)	\
-{							\
-	int i;						\
-	int pos, inc;					\
-	type pixel = 0;					\
-							\
-	pos = 0x10000;					\
-	inc = (src_w << 16) / dst_w;			\
-	for ( i=dst_w; i>0; --i ) {			\
-		while ( pos >= 0x10000L ) {		\
-			pixel = *src++;			\
-			pos -= 0x10000L;		\
-		}					\
-		*dst++ = pixel;				\
-		pos += inc;				\
-	}						\
+/* Average the column sums of 'rows' rows over the box of each pixel */
+static void SDL_StretchBoxRow(const Uint32 *sum, Uint8 *dst, const int *xtab,
+                              int w, int bpp, int rows)
+{
+	int i, c, x;
+
+	for ( i=0; i<w; ++i ) {
+		int x1 = xtab[i], x2 = BOX_END(xtab, i);
+		Uint32 n = (Uint32)(x2 - x1) * rows;
+		for ( c=0; c<bpp; ++c ) {
+			Uint32 total = 0;
+			if ( n <= 0x1010101 ) {
+				for ( x=x1; x<x2; ++x ) {
+					total += sum[x*bpp+c];
+				}
+				total = (total + n / 2) / n;
+			} else {
+				/* Average the rows first, so the sum can't overflow */
+				for ( x=x1; x<x2; ++x ) {
+					total += (sum[x*bpp+c] + rows / 2) / rows;
+				}
+				total = (total + (x2 - x1) / 2) / (x2 - x1);
+			}
+			*dst++ = (Uint8)total;
+		}
+	}
 }
-DEFINE_COPY_ROW(copy_row1, Uint8)
-DEFINE_COPY_ROW(copy_row2, Uint16)
-DEFINE_COPY_ROW(copy_row4, Uint32)
 
-/* The ASM code doesn't handle 24-bpp stretch blits */
-void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
+/* The scaling tables and row buffers of a stretch, kept between calls */
+struct SDL_StretchContext {
+	Uint32 flags;
+	int bpp;
+	int src_w, src_h;
+	int dst_w, dst_h;
+	Uint8 *mem;
+	size_t memsize;
+	int *xtab, *ytab;
+	Uint8 *xweight, *yweight;
+	Uint8 *row0, *row1, *vrow, *hrow;
+	Uint32 *sum;
+};
+
+SDL_StretchContext *SDL_CreateStretchContext(void)
 {
-	int i;
-	int pos, inc;
-	Uint8 pixel[3] = { 0, 0, 0 };
+	SDL_StretchContext *ctx;
 
-	pos = 0x10000;
-	inc = (src_w << 16) / dst_w;
-	for ( i=dst_w; i>0; --i ) {
-		while ( pos >= 0x10000L ) {
-			pixel[0] = *src++;
-			pixel[1] = *src++;
-			pixel[2] = *src++;
-			pos -= 0x10000L;
+	ctx = (SDL_StretchContext *)SDL_calloc(1, sizeof(*ctx));
+	if ( ctx == NULL ) {
+		SDL_OutOfMemory();
+	}
+	return(ctx);
+}
+
+void SDL_FreeStretchContext(SDL_StretchContext *ctx)
+{
+	if ( ctx ) {
+		SDL_free(ctx->mem);
+		SDL_free(ctx);
+	}
+}
+
+/* Build the tables and row buffers, unless they match the last stretch */
+static int SDL_SetupStretch(SDL_StretchContext *ctx, int bpp,
+                            SDL_Rect *srcrect, SDL_Rect *dstrect, Uint32 flags)
+{
+	size_t memsize;
+	int ebpp;
+
+	if ( ctx->mem && (ctx->flags == flags) && (ctx->bpp == bpp) &&
+	     (ctx->src_w == srcrect->w) && (ctx->src_h == srcrect->h) &&
+	     (ctx->dst_w == dstrect->w) && (ctx->dst_h == dstrect->h) ) {
+		return(0);
+	}
+
+	ebpp = (bpp == 2) ? 4 : bpp;
+	memsize = (dstrect->w + 1 + dstrect->h + 1) * sizeof(int);
+	if ( flags & SDL_STRETCH_BILINEAR ) {
+		memsize += dstrect->w + dstrect->h;
+		memsize += 2 * (srcrect->w + 1) * ebpp;	/* row0, row1 */
+		memsize += (srcrect->w + 1) * ebpp;	/* vrow */
+		memsize += dstrect->w * ebpp + 16;	/* hrow */
+	} else if ( flags & SDL_STRETCH_BOX ) {
+		memsize += srcrect->w * ebpp;		/* row0 */
+		memsize += dstrect->w * ebpp;		/* hrow */
+		memsize += srcrect->w * ebpp * sizeof(Uint32);
+	}
+	if ( memsize > ctx->memsize ) {
+		Uint8 *mem = (Uint8 *)SDL_realloc(ctx->mem, memsize);
+		if ( mem == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
 		}
-		*dst++ = pixel[0];
-		*dst++ = pixel[1];
-		*dst++ = pixel[2];
-		pos += inc;
+		ctx->mem = mem;
+		ctx->memsize = memsize;
 	}
+	ctx->flags = flags;
+	ctx->bpp = bpp;
+	ctx->src_w = srcrect->w;
+	ctx->src_h = srcrect->h;
+	ctx->dst_w = dstrect->w;
+	ctx->dst_h = dstrect->h;
+
+	ctx->xtab = (int *)ctx->mem;
+	ctx->ytab = ctx->xtab + dstrect->w + 1;
+	if ( flags & SDL_STRETCH_BILINEAR ) {
+		ctx->xweight = (Uint8 *)(ctx->ytab + dstrect->h + 1);
+		ctx->yweight = ctx->xweight + dstrect->w;
+		ctx->row0 = ctx->yweight + dstrect->h;
+		ctx->row1 = ctx->row0 + (srcrect->w + 1) * ebpp;
+		ctx->vrow = ctx->row1 + (srcrect->w + 1) * ebpp;
+		ctx->hrow = ctx->vrow + (srcrect->w + 1) * ebpp;
+		SDL_StretchLinearTable(ctx->xtab, ctx->xweight, srcrect->w, dstrect->w);
+		SDL_StretchLinearTable(ctx->ytab, ctx->yweight, srcrect->h, dstrect->h);
+		/* The padding pixel is never weighted, but is read */
+		SDL_memset(ctx->vrow + srcrect->w * ebpp, 0, ebpp);
+	} else if ( flags & SDL_STRETCH_BOX ) {
+		ctx->sum = (Uint32 *)(ctx->ytab + dstrect->h + 1);
+		ctx->row0 = (Uint8 *)(ctx->sum + srcrect->w * ebpp);
+		ctx->hrow = ctx->row0 + srcrect->w * ebpp;
+		SDL_StretchBoxTable(ctx->xtab, srcrect->w, dstrect->w);
+		SDL_StretchBoxTable(ctx->ytab, srcrect->h, dstrect->h);
+	} else {
+		SDL_StretchNearestTable(ctx->xtab, srcrect->w, dstrect->w);
+		SDL_StretchNearestTable(ctx->ytab, srcrect->h, dstrect->h);
+	}
+	return(0);
 }
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
-*/
+/* The nearest neighbour tables of stretches up to this size use the stack */
+#define STRETCH_STACK_TABLE	(2048 + 2)
+
+/* Perform a stretch blit between two surfaces of the same format */
 int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                     SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	SDL_StretchContext ctx;
+	int table[STRETCH_STACK_TABLE];
+	int w, h;
+	int retval;
+
+	SDL_memset(&ctx, 0, sizeof(ctx));
+	w = dstrect ? dstrect->w : dst->w;
+	h = dstrect ? dstrect->h : dst->h;
+	if ( (w + 1 + h + 1) <= SDL_arraysize(table) ) {
+		ctx.mem = (Uint8 *)table;
+		ctx.memsize = sizeof(table);
+	}
+	retval = SDL_SoftStretchContext(&ctx, src, srcrect, dst, dstrect,
+	                                SDL_STRETCH_NEAREST);
+	if ( ctx.mem != (Uint8 *)table ) {
+		SDL_free(ctx.mem);
+	}
+	return(retval);
+}
+
+int SDL_SoftStretchEx(SDL_Surface *src, SDL_Rect *srcrect,
+                      SDL_Surface *dst, SDL_Rect *dstrect, Uint32 flags)
+{
+	SDL_StretchContext ctx;
+	int retval;
+
+	SDL_memset(&ctx, 0, sizeof(ctx));
+	retval = SDL_SoftStretchContext(&ctx, src, srcrect, dst, dstrect, flags);
+	SDL_free(ctx.mem);
+	return(retval);
+}
+
+int SDL_SoftStretchContext(SDL_StretchContext *ctx,
+                           SDL_Surface *src, SDL_Rect *srcrect,
+                           SDL_Surface *dst, SDL_Rect *dstrect, Uint32 flags)
 {
 	int src_locked;
 	int dst_locked;
-	int pos, inc;
-	int dst_maxrow;
-	int src_row, dst_row;
-	Uint8 *srcp = NULL;
+	int dst_row;
+	int last_row;
+	const int *xtab, *ytab;
+	const Uint8 *xweight, *yweight;
+	Uint8 *row0, *row1, *vrow, *hrow;
+	Uint32 *sum;
+	Uint8 *srcp;
 	Uint8 *dstp;
+	int ebpp;
 	SDL_Rect full_src;
 	SDL_Rect full_dst;
-#ifdef USE_ASM_STRETCH
-	SDL_bool use_asm = SDL_TRUE;
-#ifdef __GNUC__
-	int u1, u2;
-#endif
-#endif /* USE_ASM_STRETCH */
 	const int bpp = dst->format->BytesPerPixel;
 
 	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
 		SDL_SetError("Only works with same format surfaces");
 		return(-1);
 	}
+	if ( flags & ~(SDL_STRETCH_BILINEAR|SDL_STRETCH_BOX) ) {
+		SDL_SetError("Unknown stretch flags");
+		return(-1);
+	}
+	if ( (flags & SDL_STRETCH_BILINEAR) && (flags & SDL_STRETCH_BOX) ) {
+		SDL_SetError("Only one stretch filter may be selected");
+		return(-1);
+	}
 
 	/* Verify the blit rectangles */
 	if ( srcrect ) {
@@ -270,6 +556,30 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 		full_dst.h = dst->h;
 		dstrect = &full_dst;
 	}
+	if ( !srcrect->w || !srcrect->h || !dstrect->w || !dstrect->h ) {
+		return(0);
+	}
+
+	/* Paletted pixels can't be filtered, and a 1:1 copy needs no filter */
+	if ( (bpp == 1) ||
+	     ((srcrect->w == dstrect->w) && (srcrect->h == dstrect->h)) ) {
+		flags = SDL_STRETCH_NEAREST;
+	}
+
+	/* Get the tables and row buffers for this stretch */
+	if ( SDL_SetupStretch(ctx, bpp, srcrect, dstrect, flags) < 0 ) {
+		return(-1);
+	}
+	ebpp = (bpp == 2) ? 4 : bpp;
+	xtab = ctx->xtab;
+	ytab = ctx->ytab;
+	xweight = ctx->xweight;
+	yweight = ctx->yweight;
+	row0 = ctx->row0;
+	row1 = ctx->row1;
+	vrow = ctx->vrow;
+	hrow = ctx->hrow;
+	sum = ctx->sum;
 
 	/* Lock the destination if it's in hardware */
 	dst_locked = 0;
@@ -293,76 +603,83 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 		src_locked = 1;
 	}
 
-	/* Set up the data... */
-	pos = 0x10000;
-	inc = (srcrect->h << 16) / dstrect->h;
-	src_row = srcrect->y;
-	dst_row = dstrect->y;
-
-#ifdef USE_ASM_STRETCH
-	/* Write the opcodes for this stretch */
-	if ( (bpp == 3) ||
-	     (generate_rowbytes(srcrect->w, dstrect->w, bpp) < 0) ) {
-		use_asm = SDL_FALSE;
-	}
-#endif
+#define SRC_ROW(n) ((Uint8 *)src->pixels + (srcrect->y + (n)) * src->pitch + \
+                    srcrect->x * bpp)
+#define DST_ROW(n) ((Uint8 *)dst->pixels + (dstrect->y + (n)) * dst->pitch + \
+                    dstrect->x * bpp)
 
 	/* Perform the stretch blit */
-	for ( dst_maxrow = dst_row+dstrect->h; dst_row<dst_maxrow; ++dst_row ) {
-		dstp = (Uint8 *)dst->pixels + (dst_row*dst->pitch)
-		                            + (dstrect->x*bpp);
-		while ( pos >= 0x10000L ) {
-			srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
-			                            + (srcrect->x*bpp);
-			++src_row;
-			pos -= 0x10000L;
-		}
-#ifdef USE_ASM_STRETCH
-		if (use_asm) {
-#ifdef __GNUC__
-			__asm__ __volatile__ (
-			"call *%4"
-			: "=&D" (u1), "=&S" (u2)
-			: "0" (dstp), "1" (srcp), "r" (copy_row)
-			: "memory" );
-#elif defined(_MSC_VER)
-		{ void *code = copy_row;
-			__asm {
-				push edi
-				push esi
-	
-				mov edi, dstp
-				mov esi, srcp
-				call dword ptr code
-
-				pop esi
-				pop edi
+	last_row = -1;
+	for ( dst_row=0; dst_row<dstrect->h; ++dst_row ) {
+		dstp = DST_ROW(dst_row);
+		if ( flags & SDL_STRETCH_BILINEAR ) {
+			int y = ytab[dst_row];
+			int w = yweight[dst_row];
+			Uint8 *r0, *r1;
+
+			if ( bpp == 2 ) {
+				/* Expand the rows once, the next pixel row often reuses them */
+				if ( y != last_row ) {
+					if ( (last_row >= 0) && (y == last_row + 1) ) {
+						Uint8 *tmp = row0;
+						row0 = row1;
+						row1 = tmp;
+					} else {
+						SDL_StretchExpand16(src->format, (Uint16 *)SRC_ROW(y), row0, srcrect->w);
+					}
+					if ( y + 1 < srcrect->h ) {
+						SDL_StretchExpand16(src->format, (Uint16 *)SRC_ROW(y+1), row1, srcrect->w);
+					}
+					last_row = y;
+				}
+				r0 = row0;
+				r1 = row1;
+			} else {
+				r0 = SRC_ROW(y);
+				r1 = (y + 1 < srcrect->h) ? SRC_ROW(y+1) : r0;
 			}
+			if ( w == 0 ) {
+				SDL_memcpy(vrow, r0, srcrect->w * ebpp);
+			} else {
+				SDL_StretchBlendRows(r0, r1, vrow, srcrect->w * ebpp, w);
+			}
+			if ( bpp == 2 ) {
+				SDL_StretchLinearRow(vrow, hrow, xtab, xweight, dstrect->w, ebpp);
+				SDL_StretchPack16(dst->format, hrow, (Uint16 *)dstp, dstrect->w);
+			} else {
+				SDL_StretchLinearRow(vrow, dstp, xtab, xweight, dstrect->w, ebpp);
+			}
+		} else if ( flags & SDL_STRETCH_BOX ) {
+			int y;
+
+			SDL_memset(sum, 0, srcrect->w * ebpp * sizeof(Uint32));
+			for ( y=ytab[dst_row]; y<BOX_END(ytab, dst_row); ++y ) {
+				srcp = SRC_ROW(y);
+				if ( bpp == 2 ) {
+					SDL_StretchExpand16(src->format, (Uint16 *)srcp, row0, srcrect->w);
+					srcp = row0;
+				}
+				SDL_StretchSumRow(srcp, sum, srcrect->w * ebpp);
+			}
+			y = BOX_END(ytab, dst_row) - ytab[dst_row];
+			if ( bpp == 2 ) {
+				SDL_StretchBoxRow(sum, hrow, xtab, dstrect->w, ebpp, y);
+				SDL_StretchPack16(dst->format, hrow, (Uint16 *)dstp, dstrect->w);
+			} else {
+				SDL_StretchBoxRow(sum, dstp, xtab, dstrect->w, ebpp, y);
+			}
+		} else if ( ytab[dst_row] == last_row ) {
+			/* Same source row as the previous line, copy it */
+			SDL_memcpy(dstp, DST_ROW(dst_row-1), dstrect->w * bpp);
+		} else {
+			last_row = ytab[dst_row];
+			SDL_StretchRowNearest(SRC_ROW(last_row), dstp, xtab, dstrect->w, bpp);
 		}
-#else
-#error Need inline assembly for this compiler
-#endif
-		} else
-#endif
-		switch (bpp) {
-		    case 1:
-			copy_row1(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 2:
-			copy_row2((Uint16 *)srcp, srcrect->w,
-			          (Uint16 *)dstp, dstrect->w);
-			break;
-		    case 3:
-			copy_row3(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 4:
-			copy_row4((Uint32 *)srcp, srcrect->w,
-			          (Uint32 *)dstp, dstrect->w);
-			break;
-		}
-		pos += inc;
 	}
 
+#undef SRC_ROW
+#undef DST_ROW
+
 	/* We need to unlock the surfaces if they're locked */
 	if ( dst_locked ) {
 		SDL_UnlockSurface(dst);
@@ -370,6 +687,8 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	if ( src_locked ) {
 		SDL_UnlockSurface(src);
 	}
+
+	SDL_AddDirtyRect(dst, dstrect);
 	return(0);
 }
 
@@ -21,9 +21,23 @@
 */
 #include "SDL_config.h"
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
-*/
+/* Perform a stretch blit between two surfaces of the same format */
 extern int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                            SDL_Surface *dst, SDL_Rect *dstrect);
 
+/* Perform a stretch blit with one of the SDL_STRETCH_* filters */
+extern int SDL_SoftStretchEx(SDL_Surface *src, SDL_Rect *srcrect,
+                             SDL_Surface *dst, SDL_Rect *dstrect, Uint32 flags);
+
+/* Perform a stretch blit, reusing the tables of the last one in 'ctx' */
+extern int SDL_SoftStretchContext(SDL_StretchContext *ctx,
+                                  SDL_Surface *src, SDL_Rect *srcrect,
+                                  SDL_Surface *dst, SDL_Rect *dstrect, Uint32 flags);
+
+/* The source pixel (or row) of each destination pixel of a nearest
+   neighbour stretch, for callers that produce their source rows on the fly */
+extern void SDL_StretchNearestTable(int *table, int src_len, int dst_len);
+
+/* Stretch one row with a table from SDL_StretchNearestTable() */
+extern void SDL_StretchRowNearest(const Uint8 *src, Uint8 *dst,
+                                  const int *xtab, int w, int bpp);
@@ -420,6 +420,8 @@ int SDL_LowerBlit (SDL_Surface *src, SDL_Rect *srcrect,
 		}
 	}
 
+	SDL_AddDirtyRect(dst, dstrect);
+
 	/* Figure out which blitter to use */
 	if ( (src->flags & SDL_HWACCEL) == SDL_HWACCEL ) {
 		if ( src == SDL_VideoSurface ) {
@@ -442,28 +444,16 @@ int SDL_LowerBlit (SDL_Surface *src, SDL_Rect *srcrect,
 }
 
 
-int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
-		   SDL_Surface *dst, SDL_Rect *dstrect)
+/*
+ * Clip a blit to the source surface and the destination clip rectangle,
+ * setting 'dstrect' to the final destination rectangle and 'sr' to the
+ * matching source rectangle.  Returns 0 if nothing is left to blit.
+ */
+static int SDL_ClipBlit (SDL_Surface *src, SDL_Rect *srcrect,
+			 SDL_Surface *dst, SDL_Rect *dstrect, SDL_Rect *sr)
 {
-        SDL_Rect fulldst;
 	int srcx, srcy, w, h;
 
-	/* Make sure the surfaces aren't locked */
-	if ( ! src || ! dst ) {
-		SDL_SetError("SDL_UpperBlit: passed a NULL surface");
-		return(-1);
-	}
-	if ( src->locked || dst->locked ) {
-		SDL_SetError("Surfaces must not be locked during blit");
-		return(-1);
-	}
-
-	/* If the destination rectangle is NULL, use the entire dest surface */
-	if ( dstrect == NULL ) {
-	        fulldst.x = fulldst.y = 0;
-		dstrect = &fulldst;
-	}
-
 	/* clip the source rectangle to the source surface */
 	if(srcrect) {
 	        int maxw, maxh;
@@ -523,17 +513,141 @@ int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
 	}
 
 	if(w > 0 && h > 0) {
-	        SDL_Rect sr;
-	        sr.x = srcx;
-		sr.y = srcy;
-		sr.w = dstrect->w = w;
-		sr.h = dstrect->h = h;
-		return SDL_LowerBlit(src, &sr, dst, dstrect);
+	        sr->x = srcx;
+		sr->y = srcy;
+		sr->w = dstrect->w = w;
+		sr->h = dstrect->h = h;
+		return 1;
 	}
 	dstrect->w = dstrect->h = 0;
 	return 0;
 }
 
+int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
+		   SDL_Surface *dst, SDL_Rect *dstrect)
+{
+        SDL_Rect fulldst;
+	SDL_Rect sr;
+
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_UpperBlit: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+
+	/* If the destination rectangle is NULL, use the entire dest surface */
+	if ( dstrect == NULL ) {
+	        fulldst.x = fulldst.y = 0;
+		dstrect = &fulldst;
+	}
+
+	if ( SDL_ClipBlit(src, srcrect, dst, dstrect, &sr) ) {
+		return SDL_LowerBlit(src, &sr, dst, dstrect);
+	}
+	return 0;
+}
+
+/*
+ * Perform a batch of blits onto one surface, keeping the destination
+ * locked across the software blits and setting up each source surface
+ * once per run of consecutive blits from it.
+ */
+int SDL_BlitSurfaces (SDL_Surface *dst, int numblits, SDL_BlitRequest *blits)
+{
+	SDL_Surface *src;
+	SDL_Rect sr;
+	int dst_locked, src_locked;
+	int run;	/* -1: skip this source, 0: SDL_LowerBlit, 1: software */
+	int retval;
+	int i;
+
+	if ( ! dst ) {
+		SDL_SetError("SDL_BlitSurfaces: passed a NULL surface");
+		return(-1);
+	}
+	if ( dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+
+	src = NULL;
+	dst_locked = src_locked = 0;
+	run = -1;
+	retval = 0;
+	for ( i = 0; i < numblits; ++i ) {
+		SDL_BlitRequest *blit = &blits[i];
+
+		if ( blit->src != src || ! src ) {
+			/* Set up the next run of blits from one surface */
+			if ( src_locked ) {
+				SDL_UnlockSurface(src);
+				src_locked = 0;
+			}
+			src = blit->src;
+			run = -1;
+			if ( ! src ) {
+				SDL_SetError("SDL_BlitSurfaces: passed a NULL surface");
+			} else if ( src->locked > ((src == dst) ? dst_locked : 0) ) {
+				SDL_SetError("Surfaces must not be locked during blit");
+			} else if ( ((src->map->dst != dst) ||
+			             (dst->format_version != src->map->format_version)) &&
+			            (SDL_MapSurface(src, dst) < 0) ) {
+				/* SDL_MapSurface() set the error */
+			} else if ( ((src->flags & SDL_HWACCEL) != SDL_HWACCEL) &&
+			            (src->map->sw_blit == SDL_SoftBlit) ) {
+				run = 1;
+				if ( ! dst_locked && SDL_MUSTLOCK(dst) ) {
+					if ( SDL_LockSurface(dst) < 0 ) {
+						run = -1;
+					} else {
+						dst_locked = 1;
+					}
+				}
+				if ( run > 0 && SDL_MUSTLOCK(src) ) {
+					if ( SDL_LockSurface(src) < 0 ) {
+						run = -1;
+					} else {
+						src_locked = 1;
+					}
+				}
+			} else {
+				/* Hardware and RLE blits handle their own locking */
+				run = 0;
+				if ( dst_locked ) {
+					SDL_UnlockSurface(dst);
+					dst_locked = 0;
+				}
+			}
+		}
+		if ( run < 0 ) {
+			blit->dstrect.w = blit->dstrect.h = 0;
+			retval = -1;
+			continue;
+		}
+
+		if ( SDL_ClipBlit(src, &blit->srcrect, dst, &blit->dstrect, &sr) ) {
+			if ( run > 0 ) {
+				SDL_AddDirtyRect(dst, &blit->dstrect);
+				SDL_SoftBlitLocked(src, &sr, dst, &blit->dstrect);
+			} else if ( SDL_LowerBlit(src, &sr, dst, &blit->dstrect) < 0 ) {
+				retval = -1;
+			}
+		}
+	}
+
+	if ( src_locked ) {
+		SDL_UnlockSurface(src);
+	}
+	if ( dst_locked ) {
+		SDL_UnlockSurface(dst);
+	}
+	return(retval);
+}
+
 static int SDL_FillRect1(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 {
 	/* FIXME: We have to worry about packing order.. *sigh* */
@@ -548,59 +662,183 @@ static int SDL_FillRect4(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 	return -1;
 }
 
-/* 
- * This function performs a fast fill of the given rectangle with 'color'
+#if SDL_SSE2_BLITTERS
+/*
+ * x86 SSE2/AVX2 fills.  The pixel bytes are repeated in a pattern whose
+ * period (48 or 96 bytes) is a multiple of 1, 2, 3 and 4 bytes, so every
+ * depth, 24-bit included, is filled with the same aligned vector stores.
+ * Fills larger than the last level cache use non-temporal stores, so that
+ * clearing a big buffer doesn't evict everything else from the cache.
  */
-int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+static void SDL_FillPattern(Uint32 *words, int len, int bpp, Uint32 color)
 {
-	SDL_VideoDevice *video = current_video;
-	SDL_VideoDevice *this  = current_video;
-	int x, y;
-	Uint8 *row;
-
-	/* This function doesn't work on surfaces < 8 bpp */
-	if ( dst->format->BitsPerPixel < 8 ) {
-		switch(dst->format->BitsPerPixel) {
-		    case 1:
-			return SDL_FillRect1(dst, dstrect, color);
-			break;
-		    case 4:
-			return SDL_FillRect4(dst, dstrect, color);
-			break;
-		    default:
-			SDL_SetError("Fill rect on unsupported surface format");
-			return(-1);
-			break;
+	Uint8 *pattern = (Uint8 *)words;
+	Uint32 w0, w1, w2;
+	int i, c, n;
+
+	/* The first 12 bytes hold a whole number of pixels of any depth,
+	   the rest repeats them a word at a time, since this runs for every
+	   fill.  'len' is a multiple of 4. */
+	for ( i = 0; i < 12; ) {
+		for ( c = 0; c < bpp; ++c ) {
+			pattern[i++] = (Uint8)(color >> (8 * c));
 		}
 	}
+	w0 = words[0];
+	w1 = words[1];
+	w2 = words[2];
+	n = len / 4;
+	for ( i = 3; i + 3 <= n; i += 3 ) {
+		words[i] = w0;
+		words[i+1] = w1;
+		words[i+2] = w2;
+	}
+	if ( i < n ) {
+		words[i++] = w0;
+	}
+	if ( i < n ) {
+		words[i] = w1;
+	}
+}
 
-	/* If 'dstrect' == NULL, then fill the whole surface */
-	if ( dstrect ) {
-		/* Perform clipping */
-		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
-			return(0);
-		}
-	} else {
-		dstrect = &dst->clip_rect;
+static int SDL_FillShouldStream(int w, int h, int bpp)
+{
+	int cachesize = SDL_GetCPUCacheSize();
+
+	if ( cachesize <= 0 ) {
+		cachesize = 8*1024*1024;
 	}
+	return ((double)w * bpp * h > cachesize);
+}
 
-	/* Check for hardware acceleration */
-	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
-					video->info.blit_fill ) {
-		SDL_Rect hw_rect;
-		if ( dst == SDL_VideoSurface ) {
-			hw_rect = *dstrect;
-			hw_rect.x += current_video->offset_x;
-			hw_rect.y += current_video->offset_y;
-			dstrect = &hw_rect;
+static void SDL_TARGETING("sse2")
+SDL_FillRectSSE2(Uint8 *row, int w, int h, int pitch, int bpp, Uint32 color)
+{
+	Uint32 words[(16+48+48)/4];
+	Uint8 *pattern = (Uint8 *)words;
+	int len = w * bpp;
+	int stream = SDL_FillShouldStream(w, h, bpp);
+
+	SDL_FillPattern(words, sizeof(words), bpp, color);
+	while ( h-- ) {
+		Uint8 *d = row;
+		int n = len;
+		int head = (int)(-(uintptr_t)d & 15);
+		__m128i v0, v1, v2, t;
+
+		if ( head > n ) {
+			head = n;
 		}
-		return(video->FillHWRect(this, dst, dstrect, color));
+		SDL_memcpy(d, pattern, head);
+		d += head;
+		n -= head;
+
+		/* d is aligned now, and 'head' bytes into the pattern */
+		v0 = _mm_loadu_si128((__m128i *)(pattern + head));
+		v1 = _mm_loadu_si128((__m128i *)(pattern + head + 16));
+		v2 = _mm_loadu_si128((__m128i *)(pattern + head + 32));
+		if ( stream ) {
+			while ( n >= 48 ) {
+				_mm_stream_si128((__m128i *)d, v0);
+				_mm_stream_si128((__m128i *)(d + 16), v1);
+				_mm_stream_si128((__m128i *)(d + 32), v2);
+				d += 48;
+				n -= 48;
+			}
+		} else {
+			while ( n >= 48 ) {
+				_mm_store_si128((__m128i *)d, v0);
+				_mm_store_si128((__m128i *)(d + 16), v1);
+				_mm_store_si128((__m128i *)(d + 32), v2);
+				d += 48;
+				n -= 48;
+			}
+		}
+		while ( n >= 16 ) {
+			_mm_store_si128((__m128i *)d, v0);
+			t = v0; v0 = v1; v1 = v2; v2 = t;
+			head += 16;
+			d += 16;
+			n -= 16;
+		}
+		SDL_memcpy(d, pattern + head, n);
+		row += pitch;
+	}
+	if ( stream ) {
+		_mm_sfence();
 	}
+}
 
-	/* Perform software fill */
-	if ( SDL_LockSurface(dst) != 0 ) {
-		return(-1);
+#if SDL_AVX2_BLITTERS
+static void SDL_TARGETING("avx2")
+SDL_FillRectAVX2(Uint8 *row, int w, int h, int pitch, int bpp, Uint32 color)
+{
+	Uint32 words[(32+96+96)/4];
+	Uint8 *pattern = (Uint8 *)words;
+	int len = w * bpp;
+	int stream = SDL_FillShouldStream(w, h, bpp);
+
+	SDL_FillPattern(words, sizeof(words), bpp, color);
+	while ( h-- ) {
+		Uint8 *d = row;
+		int n = len;
+		int head = (int)(-(uintptr_t)d & 31);
+		__m256i v0, v1, v2, t;
+
+		if ( head > n ) {
+			head = n;
+		}
+		SDL_memcpy(d, pattern, head);
+		d += head;
+		n -= head;
+
+		/* d is aligned now, and 'head' bytes into the pattern */
+		v0 = _mm256_loadu_si256((__m256i *)(pattern + head));
+		v1 = _mm256_loadu_si256((__m256i *)(pattern + head + 32));
+		v2 = _mm256_loadu_si256((__m256i *)(pattern + head + 64));
+		if ( stream ) {
+			while ( n >= 96 ) {
+				_mm256_stream_si256((__m256i *)d, v0);
+				_mm256_stream_si256((__m256i *)(d + 32), v1);
+				_mm256_stream_si256((__m256i *)(d + 64), v2);
+				d += 96;
+				n -= 96;
+			}
+		} else {
+			while ( n >= 96 ) {
+				_mm256_store_si256((__m256i *)d, v0);
+				_mm256_store_si256((__m256i *)(d + 32), v1);
+				_mm256_store_si256((__m256i *)(d + 64), v2);
+				d += 96;
+				n -= 96;
+			}
+		}
+		while ( n >= 32 ) {
+			_mm256_store_si256((__m256i *)d, v0);
+			t = v0; v0 = v1; v1 = v2; v2 = t;
+			head += 32;
+			d += 32;
+			n -= 32;
+		}
+		SDL_memcpy(d, pattern + head, n);
+		row += pitch;
+	}
+	if ( stream ) {
+		_mm_sfence();
 	}
+	_mm256_zeroupper();
+}
+#endif /* SDL_AVX2_BLITTERS */
+#endif /* SDL_SSE2_BLITTERS */
+
+/*
+ * Fill an already clipped rectangle of a locked software surface
+ */
+static void SDL_FillRectLocked(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	int x, y;
+	Uint8 *row;
+
 	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+
 			dstrect->x*dst->format->BytesPerPixel;
 #if SDL_ARM_NEON_BLITTERS
@@ -620,8 +858,7 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
             break;
         }
 
-        SDL_UnlockSurface(dst);
-        return(0);
+        return;
     }
 #endif
 #if SDL_ARM_SIMD_BLITTERS
@@ -641,8 +878,22 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 			break;
 		}
 
-		SDL_UnlockSurface(dst);
-		return(0);
+		return;
+	}
+#endif
+#if SDL_SSE2_BLITTERS
+	/* Narrow rows are filled faster without setting up the vectors */
+	if ( SDL_HasSSE2() &&
+	     (dstrect->w * dst->format->BytesPerPixel >= 256) ) {
+#if SDL_AVX2_BLITTERS
+		if ( SDL_HasAVX2() ) {
+			SDL_FillRectAVX2(row, dstrect->w, dstrect->h, dst->pitch,
+			                 dst->format->BytesPerPixel, color);
+		} else
+#endif
+		SDL_FillRectSSE2(row, dstrect->w, dstrect->h, dst->pitch,
+		                 dst->format->BytesPerPixel, color);
+		return;
 	}
 #endif
 	if ( dst->format->palette || (color == 0) ) {
@@ -767,12 +1018,303 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 			break;
 		}
 	}
+}
+
+/* 
+ * This function performs a fast fill of the given rectangle with 'color'
+ */
+int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+
+	/* This function doesn't work on surfaces < 8 bpp */
+	if ( dst->format->BitsPerPixel < 8 ) {
+		switch(dst->format->BitsPerPixel) {
+		    case 1:
+			return SDL_FillRect1(dst, dstrect, color);
+			break;
+		    case 4:
+			return SDL_FillRect4(dst, dstrect, color);
+			break;
+		    default:
+			SDL_SetError("Fill rect on unsupported surface format");
+			return(-1);
+			break;
+		}
+	}
+
+	/* If 'dstrect' == NULL, then fill the whole surface */
+	if ( dstrect ) {
+		/* Perform clipping */
+		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
+			return(0);
+		}
+	} else {
+		dstrect = &dst->clip_rect;
+	}
+	SDL_AddDirtyRect(dst, dstrect);
+
+	/* Check for hardware acceleration */
+	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
+					video->info.blit_fill ) {
+		SDL_Rect hw_rect;
+		if ( dst == SDL_VideoSurface ) {
+			hw_rect = *dstrect;
+			hw_rect.x += current_video->offset_x;
+			hw_rect.y += current_video->offset_y;
+			dstrect = &hw_rect;
+		}
+		return(video->FillHWRect(this, dst, dstrect, color));
+	}
+
+	/* Perform software fill */
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	SDL_FillRectLocked(dst, dstrect, color);
 	SDL_UnlockSurface(dst);
 
 	/* We're done! */
 	return(0);
 }
 
+/*
+ * Merge two fill rectangles if their union is also a rectangle
+ */
+static int SDL_MergeFillRects(SDL_Rect *a, const SDL_Rect *b)
+{
+	int ax2 = a->x + a->w, ay2 = a->y + a->h;
+	int bx2 = b->x + b->w, by2 = b->y + b->h;
+
+	if ( (b->x >= a->x) && (bx2 <= ax2) && (b->y >= a->y) && (by2 <= ay2) ) {
+		/* b is inside a */
+		return(1);
+	}
+	if ( (a->x >= b->x) && (ax2 <= bx2) && (a->y >= b->y) && (ay2 <= by2) ) {
+		/* a is inside b */
+		*a = *b;
+		return(1);
+	}
+	if ( (a->y == b->y) && (a->h == b->h) &&
+	     (b->x <= ax2) && (a->x <= bx2) ) {
+		/* Same rows, touching or overlapping columns */
+		if ( b->x < a->x ) {
+			a->x = b->x;
+		}
+		a->w = (Uint16)(((bx2 > ax2) ? bx2 : ax2) - a->x);
+		return(1);
+	}
+	if ( (a->x == b->x) && (a->w == b->w) &&
+	     (b->y <= ay2) && (a->y <= by2) ) {
+		/* Same columns, touching or overlapping rows */
+		if ( b->y < a->y ) {
+			a->y = b->y;
+		}
+		a->h = (Uint16)(((by2 > ay2) ? by2 : ay2) - a->y);
+		return(1);
+	}
+	return(0);
+}
+
+/* Clipped rectangles lie on the surface, so their position packs into a
+   key that orders them by row, then by column, given the number of bits
+   in the rightmost column */
+#define FILL_RECT_KEY(r, xbits) \
+	(((Uint32)(Uint16)(r).y << (xbits)) | (Uint16)(r).x)
+
+/* Shorter batches are sorted in place, longer ones a key byte at a time */
+#define FILL_RECTS_INSERT	32
+
+/* Sort the rectangles by their key, comparing the keys inline since this
+   runs for every batch.  The result is left in either 'rects' or 'tmp',
+   which is returned. */
+static SDL_Rect *SDL_SortFillRects(SDL_Rect *rects, SDL_Rect *tmp, int n,
+                                   int xbits)
+{
+	int count[4][256];
+	SDL_Rect rect, *swap;
+	Uint32 key;
+	int i, j, d, sum;
+
+	if ( n <= FILL_RECTS_INSERT ) {
+		for ( i = 1; i < n; ++i ) {
+			rect = rects[i];
+			key = FILL_RECT_KEY(rect, xbits);
+			for ( j = i; (j > 0) &&
+			     (FILL_RECT_KEY(rects[j-1], xbits) > key); --j ) {
+				rects[j] = rects[j-1];
+			}
+			rects[j] = rect;
+		}
+		return(rects);
+	}
+
+	/* Batches built in drawing order often need no sorting at all */
+	for ( i = 1; i < n; ++i ) {
+		if ( FILL_RECT_KEY(rects[i-1], xbits) > FILL_RECT_KEY(rects[i], xbits) ) {
+			break;
+		}
+	}
+	if ( i >= n ) {
+		return(rects);
+	}
+
+	/* Count every key byte at once */
+	SDL_memset(count, 0, sizeof(count));
+	for ( i = 0; i < n; ++i ) {
+		key = FILL_RECT_KEY(rects[i], xbits);
+		++count[0][key & 0xFF];
+		++count[1][(key >> 8) & 0xFF];
+		++count[2][(key >> 16) & 0xFF];
+		++count[3][key >> 24];
+	}
+
+	key = FILL_RECT_KEY(rects[0], xbits);
+	for ( d = 0; d < 4; ++d ) {
+		/* Skip the bytes that are the same in every key */
+		if ( count[d][(key >> (8*d)) & 0xFF] == n ) {
+			continue;
+		}
+		for ( i = 0, sum = 0; i < 256; ++i ) {
+			j = count[d][i];
+			count[d][i] = sum;
+			sum += j;
+		}
+		for ( i = 0; i < n; ++i ) {
+			key = FILL_RECT_KEY(rects[i], xbits) >> (8*d);
+			tmp[count[d][key & 0xFF]++] = rects[i];
+		}
+		swap = rects;
+		rects = tmp;
+		tmp = swap;
+	}
+	return(rects);
+}
+
+/* Batches up to this size are merged without allocating memory */
+#define FILL_RECTS_STACK	128
+
+/*
+ * This function fills a batch of rectangles with 'color'
+ */
+int SDL_FillRects(SDL_Surface *dst, int numrects, SDL_Rect *rects, Uint32 color)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+	SDL_Rect stack_mem[2*FILL_RECTS_STACK];
+	SDL_Rect *mem, *fill;
+	int i, j, n, row, xbits;
+	int retval = 0;
+
+	if ( numrects <= 0 ) {
+		return(0);
+	}
+
+	/* The bit-packed fills aren't worth batching */
+	if ( dst->format->BitsPerPixel < 8 ) {
+		for ( i = 0; i < numrects; ++i ) {
+			SDL_Rect rect = rects[i];
+			if ( SDL_FillRect(dst, &rect, color) < 0 ) {
+				retval = -1;
+			}
+		}
+		return(retval);
+	}
+
+	/* Room for the rectangles and a second copy for sorting them */
+	if ( numrects <= FILL_RECTS_STACK ) {
+		mem = stack_mem;
+	} else {
+		mem = (SDL_Rect *)SDL_malloc(2 * numrects * sizeof(*mem));
+		if ( mem == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+	}
+
+	/* Clip the rectangles, dropping the empty ones */
+	n = 0;
+	for ( i = 0; i < numrects; ++i ) {
+		if ( SDL_IntersectRect(&rects[i], &dst->clip_rect, &mem[n]) ) {
+			++n;
+		}
+	}
+
+	xbits = 0;
+	while ( (dst->clip_rect.x + dst->clip_rect.w) >> xbits ) {
+		++xbits;
+	}
+
+	/* Sort by row, then merge each rectangle with the later ones in its
+	   row up to its right edge, and those in the rows below that start
+	   no lower than its bottom edge.  Going from the last one up, the
+	   later ones are already merged, so a grid of tiles becomes one
+	   rectangle in a single pass.  Merged rectangles are emptied, and
+	   the rest packed down afterwards. */
+	fill = SDL_SortFillRects(mem, mem + numrects, n, xbits);
+	row = n;
+	for ( i = n-1; i >= 0; --i ) {
+		if ( (i < n-1) && (fill[i+1].y != fill[i].y) ) {
+			row = i+1;
+		}
+		for ( j = i+1; (j < row) && (fill[j].x <= fill[i].x + fill[i].w); ++j ) {
+			if ( (fill[j].w != 0) && SDL_MergeFillRects(&fill[i], &fill[j]) ) {
+				fill[j].w = 0;
+			}
+		}
+		for ( j = row; (j < n) && (fill[j].y <= fill[i].y + fill[i].h); ++j ) {
+			if ( (fill[j].w != 0) && SDL_MergeFillRects(&fill[i], &fill[j]) ) {
+				fill[j].w = 0;
+			}
+		}
+	}
+	for ( i = 0, j = 0; i < n; ++i ) {
+		if ( fill[i].w != 0 ) {
+			fill[j++] = fill[i];
+		}
+	}
+	n = j;
+	for ( i = 0; i < n; ++i ) {
+		SDL_AddDirtyRect(dst, &fill[i]);
+	}
+
+	/* Check for hardware acceleration */
+	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
+					video->info.blit_fill ) {
+		for ( i = 0; i < n; ++i ) {
+			if ( dst == SDL_VideoSurface ) {
+				fill[i].x += current_video->offset_x;
+				fill[i].y += current_video->offset_y;
+			}
+			if ( video->FillHWRect(this, dst, &fill[i], color) < 0 ) {
+				retval = -1;
+			}
+		}
+		if ( mem != stack_mem ) {
+			SDL_free(mem);
+		}
+		return(retval);
+	}
+
+	/* Perform software fill */
+	if ( SDL_LockSurface(dst) != 0 ) {
+		if ( mem != stack_mem ) {
+			SDL_free(mem);
+		}
+		return(-1);
+	}
+	for ( i = 0; i < n; ++i ) {
+		SDL_FillRectLocked(dst, &fill[i], color);
+	}
+	SDL_UnlockSurface(dst);
+	if ( mem != stack_mem ) {
+		SDL_free(mem);
+	}
+
+	return(retval);
+}
+
 /*
  * Lock a surface to directly access the pixels
  */
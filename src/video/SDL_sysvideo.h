@@ -273,6 +273,7 @@ struct SDL_VideoDevice {
 
 	/* Driver information flags */
 	int handles_any_size;	/* Driver handles any size video mode */
+	int async_present_ok;	/* Driver can be called from two threads at once */
 
 	/* * * */
 	/* Data used by the GL drivers */
@@ -426,4 +427,12 @@ extern SDL_VideoDevice *current_video;
 #define SDL_ShadowSurface	(current_video->shadow)
 #define SDL_PublicSurface	(current_video->visible)
 
+/* Record a rectangle of the screen changed by a blit or fill, for
+   SDL_VIDEO_DIRTY_RECTS; a NULL rectangle means the whole screen. */
+extern void SDL_AddDirtyRect(SDL_Surface *surface, const SDL_Rect *rect);
+
+/* Wait until the frame handed to the SDL_VIDEO_ASYNC_PRESENT thread is up,
+   before anything else uses the video surface or the driver. */
+extern void SDL_WaitPresent(void);
+
 #endif /* _SDL_sysvideo_h */
@@ -145,6 +145,11 @@ void SDL_VideoQuit(void);
 void SDL_GL_UpdateRectsLock(SDL_VideoDevice* this, int numrects, SDL_Rect* rects);
 
 static SDL_GrabMode SDL_WM_GrabInputOff(void);
+static void SDL_DirtyRectsInit(Uint32 flags);
+static void SDL_DirtyRectsQuit(void);
+static int SDL_WantAsyncPresent(Uint32 flags);
+static void SDL_PresentInit(void);
+static void SDL_PresentQuit(void);
 #if SDL_VIDEO_OPENGL
 static int lock_count = 0;
 #endif
@@ -289,6 +294,12 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 	}
 	SDL_CursorInit(flags & SDL_INIT_EVENTTHREAD);
 
+	/* Start the blit worker threads, if they were asked for */
+	SDL_BlitThreadsInit();
+
+	/* Start caching palette lookups */
+	SDL_PaletteCacheInit();
+
 	/* We're ready to go! */
 	return(0);
 }
@@ -663,6 +674,7 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 	SDL_cursorstate &= ~CURSOR_USINGSW;
 
 	/* Clean up any previous video mode */
+	SDL_PresentQuit();
 	if ( SDL_PublicSurface != NULL ) {
 		SDL_PublicSurface = NULL;
 	}
@@ -919,12 +931,24 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 			return(NULL);
 		}
 		SDL_PublicSurface = SDL_ShadowSurface;
+	} else if ( SDL_WantAsyncPresent(flags) ) {
+		/* The app draws while the last frame is presented */
+		SDL_CreateShadowSurface(SDL_VideoSurface->format->BitsPerPixel);
+		if ( SDL_ShadowSurface == NULL ) {
+			SDL_SetError("Couldn't create shadow surface");
+			return(NULL);
+		}
+		SDL_PublicSurface = SDL_ShadowSurface;
 	} else {
 		SDL_PublicSurface = SDL_VideoSurface;
 	}
+	if ( SDL_ShadowSurface && SDL_WantAsyncPresent(flags) ) {
+		SDL_PresentInit();
+	}
 	video->info.vfmt = SDL_VideoSurface->format;
 	video->info.current_w = SDL_VideoSurface->w;
 	video->info.current_h = SDL_VideoSurface->h;
+	SDL_DirtyRectsInit(flags);
 
 	/* We're done! */
 	return(SDL_PublicSurface);
@@ -1017,6 +1041,540 @@ SDL_Surface *SDL_DisplayFormatAlpha(SDL_Surface *surface)
 	return(converted);
 }
 
+/*
+ * Dirty rectangle tracking: if SDL_VIDEO_DIRTY_RECTS is set, blits and
+ * fills onto the screen are recorded, and SDL_Flip() or SDL_UpdateRects()
+ * push only the area that changed, as a band-sorted set of rectangles.
+ */
+#define SDL_DIRTY_PENDING	256	/* rectangles recorded before merging */
+#define SDL_DIRTY_MAXRECTS	64	/* default limit on the merged set */
+
+static struct {
+	int enabled;
+	int maxrects;
+	int full;		/* the whole screen has changed */
+	int numrects;
+	SDL_Rect *rects;	/* recorded rectangles, SDL_DIRTY_PENDING */
+	int *edges;		/* band edges, 2*SDL_DIRTY_PENDING */
+	SDL_Rect *spans;	/* spans of one band, SDL_DIRTY_PENDING */
+	SDL_Rect *bands;	/* the merged set */
+	int maxbands;
+} SDL_dirty;
+
+static void SDL_DirtyRectsQuit(void)
+{
+	SDL_free(SDL_dirty.rects);
+	SDL_free(SDL_dirty.edges);
+	SDL_free(SDL_dirty.spans);
+	SDL_free(SDL_dirty.bands);
+	SDL_memset(&SDL_dirty, 0, sizeof(SDL_dirty));
+}
+
+static void SDL_DirtyRectsInit(Uint32 flags)
+{
+	const char *env;
+	int maxrects;
+
+	SDL_DirtyRectsQuit();
+	env = SDL_getenv("SDL_VIDEO_DIRTY_RECTS");
+	maxrects = env ? SDL_atoi(env) : 0;
+	if ( (maxrects <= 0) || (flags & SDL_OPENGL) ) {
+		return;
+	}
+	if ( maxrects == 1 ) {
+		maxrects = SDL_DIRTY_MAXRECTS;
+	} else if ( maxrects > SDL_DIRTY_PENDING/2 ) {
+		maxrects = SDL_DIRTY_PENDING/2;
+	}
+	SDL_dirty.rects = (SDL_Rect *)SDL_malloc(SDL_DIRTY_PENDING*sizeof(SDL_Rect));
+	SDL_dirty.edges = (int *)SDL_malloc(2*SDL_DIRTY_PENDING*sizeof(int));
+	SDL_dirty.spans = (SDL_Rect *)SDL_malloc(SDL_DIRTY_PENDING*sizeof(SDL_Rect));
+	if ( !SDL_dirty.rects || !SDL_dirty.edges || !SDL_dirty.spans ) {
+		SDL_DirtyRectsQuit();
+		return;
+	}
+	SDL_dirty.maxrects = maxrects;
+	SDL_dirty.enabled = 1;
+}
+
+static int SDLCALL SDL_CompareDirtyEdges(const void *a, const void *b)
+{
+	return(*(const int *)a - *(const int *)b);
+}
+
+static int SDLCALL SDL_CompareDirtySpans(const void *a, const void *b)
+{
+	return(((const SDL_Rect *)a)->x - ((const SDL_Rect *)b)->x);
+}
+
+/*
+ * Turn the recorded rectangles into bands: rows of rectangles sharing y
+ * and h, sorted by x and not touching, with no two bands overlapping.
+ * A band with the same spans as the one right above it is merged into it.
+ * Returns the number of rectangles in SDL_dirty.bands, or -1 when out of
+ * memory.
+ */
+static int SDL_DirtyBands(void)
+{
+	const SDL_Rect *rects = SDL_dirty.rects;
+	int n = SDL_dirty.numrects;
+	int *edges = SDL_dirty.edges;
+	SDL_Rect *spans = SDL_dirty.spans;
+	int nedges, count, prev, prevspans;
+	int e, i, j;
+
+	nedges = 0;
+	for ( i = 0; i < n; ++i ) {
+		edges[nedges++] = rects[i].y;
+		edges[nedges++] = rects[i].y + rects[i].h;
+	}
+	SDL_qsort(edges, nedges, sizeof(*edges), SDL_CompareDirtyEdges);
+
+	count = 0;
+	prev = 0;
+	prevspans = 0;
+	for ( e = 0; e+1 < nedges; ++e ) {
+		int y0 = edges[e];
+		int y1 = edges[e+1];
+		int nspans;
+
+		if ( y0 == y1 ) {
+			continue;
+		}
+
+		/* Every rectangle covering this band covers all of it */
+		nspans = 0;
+		for ( i = 0; i < n; ++i ) {
+			if ( (rects[i].y <= y0) && (rects[i].y+rects[i].h >= y1) ) {
+				spans[nspans++] = rects[i];
+			}
+		}
+		if ( nspans == 0 ) {
+			prevspans = 0;
+			continue;
+		}
+		SDL_qsort(spans, nspans, sizeof(*spans), SDL_CompareDirtySpans);
+		j = 0;
+		for ( i = 1; i < nspans; ++i ) {
+			int x2 = spans[j].x + spans[j].w;
+			if ( spans[i].x <= x2 ) {
+				if ( spans[i].x + spans[i].w > x2 ) {
+					spans[j].w = (Uint16)(spans[i].x + spans[i].w - spans[j].x);
+				}
+			} else {
+				spans[++j] = spans[i];
+			}
+		}
+		nspans = j+1;
+
+		/* Grow the band above if it has the same spans */
+		if ( (prevspans == nspans) &&
+		     (SDL_dirty.bands[prev].y + SDL_dirty.bands[prev].h == y0) ) {
+			for ( i = 0; i < nspans; ++i ) {
+				if ( (SDL_dirty.bands[prev+i].x != spans[i].x) ||
+				     (SDL_dirty.bands[prev+i].w != spans[i].w) ) {
+					break;
+				}
+			}
+			if ( i == nspans ) {
+				for ( i = 0; i < nspans; ++i ) {
+					SDL_dirty.bands[prev+i].h += (Uint16)(y1 - y0);
+				}
+				continue;
+			}
+		}
+
+		if ( count + nspans > SDL_dirty.maxbands ) {
+			int maxbands = SDL_dirty.maxbands ? 2*SDL_dirty.maxbands : 64;
+			SDL_Rect *bands;
+
+			while ( maxbands < count + nspans ) {
+				maxbands *= 2;
+			}
+			bands = (SDL_Rect *)SDL_realloc(SDL_dirty.bands,
+						maxbands*sizeof(SDL_Rect));
+			if ( bands == NULL ) {
+				return(-1);
+			}
+			SDL_dirty.bands = bands;
+			SDL_dirty.maxbands = maxbands;
+		}
+		for ( i = 0; i < nspans; ++i ) {
+			SDL_Rect *band = &SDL_dirty.bands[count+i];
+			band->x = spans[i].x;
+			band->y = (Sint16)y0;
+			band->w = spans[i].w;
+			band->h = (Uint16)(y1 - y0);
+		}
+		prev = count;
+		prevspans = nspans;
+		count += nspans;
+	}
+	return(count);
+}
+
+/*
+ * Cut a band-sorted set down to 'maxrects' rectangles: every band becomes
+ * the one rectangle spanning it, then the neighbouring bands adding the
+ * least area are merged until few enough are left.
+ */
+static int SDL_DirtyReduce(SDL_Rect *rects, int n, int maxrects)
+{
+	int i, j, m;
+
+	m = 0;
+	for ( i = 0; i < n; i = j ) {
+		SDL_Rect band = rects[i];
+
+		for ( j = i+1; (j < n) && (rects[j].y == band.y); ++j ) {
+			band.w = (Uint16)(rects[j].x + rects[j].w - band.x);
+		}
+		if ( (m > 0) && (rects[m-1].x == band.x) &&
+		     (rects[m-1].w == band.w) &&
+		     (rects[m-1].y + rects[m-1].h == band.y) ) {
+			rects[m-1].h += band.h;
+		} else {
+			rects[m++] = band;
+		}
+	}
+
+	while ( m > maxrects ) {
+		Uint32 waste, best_waste = 0;
+		SDL_Rect merged, best_merged;
+		int best = -1;
+
+		for ( i = 0; i+1 < m; ++i ) {
+			const SDL_Rect *a = &rects[i];
+			const SDL_Rect *b = &rects[i+1];
+			int x1 = (a->x < b->x) ? a->x : b->x;
+			int x2 = (a->x+a->w > b->x+b->w) ? a->x+a->w : b->x+b->w;
+
+			merged.x = (Sint16)x1;
+			merged.y = a->y;
+			merged.w = (Uint16)(x2 - x1);
+			merged.h = (Uint16)(b->y + b->h - a->y);
+			waste = (Uint32)merged.w * merged.h -
+			        (Uint32)a->w * a->h - (Uint32)b->w * b->h;
+			if ( (best < 0) || (waste < best_waste) ) {
+				best = i;
+				best_waste = waste;
+				best_merged = merged;
+			}
+		}
+		rects[best] = best_merged;
+		SDL_memmove(&rects[best+1], &rects[best+2],
+		            (m-best-2)*sizeof(*rects));
+		--m;
+	}
+	return(m);
+}
+
+/*
+ * Record a rectangle of 'surface' changed by a blit or fill
+ */
+void SDL_AddDirtyRect(SDL_Surface *surface, const SDL_Rect *rect)
+{
+	SDL_Rect clipped;
+	int x1, y1, x2, y2;
+
+	if ( !SDL_dirty.enabled || SDL_dirty.full ||
+	     !current_video || (surface != SDL_PublicSurface) ) {
+		return;
+	}
+	if ( rect == NULL ) {
+		SDL_dirty.full = 1;
+		return;
+	}
+	x1 = (rect->x > 0) ? rect->x : 0;
+	y1 = (rect->y > 0) ? rect->y : 0;
+	x2 = (rect->x + rect->w < surface->w) ? rect->x + rect->w : surface->w;
+	y2 = (rect->y + rect->h < surface->h) ? rect->y + rect->h : surface->h;
+	if ( (x1 >= x2) || (y1 >= y2) ) {
+		return;
+	}
+	if ( (x2 - x1 == surface->w) && (y2 - y1 == surface->h) ) {
+		SDL_dirty.full = 1;
+		return;
+	}
+	clipped.x = (Sint16)x1;
+	clipped.y = (Sint16)y1;
+	clipped.w = (Uint16)(x2 - x1);
+	clipped.h = (Uint16)(y2 - y1);
+
+	if ( SDL_dirty.numrects == SDL_DIRTY_PENDING ) {
+		/* Merge what we have so far to make room */
+		int n = SDL_DirtyBands();
+		if ( n < 0 ) {
+			SDL_dirty.full = 1;
+			return;
+		}
+		if ( n > SDL_dirty.maxrects ) {
+			n = SDL_DirtyReduce(SDL_dirty.bands, n, SDL_dirty.maxrects);
+		}
+		SDL_memcpy(SDL_dirty.rects, SDL_dirty.bands, n*sizeof(SDL_Rect));
+		SDL_dirty.numrects = n;
+	}
+	SDL_dirty.rects[SDL_dirty.numrects++] = clipped;
+}
+
+/*
+ * Hand over the merged set of changed rectangles and start a new one
+ */
+static int SDL_FlushDirtyRects(SDL_Surface *screen, SDL_Rect **rects)
+{
+	int n;
+
+	n = 0;
+	if ( !SDL_dirty.full && SDL_dirty.numrects ) {
+		n = SDL_DirtyBands();
+		if ( n < 0 ) {
+			SDL_dirty.full = 1;
+		} else if ( n > SDL_dirty.maxrects ) {
+			n = SDL_DirtyReduce(SDL_dirty.bands, n, SDL_dirty.maxrects);
+		}
+	}
+	if ( SDL_dirty.full ) {
+		/* SDL_dirty.rects always has room for this */
+		SDL_dirty.rects[0].x = 0;
+		SDL_dirty.rects[0].y = 0;
+		SDL_dirty.rects[0].w = screen->w;
+		SDL_dirty.rects[0].h = screen->h;
+		*rects = SDL_dirty.rects;
+		n = 1;
+	} else {
+		*rects = SDL_dirty.bands;
+	}
+	SDL_dirty.full = 0;
+	SDL_dirty.numrects = 0;
+	return(n);
+}
+
+/*
+ * Copy rectangles of the shadow surface, or of a frame taken from it,
+ * into the video surface.  The software cursor is drawn straight onto
+ * the video surface where it overlaps them, so the shadow is never
+ * touched, and the cursor lock is only held for the rectangles under
+ * the cursor.  A rectangle blitted unlocked is blitted again if the
+ * cursor was drawn or erased meanwhile, since that could have saved or
+ * restored a stale background inside it.
+ */
+static void SDL_BlitShadowRects(SDL_Surface *shadow, int numrects, SDL_Rect *rects)
+{
+	SDL_Rect mouse;
+	Uint32 draws;
+	int i;
+
+	for ( i=0; i<numrects; ++i ) {
+		SDL_Rect *rect = &rects[i];
+
+		if ( !SHOULD_DRAWCURSOR(SDL_cursorstate) ) {
+			SDL_LowerBlit(shadow, rect, SDL_VideoSurface, rect);
+			continue;
+		}
+		SDL_LockCursor();
+		SDL_MouseRect(&mouse);
+		if ( (mouse.x >= rect->x+rect->w) || (rect->x >= mouse.x+mouse.w) ||
+		     (mouse.y >= rect->y+rect->h) || (rect->y >= mouse.y+mouse.h) ) {
+			draws = SDL_cursorvideodraws;
+			SDL_UnlockCursor();
+			SDL_LowerBlit(shadow, rect, SDL_VideoSurface, rect);
+			SDL_LockCursor();
+			if ( SDL_cursorvideodraws == draws ) {
+				SDL_UnlockCursor();
+				continue;
+			}
+		}
+		SDL_LowerBlit(shadow, rect, SDL_VideoSurface, rect);
+		SDL_DrawCursorRect(rect);
+		SDL_UnlockCursor();
+	}
+}
+
+/*
+ * Hand rectangles of the video surface to the driver
+ */
+static void SDL_UpdateVideoRects(int numrects, SDL_Rect *rects)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this = current_video;
+	int i;
+
+	if ( SDL_VideoSurface->offset ) {
+		for ( i=0; i<numrects; ++i ) {
+			rects[i].x += video->offset_x;
+			rects[i].y += video->offset_y;
+		}
+		video->UpdateRects(this, numrects, rects);
+		for ( i=0; i<numrects; ++i ) {
+			rects[i].x -= video->offset_x;
+			rects[i].y -= video->offset_y;
+		}
+	} else {
+		video->UpdateRects(this, numrects, rects);
+	}
+}
+
+/*
+ * Asynchronous presentation: if SDL_VIDEO_ASYNC_PRESENT is set, the app
+ * always draws into a shadow surface.  SDL_Flip() and SDL_UpdateRects()
+ * copy the rectangles to update into a frame, and a thread converts the
+ * frame into the video surface and hands it to the driver while the app
+ * draws the next one.  Setting the video mode or the palette, toggling
+ * full screen and showing an overlay wait for it with SDL_WaitPresent().
+ * Event pumping, window manager, gamma and cursor calls still go to the
+ * driver while the thread is in UpdateRects, so this is only done for
+ * drivers that set async_present_ok.
+ */
+static struct {
+	SDL_Thread *thread;
+	SDL_sem *go;
+	SDL_sem *done;
+	int quit;
+	int busy;		/* the thread is presenting a frame */
+	SDL_Surface *frame;
+	int numrects;
+	int maxrects;
+	SDL_Rect *rects;
+} SDL_present;
+
+static int SDLCALL SDL_PresentThread(void *unused)
+{
+	for ( ;; ) {
+		SDL_SemWait(SDL_present.go);
+		if ( SDL_present.quit ) {
+			break;
+		}
+		SDL_BlitShadowRects(SDL_present.frame,
+		                    SDL_present.numrects, SDL_present.rects);
+		SDL_UpdateVideoRects(SDL_present.numrects, SDL_present.rects);
+		SDL_SemPost(SDL_present.done);
+	}
+	return(0);
+}
+
+void SDL_WaitPresent(void)
+{
+	if ( SDL_present.busy ) {
+		SDL_SemWait(SDL_present.done);
+		SDL_present.busy = 0;
+	}
+}
+
+static int SDL_WantAsyncPresent(Uint32 flags)
+{
+	const char *env;
+
+	if ( (flags & (SDL_OPENGL|SDL_HWSURFACE|SDL_DOUBLEBUF)) ||
+	     (SDL_VideoSurface->flags & (SDL_OPENGL|SDL_DOUBLEBUF)) ||
+	     !current_video->async_present_ok ) {
+		return(0);
+	}
+	env = SDL_getenv("SDL_VIDEO_ASYNC_PRESENT");
+	return(env && (SDL_atoi(env) > 0));
+}
+
+static void SDL_PresentQuit(void)
+{
+	if ( SDL_present.thread ) {
+		SDL_WaitPresent();
+		SDL_present.quit = 1;
+		SDL_SemPost(SDL_present.go);
+		SDL_WaitThread(SDL_present.thread, NULL);
+	}
+	if ( SDL_present.go ) {
+		SDL_DestroySemaphore(SDL_present.go);
+	}
+	if ( SDL_present.done ) {
+		SDL_DestroySemaphore(SDL_present.done);
+	}
+	SDL_FreeSurface(SDL_present.frame);
+	SDL_free(SDL_present.rects);
+	SDL_memset(&SDL_present, 0, sizeof(SDL_present));
+}
+
+static void SDL_PresentInit(void)
+{
+	SDL_PixelFormat *format = SDL_ShadowSurface->format;
+
+	SDL_present.frame = SDL_CreateRGBSurface(SDL_SWSURFACE,
+				SDL_ShadowSurface->w, SDL_ShadowSurface->h,
+				format->BitsPerPixel, format->Rmask,
+				format->Gmask, format->Bmask, format->Amask);
+	SDL_present.go = SDL_CreateSemaphore(0);
+	SDL_present.done = SDL_CreateSemaphore(0);
+	if ( SDL_present.frame && SDL_present.go && SDL_present.done ) {
+		SDL_present.thread = SDL_CreateThread(SDL_PresentThread, NULL);
+	}
+	if ( !SDL_present.thread ) {
+		/* Present synchronously */
+		SDL_PresentQuit();
+	}
+}
+
+/*
+ * Copy the rectangles to update into the frame and start presenting it
+ */
+static int SDL_QueuePresent(SDL_Surface *screen, int numrects, SDL_Rect *rects)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_Surface *frame = SDL_present.frame;
+	SDL_Palette *pal = screen->format->palette;
+	int bpp = screen->format->BytesPerPixel;
+	int i, h;
+
+	/* The frame is free once the last one is up */
+	SDL_WaitPresent();
+
+	if ( numrects > SDL_present.maxrects ) {
+		SDL_Rect *saved = (SDL_Rect *)SDL_realloc(SDL_present.rects,
+						numrects*sizeof(SDL_Rect));
+		if ( saved == NULL ) {
+			return(-1);
+		}
+		SDL_present.rects = saved;
+		SDL_present.maxrects = numrects;
+	}
+	for ( i=0; i<numrects; ++i ) {
+		Uint8 *src, *dst;
+
+		src = (Uint8 *)screen->pixels +
+		      rects[i].y*screen->pitch + rects[i].x*bpp;
+		dst = (Uint8 *)frame->pixels +
+		      rects[i].y*frame->pitch + rects[i].x*bpp;
+		for ( h = rects[i].h; h; --h ) {
+			SDL_memcpy(dst, src, rects[i].w*bpp);
+			src += screen->pitch;
+			dst += frame->pitch;
+		}
+		SDL_present.rects[i] = rects[i];
+	}
+	SDL_present.numrects = numrects;
+
+	if ( pal ) {
+		SDL_Palette *framepal = frame->format->palette;
+		SDL_Color *colors = pal->colors;
+
+		if ( !(SDL_VideoSurface->flags & SDL_HWPALETTE) ) {
+			/* simulated 8bpp, use correct physical palette */
+			if ( video->gammacols ) {
+				colors = video->gammacols;
+			} else if ( video->physpal ) {
+				colors = video->physpal->colors;
+			}
+		}
+		if ( SDL_memcmp(framepal->colors, colors,
+		                framepal->ncolors*sizeof(SDL_Color)) != 0 ) {
+			SDL_memcpy(framepal->colors, colors,
+			           framepal->ncolors*sizeof(SDL_Color));
+			SDL_InvalidateMap(frame->map);
+		}
+	}
+
+	SDL_present.busy = 1;
+	SDL_SemPost(SDL_present.go);
+	return(0);
+}
+
 /*
  * Update a specific portion of the physical screen
  */
@@ -1047,12 +1605,26 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 {
 	int i;
 	SDL_VideoDevice *video = current_video;
-	SDL_VideoDevice *this = current_video;
 
 	if ( (screen->flags & (SDL_OPENGL | SDL_OPENGLBLIT)) == SDL_OPENGL ) {
 		SDL_SetError("OpenGL active, use SDL_GL_SwapBuffers()");
 		return;
 	}
+	if ( SDL_dirty.enabled && (screen == SDL_PublicSurface) ) {
+		/* Push these along with everything else that changed */
+		for ( i=0; i<numrects; ++i ) {
+			SDL_AddDirtyRect(screen, &rects[i]);
+		}
+		numrects = SDL_FlushDirtyRects(screen, &rects);
+		if ( numrects == 0 ) {
+			return;
+		}
+	}
+	if ( SDL_present.thread && (screen == SDL_ShadowSurface) &&
+	     (SDL_QueuePresent(screen, numrects, rects) == 0) ) {
+		return;
+	}
+	SDL_WaitPresent();
 	if ( screen == SDL_ShadowSurface ) {
 		/* Blit the shadow surface using saved mapping */
 		SDL_Palette *pal = screen->format->palette;
@@ -1068,21 +1640,7 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 				pal->colors = video->physpal->colors;
 			}
 		}
-		if ( SHOULD_DRAWCURSOR(SDL_cursorstate) ) {
-			SDL_LockCursor();
-			SDL_DrawCursor(SDL_ShadowSurface);
-			for ( i=0; i<numrects; ++i ) {
-				SDL_LowerBlit(SDL_ShadowSurface, &rects[i], 
-						SDL_VideoSurface, &rects[i]);
-			}
-			SDL_EraseCursor(SDL_ShadowSurface);
-			SDL_UnlockCursor();
-		} else {
-			for ( i=0; i<numrects; ++i ) {
-				SDL_LowerBlit(SDL_ShadowSurface, &rects[i], 
-						SDL_VideoSurface, &rects[i]);
-			}
-		}
+		SDL_BlitShadowRects(SDL_ShadowSurface, numrects, rects);
 		if ( saved_colors ) {
 			pal->colors = saved_colors;
 		}
@@ -1091,20 +1649,7 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 		screen = SDL_VideoSurface;
 	}
 	if ( screen == SDL_VideoSurface ) {
-		/* Update the video surface */
-		if ( screen->offset ) {
-			for ( i=0; i<numrects; ++i ) {
-				rects[i].x += video->offset_x;
-				rects[i].y += video->offset_y;
-			}
-			video->UpdateRects(this, numrects, rects);
-			for ( i=0; i<numrects; ++i ) {
-				rects[i].x -= video->offset_x;
-				rects[i].y -= video->offset_y;
-			}
-		} else {
-			video->UpdateRects(this, numrects, rects);
-		}
+		SDL_UpdateVideoRects(numrects, rects);
 	}
 }
 
@@ -1114,6 +1659,24 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 int SDL_Flip(SDL_Surface *screen)
 {
 	SDL_VideoDevice *video = current_video;
+
+	if ( SDL_dirty.enabled && (screen == SDL_PublicSurface) ) {
+		if ( (SDL_VideoSurface->flags & SDL_DOUBLEBUF) != SDL_DOUBLEBUF ) {
+			/* Only push what changed since the last update */
+			SDL_UpdateRects(screen, 0, NULL);
+			return(0);
+		}
+		/* The whole back buffer is shown, start over */
+		SDL_dirty.full = 0;
+		SDL_dirty.numrects = 0;
+	}
+	if ( SDL_present.thread && (screen == SDL_ShadowSurface) ) {
+		/* The present thread does the shadow conversion */
+		SDL_UpdateRect(screen, 0, 0, 0, 0);
+		return(0);
+	}
+	SDL_WaitPresent();
+
 	/* Copy the shadow surface to the video surface */
 	if ( screen == SDL_ShadowSurface ) {
 		SDL_Rect rect;
@@ -1135,17 +1698,7 @@ int SDL_Flip(SDL_Surface *screen)
 		rect.y = 0;
 		rect.w = screen->w;
 		rect.h = screen->h;
-		if ( SHOULD_DRAWCURSOR(SDL_cursorstate) ) {
-			SDL_LockCursor();
-			SDL_DrawCursor(SDL_ShadowSurface);
-			SDL_LowerBlit(SDL_ShadowSurface, &rect,
-					SDL_VideoSurface, &rect);
-			SDL_EraseCursor(SDL_ShadowSurface);
-			SDL_UnlockCursor();
-		} else {
-			SDL_LowerBlit(SDL_ShadowSurface, &rect,
-					SDL_VideoSurface, &rect);
-		}
+		SDL_BlitShadowRects(SDL_ShadowSurface, 1, &rect);
 		if ( saved_colors ) {
 			pal->colors = saved_colors;
 		}
@@ -1280,6 +1833,9 @@ int SDL_SetPalette(SDL_Surface *screen, int which,
 	if ( !screen ) {
 		return 0;
 	}
+	if ( current_video ) {
+		SDL_WaitPresent();
+	}
 	if ( !current_video || screen != SDL_PublicSurface ) {
 		/* only screens have physical palettes */
 		which &= ~SDL_PHYSPAL;
@@ -1360,12 +1916,16 @@ void SDL_VideoQuit (void)
 
 		/* Halt event processing before doing anything else */
 		SDL_StopEventLoop();
+		SDL_PresentQuit();
 
 		/* Clean up allocated window manager items */
 		if ( SDL_PublicSurface ) {
 			SDL_PublicSurface = NULL;
 		}
 		SDL_CursorQuit();
+		SDL_BlitThreadsQuit();
+		SDL_PaletteCacheQuit();
+		SDL_DirtyRectsQuit();
 
 		/* Just in case... */
 		SDL_WM_GrabInputOff();
@@ -1950,6 +2510,7 @@ int SDL_WM_ToggleFullScreen(SDL_Surface *surface)
 	toggled = 0;
 	if ( SDL_PublicSurface && (surface == SDL_PublicSurface) &&
 	     video->ToggleFullScreen ) {
+		SDL_WaitPresent();
 		if ( surface->flags & SDL_FULLSCREEN ) {
 			toggled = video->ToggleFullScreen(this, 0);
 			if ( toggled ) {
@@ -90,6 +90,7 @@ int SDL_DisplayYUVOverlay(SDL_Overlay *overlay, SDL_Rect *dstrect)
 		SDL_SetError("Passed NULL overlay or dstrect");
 		return -1;
 	}
+	SDL_WaitPresent();
 
 	/* Clip the rectangle to the screen area */
 	srcx = 0;
@@ -148,3 +149,17 @@ void SDL_FreeYUVOverlay(SDL_Overlay *overlay)
 	}
 	SDL_free(overlay);
 }
+
+int SDL_SetYUVOverlayPlanes(SDL_Overlay *overlay, Uint8 **pixels,
+                            const Uint16 *pitches)
+{
+	if ( overlay == NULL ) {
+		SDL_SetError("Passed NULL overlay");
+		return -1;
+	}
+	if ( pixels && (pitches == NULL) ) {
+		SDL_SetError("Passed NULL pitches");
+		return -1;
+	}
+	return SDL_SetPlanesYUV_SW(overlay, pixels, pitches);
+}
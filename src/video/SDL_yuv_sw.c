@@ -85,6 +85,7 @@
 
 #include "SDL_video.h"
 #include "SDL_cpuinfo.h"
+#include "SDL_blit.h"
 #include "SDL_stretch_c.h"
 #include "SDL_yuvfuncs.h"
 #include "SDL_yuv_sw_c.h"
@@ -99,8 +100,8 @@ static struct private_yuvhwfuncs sw_yuvfuncs = {
 
 /* RGB conversion lookup tables */
 struct private_yuvhwdata {
-	SDL_Surface *stretch;
 	SDL_Surface *display;
+	int bpp;
 	Uint8 *pixels;
 	int *colortab;
 	Uint32 *rgb_2_pix;
@@ -113,6 +114,25 @@ struct private_yuvhwdata {
                           unsigned char *cb, unsigned char *out,
                           int rows, int cols, int mod );
 
+	/* SSE2 (1) or AVX2 (2) conversion, and the output format for it */
+	int simd;
+	Uint8 simd_loss[3];
+	Uint8 simd_shift[3];
+	Uint8 simd_bytepos[4];
+
+	/* The scaling tables for clipped or scaled display */
+	int scale_srcw, scale_srch;
+	int scale_dstw, scale_dsth;
+	int *scale_xtab, *scale_ytab;
+
+	/* Set if the planes belong to the application */
+	int external;
+
+	/* Row buffers for each band of a conversion split between threads */
+	Uint8 *band_mem;
+	int band_size;
+	int band_count;
+
 	/* These are just so we don't have to allocate them separately */
 	Uint16 pitches[3];
 	Uint8 *planes[3];
@@ -791,7 +811,7 @@ static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row++;
 
         }
-        row += next_row;
+        row += next_row + (mod/2);
     }
 }
 
@@ -847,7 +867,7 @@ static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row += 2*3;
 
         }
-        row += next_row;
+        row += next_row + mod*3;
     }
 }
 
@@ -863,7 +883,6 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
-    mod+=mod;
     y = rows;
     while( y-- )
     {
@@ -895,7 +914,7 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
 
         }
 
-        row += next_row;
+        row += next_row + mod;
     }
 }
 
@@ -923,6 +942,851 @@ static int free_bits_at_bottom( Uint32 a )
 }
 
 
+/* Convert one pixel with the lookup tables */
+static Uint32 YUVPixel(const struct private_yuvhwdata *swdata, int L, int cb, int cr)
+{
+	const int *colortab = swdata->colortab;
+	const Uint32 *rgb_2_pix = swdata->rgb_2_pix;
+	int cr_r = 0*768+256 + colortab[ cr + 0*256 ];
+	int crb_g = 1*768+256 + colortab[ cr + 1*256 ] + colortab[ cb + 2*256 ];
+	int cb_b = 2*768+256 + colortab[ cb + 3*256 ];
+
+	return (rgb_2_pix[ L + cr_r ] | rgb_2_pix[ L + crb_g ] | rgb_2_pix[ L + cb_b ]);
+}
+
+/* Convert pixels 'x' up to 'cols' of a row, at 1x or 2x.  The luma and
+   chroma samples are 'lstep' and 'cstep' bytes apart, so this works on
+   the planar and the packed formats.
+ */
+static void YUVRowC(const struct private_yuvhwdata *swdata,
+                    const Uint8 *lum, const Uint8 *cb, const Uint8 *cr,
+                    int lstep, int cstep, Uint8 *out, int x, int cols, int scale)
+{
+	const int bpp = swdata->bpp;
+	int i;
+
+	out += x * bpp * scale;
+	for ( ; x < cols; ++x ) {
+		Uint32 value = YUVPixel(swdata, lum[x*lstep],
+		                        cb[(x/2)*cstep], cr[(x/2)*cstep]);
+		for ( i = 0; i < scale; ++i ) {
+			switch (bpp) {
+			    case 2:
+				*(Uint16 *)out = (Uint16)value;
+				break;
+			    case 3:
+				out[0] = (value      ) & 0xFF;
+				out[1] = (value >>  8) & 0xFF;
+				out[2] = (value >> 16) & 0xFF;
+				break;
+			    case 4:
+				*(Uint32 *)out = value;
+				break;
+			}
+			out += bpp;
+		}
+	}
+}
+
+/* Whether the chroma of a format covers pairs of rows as well as columns */
+static int YUVHalfHeightChroma(Uint32 format)
+{
+	switch (format) {
+	    case SDL_YV12_OVERLAY:
+	    case SDL_IYUV_OVERLAY:
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+	    case SDL_P010_OVERLAY:
+		return(1);
+	    default:
+		return(0);
+	}
+}
+
+#if SDL_SSE2_BLITTERS
+/*
+ * SSE2 and AVX2 converters.
+ *
+ * These work a row at a time on planar Y, Cb and Cr data (packed formats
+ * are split into planes first), and give the same pixels as the table
+ * driven C code: the chroma terms are the colortab entries, computed as
+ * (|c-128| * K) >> 15 with the sign of c-128, which matches the truncated
+ * table values for every c, and the sums are clamped like rgb_2_pix does.
+ */
+#define YUV_CR_R	45919
+#define YUV_CR_G	23383
+#define YUV_CB_G	11286
+#define YUV_CB_B	58111
+
+/* Write out 24-bit pixels from the low three bytes of 32-bit values.
+   This only runs on x86, so each pixel is written with a little endian
+   32-bit store whose extra byte is overwritten by the next one.
+ */
+static void YUVStore24(const Uint32 *pixels, Uint8 *out, int n, int scale)
+{
+	const int last = n * scale - 1;
+	const int shift = scale - 1;
+	Uint32 value;
+	int i;
+
+	for ( i = 0; i < last; ++i ) {
+		value = pixels[i >> shift];
+		*(Uint32 *)out = value;
+		out += 3;
+	}
+	value = pixels[n - 1];
+	out[0] = (value      ) & 0xFF;
+	out[1] = (value >>  8) & 0xFF;
+	out[2] = (value >> 16) & 0xFF;
+}
+
+static __m128i SDL_TARGETING("sse2")
+YUVTermSSE2(__m128i mag, __m128i sign, int K)
+{
+	__m128i k = _mm_set1_epi16((short)K);
+	__m128i t = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epu16(mag, k), 1),
+	                         _mm_srli_epi16(_mm_mullo_epi16(mag, k), 15));
+	return _mm_sub_epi16(_mm_xor_si128(t, sign), sign);
+}
+
+static void SDL_TARGETING("sse2")
+YUVRowSSE2(const struct private_yuvhwdata *swdata,
+           const Uint8 *lum, const Uint8 *cb, const Uint8 *cr,
+           Uint8 *out, int cols, int scale)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c128 = _mm_set1_epi16(128);
+	const int bpp = swdata->bpp;
+	__m128i loss[3], shift[3];
+	Uint32 pixels[16];
+	Uint8 *dst = out;
+	int x, i;
+
+	for ( i = 0; i < 3; ++i ) {
+		loss[i] = _mm_cvtsi32_si128(swdata->simd_loss[i]);
+		shift[i] = _mm_cvtsi32_si128(swdata->simd_shift[i]);
+	}
+	for ( x = 0; x + 16 <= cols; x += 16 ) {
+		__m128i y8 = _mm_loadu_si128((const __m128i *)(lum + x));
+		__m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cb + x/2)), zero);
+		__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cr + x/2)), zero);
+		__m128i su, sv, tr, tg, tb, ylo, yhi, ch[4];
+
+		u = _mm_sub_epi16(u, c128);
+		v = _mm_sub_epi16(v, c128);
+		su = _mm_srai_epi16(u, 15);
+		sv = _mm_srai_epi16(v, 15);
+		u = _mm_sub_epi16(_mm_xor_si128(u, su), su);
+		v = _mm_sub_epi16(_mm_xor_si128(v, sv), sv);
+		tr = YUVTermSSE2(v, sv, YUV_CR_R);
+		tg = _mm_add_epi16(YUVTermSSE2(v, sv, YUV_CR_G), YUVTermSSE2(u, su, YUV_CB_G));
+		tb = YUVTermSSE2(u, su, YUV_CB_B);
+
+		ylo = _mm_unpacklo_epi8(y8, zero);
+		yhi = _mm_unpackhi_epi8(y8, zero);
+		ch[0] = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(tr, tr)),
+		                         _mm_add_epi16(yhi, _mm_unpackhi_epi16(tr, tr)));
+		ch[1] = _mm_packus_epi16(_mm_sub_epi16(ylo, _mm_unpacklo_epi16(tg, tg)),
+		                         _mm_sub_epi16(yhi, _mm_unpackhi_epi16(tg, tg)));
+		ch[2] = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(tb, tb)),
+		                         _mm_add_epi16(yhi, _mm_unpackhi_epi16(tb, tb)));
+		ch[3] = zero;
+
+		if ( bpp == 2 ) {
+			__m128i p[2];
+			for ( i = 0; i < 2; ++i ) {
+				__m128i r = i ? _mm_unpackhi_epi8(ch[0], zero) : _mm_unpacklo_epi8(ch[0], zero);
+				__m128i g = i ? _mm_unpackhi_epi8(ch[1], zero) : _mm_unpacklo_epi8(ch[1], zero);
+				__m128i b = i ? _mm_unpackhi_epi8(ch[2], zero) : _mm_unpacklo_epi8(ch[2], zero);
+				p[i] = _mm_or_si128(_mm_or_si128(
+					_mm_sll_epi16(_mm_srl_epi16(r, loss[0]), shift[0]),
+					_mm_sll_epi16(_mm_srl_epi16(g, loss[1]), shift[1])),
+					_mm_sll_epi16(_mm_srl_epi16(b, loss[2]), shift[2]));
+			}
+			if ( scale == 2 ) {
+				_mm_storeu_si128((__m128i *)dst + 0, _mm_unpacklo_epi16(p[0], p[0]));
+				_mm_storeu_si128((__m128i *)dst + 1, _mm_unpackhi_epi16(p[0], p[0]));
+				_mm_storeu_si128((__m128i *)dst + 2, _mm_unpacklo_epi16(p[1], p[1]));
+				_mm_storeu_si128((__m128i *)dst + 3, _mm_unpackhi_epi16(p[1], p[1]));
+			} else {
+				_mm_storeu_si128((__m128i *)dst + 0, p[0]);
+				_mm_storeu_si128((__m128i *)dst + 1, p[1]);
+			}
+		} else {
+			const Uint8 *pos = swdata->simd_bytepos;
+			__m128i lo01 = _mm_unpacklo_epi8(ch[pos[0]], ch[pos[1]]);
+			__m128i hi01 = _mm_unpackhi_epi8(ch[pos[0]], ch[pos[1]]);
+			__m128i lo23 = _mm_unpacklo_epi8(ch[pos[2]], ch[pos[3]]);
+			__m128i hi23 = _mm_unpackhi_epi8(ch[pos[2]], ch[pos[3]]);
+			__m128i p[4];
+
+			p[0] = _mm_unpacklo_epi16(lo01, lo23);
+			p[1] = _mm_unpackhi_epi16(lo01, lo23);
+			p[2] = _mm_unpacklo_epi16(hi01, hi23);
+			p[3] = _mm_unpackhi_epi16(hi01, hi23);
+			if ( bpp == 3 ) {
+				for ( i = 0; i < 4; ++i ) {
+					_mm_storeu_si128((__m128i *)pixels + i, p[i]);
+				}
+				YUVStore24(pixels, dst, 16, scale);
+			} else if ( scale == 2 ) {
+				for ( i = 0; i < 4; ++i ) {
+					_mm_storeu_si128((__m128i *)dst + 2*i, _mm_unpacklo_epi32(p[i], p[i]));
+					_mm_storeu_si128((__m128i *)dst + 2*i+1, _mm_unpackhi_epi32(p[i], p[i]));
+				}
+			} else {
+				for ( i = 0; i < 4; ++i ) {
+					_mm_storeu_si128((__m128i *)dst + i, p[i]);
+				}
+			}
+		}
+		dst += 16 * bpp * scale;
+	}
+	YUVRowC(swdata, lum, cb, cr, 1, 1, out, x, cols, scale);
+}
+
+#if SDL_AVX2_BLITTERS
+static __m256i SDL_TARGETING("avx2")
+YUVTermAVX2(__m256i mag, __m256i sign, int K)
+{
+	__m256i k = _mm256_set1_epi16((short)K);
+	__m256i t = _mm256_or_si256(_mm256_slli_epi16(_mm256_mulhi_epu16(mag, k), 1),
+	                            _mm256_srli_epi16(_mm256_mullo_epi16(mag, k), 15));
+	return _mm256_sub_epi16(_mm256_xor_si256(t, sign), sign);
+}
+
+/* The unpacks work within 128-bit lanes, so the results of each are
+   stored with their halves swapped into place */
+#define STORE_LANES(dst, a, b)						\
+{									\
+	_mm256_storeu_si256((__m256i *)(dst), _mm256_permute2x128_si256(a, b, 0x20));	\
+	_mm256_storeu_si256((__m256i *)(dst) + 1, _mm256_permute2x128_si256(a, b, 0x31));	\
+}
+
+static void SDL_TARGETING("avx2")
+YUVRowAVX2(const struct private_yuvhwdata *swdata,
+           const Uint8 *lum, const Uint8 *cb, const Uint8 *cr,
+           Uint8 *out, int cols, int scale)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c128 = _mm256_set1_epi16(128);
+	const int bpp = swdata->bpp;
+	__m128i loss[3], shift[3];
+	Uint32 pixels[32];
+	Uint8 *dst = out;
+	int x, i;
+
+	for ( i = 0; i < 3; ++i ) {
+		loss[i] = _mm_cvtsi32_si128(swdata->simd_loss[i]);
+		shift[i] = _mm_cvtsi32_si128(swdata->simd_shift[i]);
+	}
+	for ( x = 0; x + 32 <= cols; x += 32 ) {
+		__m256i y8 = _mm256_loadu_si256((const __m256i *)(lum + x));
+		__m256i u = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(cb + x/2)));
+		__m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(cr + x/2)));
+		__m256i su, sv, tr, tg, tb, ylo, yhi, ch[4];
+
+		u = _mm256_sub_epi16(u, c128);
+		v = _mm256_sub_epi16(v, c128);
+		su = _mm256_srai_epi16(u, 15);
+		sv = _mm256_srai_epi16(v, 15);
+		u = _mm256_sub_epi16(_mm256_xor_si256(u, su), su);
+		v = _mm256_sub_epi16(_mm256_xor_si256(v, sv), sv);
+		tr = YUVTermAVX2(v, sv, YUV_CR_R);
+		tg = _mm256_add_epi16(YUVTermAVX2(v, sv, YUV_CR_G), YUVTermAVX2(u, su, YUV_CB_G));
+		tb = YUVTermAVX2(u, su, YUV_CB_B);
+
+		/* Both the luma and the doubled chroma unpack to pixels 0-7
+		   and 16-23 (lo), and 8-15 and 24-31 (hi), so the packed
+		   channels come out in order */
+		ylo = _mm256_unpacklo_epi8(y8, zero);
+		yhi = _mm256_unpackhi_epi8(y8, zero);
+		ch[0] = _mm256_packus_epi16(_mm256_add_epi16(ylo, _mm256_unpacklo_epi16(tr, tr)),
+		                            _mm256_add_epi16(yhi, _mm256_unpackhi_epi16(tr, tr)));
+		ch[1] = _mm256_packus_epi16(_mm256_sub_epi16(ylo, _mm256_unpacklo_epi16(tg, tg)),
+		                            _mm256_sub_epi16(yhi, _mm256_unpackhi_epi16(tg, tg)));
+		ch[2] = _mm256_packus_epi16(_mm256_add_epi16(ylo, _mm256_unpacklo_epi16(tb, tb)),
+		                            _mm256_add_epi16(yhi, _mm256_unpackhi_epi16(tb, tb)));
+		ch[3] = zero;
+
+		if ( bpp == 2 ) {
+			__m256i p[2];
+			for ( i = 0; i < 2; ++i ) {
+				__m256i r = i ? _mm256_unpackhi_epi8(ch[0], zero) : _mm256_unpacklo_epi8(ch[0], zero);
+				__m256i g = i ? _mm256_unpackhi_epi8(ch[1], zero) : _mm256_unpacklo_epi8(ch[1], zero);
+				__m256i b = i ? _mm256_unpackhi_epi8(ch[2], zero) : _mm256_unpacklo_epi8(ch[2], zero);
+				p[i] = _mm256_or_si256(_mm256_or_si256(
+					_mm256_sll_epi16(_mm256_srl_epi16(r, loss[0]), shift[0]),
+					_mm256_sll_epi16(_mm256_srl_epi16(g, loss[1]), shift[1])),
+					_mm256_sll_epi16(_mm256_srl_epi16(b, loss[2]), shift[2]));
+			}
+			/* p[0] is pixels 0-7 and 16-23, p[1] is 8-15 and 24-31 */
+			if ( scale == 2 ) {
+				__m256i a = _mm256_unpacklo_epi16(p[0], p[0]);
+				__m256i b = _mm256_unpackhi_epi16(p[0], p[0]);
+				__m256i c = _mm256_unpacklo_epi16(p[1], p[1]);
+				__m256i d = _mm256_unpackhi_epi16(p[1], p[1]);
+				_mm256_storeu_si256((__m256i *)dst + 0, _mm256_permute2x128_si256(a, b, 0x20));
+				_mm256_storeu_si256((__m256i *)dst + 1, _mm256_permute2x128_si256(c, d, 0x20));
+				_mm256_storeu_si256((__m256i *)dst + 2, _mm256_permute2x128_si256(a, b, 0x31));
+				_mm256_storeu_si256((__m256i *)dst + 3, _mm256_permute2x128_si256(c, d, 0x31));
+			} else {
+				STORE_LANES(dst, p[0], p[1]);
+			}
+		} else {
+			const Uint8 *pos = swdata->simd_bytepos;
+			__m256i lo01 = _mm256_unpacklo_epi8(ch[pos[0]], ch[pos[1]]);
+			__m256i hi01 = _mm256_unpackhi_epi8(ch[pos[0]], ch[pos[1]]);
+			__m256i lo23 = _mm256_unpacklo_epi8(ch[pos[2]], ch[pos[3]]);
+			__m256i hi23 = _mm256_unpackhi_epi8(ch[pos[2]], ch[pos[3]]);
+			__m256i p[4], q[4];
+
+			/* Pixels 0-3|16-19, 4-7|20-23, 8-11|24-27, 12-15|28-31 */
+			p[0] = _mm256_unpacklo_epi16(lo01, lo23);
+			p[1] = _mm256_unpackhi_epi16(lo01, lo23);
+			p[2] = _mm256_unpacklo_epi16(hi01, hi23);
+			p[3] = _mm256_unpackhi_epi16(hi01, hi23);
+			/* Pixels 0-7, 8-15, 16-23, 24-31 */
+			q[0] = _mm256_permute2x128_si256(p[0], p[1], 0x20);
+			q[1] = _mm256_permute2x128_si256(p[2], p[3], 0x20);
+			q[2] = _mm256_permute2x128_si256(p[0], p[1], 0x31);
+			q[3] = _mm256_permute2x128_si256(p[2], p[3], 0x31);
+			if ( bpp == 3 ) {
+				for ( i = 0; i < 4; ++i ) {
+					_mm256_storeu_si256((__m256i *)pixels + i, q[i]);
+				}
+				YUVStore24(pixels, dst, 32, scale);
+			} else if ( scale == 2 ) {
+				for ( i = 0; i < 4; ++i ) {
+					STORE_LANES((__m256i *)dst + 2*i,
+					            _mm256_unpacklo_epi32(q[i], q[i]),
+					            _mm256_unpackhi_epi32(q[i], q[i]));
+				}
+			} else {
+				for ( i = 0; i < 4; ++i ) {
+					_mm256_storeu_si256((__m256i *)dst + i, q[i]);
+				}
+			}
+		}
+		dst += 32 * bpp * scale;
+	}
+	_mm256_zeroupper();
+	YUVRowC(swdata, lum, cb, cr, 1, 1, out, x, cols, scale);
+}
+#undef STORE_LANES
+#endif /* SDL_AVX2_BLITTERS */
+
+/* Split a row of packed 4:2:2 pixels into Y, Cb and Cr planes.
+   'yshift' is 8 if luma is in the odd bytes (UYVY), and 'swap' is set
+   if Cr comes before Cb (YVYU).
+ */
+static void SDL_TARGETING("sse2")
+YUVSplitPackedSSE2(const Uint8 *src, Uint8 *lum, Uint8 *cb, Uint8 *cr,
+                   int cols, int yshift, int swap)
+{
+	const __m128i lowbyte = _mm_set1_epi16(0xFF);
+	const __m128i lowword = _mm_set1_epi32(0xFFFF);
+	__m128i ycount = _mm_cvtsi32_si128(yshift);
+	__m128i ccount = _mm_cvtsi32_si128(8 - yshift);
+	int x;
+
+	for ( x = 0; x + 16 <= cols; x += 16 ) {
+		__m128i v0 = _mm_loadu_si128((const __m128i *)(src + 2*x));
+		__m128i v1 = _mm_loadu_si128((const __m128i *)(src + 2*x) + 1);
+		__m128i c0 = _mm_and_si128(_mm_srl_epi16(v0, ccount), lowbyte);
+		__m128i c1 = _mm_and_si128(_mm_srl_epi16(v1, ccount), lowbyte);
+		__m128i a, b;
+
+		_mm_storeu_si128((__m128i *)(lum + x), _mm_packus_epi16(
+			_mm_and_si128(_mm_srl_epi16(v0, ycount), lowbyte),
+			_mm_and_si128(_mm_srl_epi16(v1, ycount), lowbyte)));
+		a = _mm_packs_epi32(_mm_and_si128(c0, lowword), _mm_and_si128(c1, lowword));
+		b = _mm_packs_epi32(_mm_srli_epi32(c0, 16), _mm_srli_epi32(c1, 16));
+		a = _mm_packus_epi16(a, a);
+		b = _mm_packus_epi16(b, b);
+		_mm_storel_epi64((__m128i *)(cb + x/2), swap ? b : a);
+		_mm_storel_epi64((__m128i *)(cr + x/2), swap ? a : b);
+	}
+	src += (yshift ? 1 : 0);
+	for ( ; x + 2 <= cols; x += 2 ) {
+		const Uint8 *p = src + 2*x;
+		const Uint8 *c = p + (yshift ? -1 : 1);
+		lum[x] = p[0];
+		lum[x+1] = p[2];
+		cb[x/2] = swap ? c[2] : c[0];
+		cr[x/2] = swap ? c[0] : c[2];
+	}
+}
+
+/* Split 'n' interleaved pairs of bytes into two planes, swapped if 'swap' */
+static void SDL_TARGETING("sse2")
+YUVSplitPairsSSE2(const Uint8 *src, Uint8 *first, Uint8 *second, int n, int swap)
+{
+	const __m128i lowbyte = _mm_set1_epi16(0xFF);
+	int x;
+
+	if ( swap ) {
+		Uint8 *tmp = first;
+		first = second;
+		second = tmp;
+	}
+	for ( x = 0; x + 16 <= n; x += 16 ) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(src + 2*x));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + 2*x) + 1);
+		_mm_storeu_si128((__m128i *)(first + x), _mm_packus_epi16(
+			_mm_and_si128(a, lowbyte), _mm_and_si128(b, lowbyte)));
+		_mm_storeu_si128((__m128i *)(second + x), _mm_packus_epi16(
+			_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+	}
+	for ( ; x < n; ++x ) {
+		first[x] = src[2*x];
+		second[x] = src[2*x+1];
+	}
+}
+
+/* Take the top byte of 'n' little endian 16-bit samples */
+static void SDL_TARGETING("sse2")
+YUVHighBytesSSE2(const Uint8 *src, Uint8 *dst, int n)
+{
+	int x;
+
+	for ( x = 0; x + 16 <= n; x += 16 ) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(src + 2*x));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + 2*x) + 1);
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(
+			_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+	}
+	for ( ; x < n; ++x ) {
+		dst[x] = src[2*x+1];
+	}
+}
+
+static void YUVRowSIMD(const struct private_yuvhwdata *swdata,
+                       const Uint8 *lum, const Uint8 *cb, const Uint8 *cr,
+                       Uint8 *out, int cols, int scale)
+{
+#if SDL_AVX2_BLITTERS
+	if ( swdata->simd == 2 ) {
+		YUVRowAVX2(swdata, lum, cb, cr, out, cols, scale);
+		return;
+	}
+#endif
+	YUVRowSSE2(swdata, lum, cb, cr, out, cols, scale);
+}
+
+/* See if the SIMD converters can write this display format */
+static int YUVSetupSIMD(struct private_yuvhwdata *swdata, SDL_PixelFormat *format)
+{
+	Uint32 masks[3];
+	int i, j;
+
+	if ( !SDL_HasSSE2() ) {
+		return(0);
+	}
+	masks[0] = format->Rmask;
+	masks[1] = format->Gmask;
+	masks[2] = format->Bmask;
+	if ( format->BytesPerPixel == 2 ) {
+		for ( i = 0; i < 3; ++i ) {
+			int bits = number_of_bits_set(masks[i]);
+			if ( (bits == 0) || (bits > 8) ) {
+				return(0);
+			}
+			swdata->simd_loss[i] = 8 - bits;
+			swdata->simd_shift[i] = free_bits_at_bottom(masks[i]);
+		}
+	} else {
+		/* Each channel has to be a whole byte of the pixel */
+		for ( j = 0; j < 4; ++j ) {
+			swdata->simd_bytepos[j] = 3;
+		}
+		for ( i = 0; i < 3; ++i ) {
+			for ( j = 0; j < format->BytesPerPixel; ++j ) {
+				if ( masks[i] == ((Uint32)0xFF << (8*j)) ) {
+					swdata->simd_bytepos[j] = i;
+					break;
+				}
+			}
+			if ( j == format->BytesPerPixel ) {
+				return(0);
+			}
+		}
+	}
+#if SDL_AVX2_BLITTERS
+	if ( SDL_HasAVX2() ) {
+		return(2);
+	}
+#endif
+	return(1);
+}
+#endif /* SDL_SSE2_BLITTERS */
+
+/* Convert 'cols' pixels of row 'y' of the overlay, starting at the even
+   column 'x', into 'out' at 1x or 2x.  Rows that aren't three planes of
+   bytes are split into them in 'planes', which has room for 3*cols bytes.
+ */
+static void YUVConvertRow(struct private_yuvhwdata *swdata, SDL_Overlay *overlay,
+                          int x, int y, int cols, Uint8 *out, int scale,
+                          Uint8 *planes)
+{
+	const Uint8 *lum, *cb, *cr;
+	const Uint8 *packed, *chroma;
+	int lstep, cstep;
+	int u, v;
+
+	packed = overlay->pixels[0] + y * overlay->pitches[0] + x * 2;
+	chroma = NULL;
+	switch (overlay->format) {
+	    case SDL_YV12_OVERLAY:
+	    case SDL_IYUV_OVERLAY:
+		v = (overlay->format == SDL_YV12_OVERLAY) ? 1 : 2;
+		u = 3 - v;
+		lum = overlay->pixels[0] + y * overlay->pitches[0] + x;
+		cr = overlay->pixels[v] + (y/2) * overlay->pitches[v] + x/2;
+		cb = overlay->pixels[u] + (y/2) * overlay->pitches[u] + x/2;
+		lstep = 1;
+		cstep = 1;
+		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+		chroma = overlay->pixels[1] + (y/2) * overlay->pitches[1] + x;
+		lum = overlay->pixels[0] + y * overlay->pitches[0] + x;
+		cb = chroma + (overlay->format == SDL_NV21_OVERLAY);
+		cr = chroma + (overlay->format == SDL_NV12_OVERLAY);
+		lstep = 1;
+		cstep = 2;
+		break;
+	    case SDL_P010_OVERLAY:
+		/* Only the top 8 bits of each sample are used */
+		chroma = overlay->pixels[1] + (y/2) * overlay->pitches[1] + x * 2;
+		lum = packed + 1;
+		cb = chroma + 1;
+		cr = chroma + 3;
+		lstep = 2;
+		cstep = 4;
+		break;
+	    case SDL_UYVY_OVERLAY:
+		lum = packed + 1;
+		cb = packed;
+		cr = packed + 2;
+		lstep = 2;
+		cstep = 4;
+		break;
+	    case SDL_YVYU_OVERLAY:
+		lum = packed;
+		cr = packed + 1;
+		cb = packed + 3;
+		lstep = 2;
+		cstep = 4;
+		break;
+	    default:
+		lum = packed;
+		cb = packed + 1;
+		cr = packed + 3;
+		lstep = 2;
+		cstep = 4;
+		break;
+	}
+#if SDL_SSE2_BLITTERS
+	if ( swdata->simd ) {
+		Uint8 *plane_cb = planes + cols;
+		Uint8 *plane_cr = planes + cols + cols/2;
+		Uint8 *tmp = planes + 2*cols;
+
+		switch (overlay->format) {
+		    case SDL_YV12_OVERLAY:
+		    case SDL_IYUV_OVERLAY:
+			break;
+		    case SDL_NV12_OVERLAY:
+		    case SDL_NV21_OVERLAY:
+			YUVSplitPairsSSE2(chroma, plane_cb, plane_cr, cols/2,
+			                  (overlay->format == SDL_NV21_OVERLAY));
+			cb = plane_cb;
+			cr = plane_cr;
+			break;
+		    case SDL_P010_OVERLAY:
+			YUVHighBytesSSE2(packed, planes, cols);
+			YUVHighBytesSSE2(chroma, tmp, cols);
+			YUVSplitPairsSSE2(tmp, plane_cb, plane_cr, cols/2, 0);
+			lum = planes;
+			cb = plane_cb;
+			cr = plane_cr;
+			break;
+		    default:
+			YUVSplitPackedSSE2(packed, planes, plane_cb, plane_cr, cols,
+			                   (overlay->format == SDL_UYVY_OVERLAY) ? 8 : 0,
+			                   (overlay->format == SDL_YVYU_OVERLAY));
+			lum = planes;
+			cb = plane_cb;
+			cr = plane_cr;
+			break;
+		}
+		YUVRowSIMD(swdata, lum, cb, cr, out, cols, scale);
+		return;
+	}
+#endif
+	YUVRowC(swdata, lum, cb, cr, lstep, cstep, out, 0, cols, scale);
+}
+
+/* A conversion split into bands of rows, for SDL_BlitThreadsRun() */
+typedef struct {
+	struct private_yuvhwdata *swdata;
+	SDL_Overlay *overlay;
+	SDL_Rect *src;
+	SDL_Rect *dst;
+	Uint8 *lum, *Cr, *Cb;
+	Uint8 *out;
+	int scale;
+} YUVBands;
+
+/* Make sure each band has a row buffer big enough for 'overlay' */
+static int YUVSetupBands(struct private_yuvhwdata *swdata, SDL_Overlay *overlay,
+                         int bands)
+{
+	/* Room for a row split into planes, and for one row of converted
+	   pixels plus a padding pixel, 16 byte aligned */
+	int size = ((overlay->w * 3 + (overlay->w + 1) * swdata->bpp) + 15) & ~15;
+
+	if ( (bands > swdata->band_count) || (size > swdata->band_size) ) {
+		Uint8 *mem = (Uint8 *)SDL_realloc(swdata->band_mem, size * bands);
+		if ( ! mem ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		swdata->band_mem = mem;
+		swdata->band_size = size;
+		swdata->band_count = bands;
+	}
+	return(0);
+}
+
+/* The first row of a band, kept even so that the bands of the planar
+   formats start on a new chroma row */
+static int YUVBandStart(int band, int bands, int rows)
+{
+	return (((band * rows) / bands) & ~1);
+}
+
+/* Convert a band of the overlay, at 1x or 2x, a row at a time.  Like the
+   scaled conversion, an odd last column or row repeats the one before it.
+ */
+static void YUVFrameBand(void *data, int band, int bands)
+{
+	YUVBands *info = (YUVBands *)data;
+	struct private_yuvhwdata *swdata = info->swdata;
+	SDL_Overlay *overlay = info->overlay;
+	SDL_Surface *display = swdata->display;
+	const int bpp = swdata->bpp;
+	const int cols = overlay->w & ~1;
+	const int rowbytes = overlay->w * bpp * info->scale;
+	Uint8 *planes = swdata->band_mem + band * swdata->band_size;
+	Uint8 *out;
+	int rows, y, end, i;
+
+	rows = overlay->h;
+	if ( YUVHalfHeightChroma(overlay->format) ) {
+		rows &= ~1;
+	}
+	y = YUVBandStart(band, bands, rows);
+	end = (band == bands-1) ? rows : YUVBandStart(band+1, bands, rows);
+	out = info->out + y * display->pitch * info->scale;
+	if ( cols == 0 ) {
+		return;
+	}
+	for ( ; y < end; ++y ) {
+		YUVConvertRow(swdata, overlay, 0, y, cols, out, info->scale, planes);
+		if ( cols < overlay->w ) {
+			for ( i = 0; i < info->scale; ++i ) {
+				SDL_memcpy(out + (cols * info->scale + i) * bpp,
+				           out + (cols * info->scale - 1) * bpp, bpp);
+			}
+		}
+		if ( info->scale == 2 ) {
+			SDL_memcpy(out + display->pitch, out, rowbytes);
+		}
+		out += display->pitch * info->scale;
+	}
+	if ( (band == bands-1) && (rows < overlay->h) && (rows > 0) ) {
+		for ( i = 0; i < info->scale; ++i ) {
+			SDL_memcpy(out + i * display->pitch, out - display->pitch,
+			           rowbytes);
+		}
+	}
+}
+
+/* Convert a band of the overlay with the table driven converters, which
+   take whole pairs of rows of tightly packed planes */
+static void YUVLegacyBand(void *data, int band, int bands)
+{
+	YUVBands *info = (YUVBands *)data;
+	struct private_yuvhwdata *swdata = info->swdata;
+	SDL_Overlay *overlay = info->overlay;
+	SDL_Surface *display = swdata->display;
+	Uint8 *lum = info->lum, *Cr = info->Cr, *Cb = info->Cb;
+	int mod, y, end;
+
+	y = YUVBandStart(band, bands, overlay->h);
+	end = (band == bands-1) ? overlay->h : YUVBandStart(band+1, bands, overlay->h);
+	if ( (overlay->format == SDL_YV12_OVERLAY) ||
+	     (overlay->format == SDL_IYUV_OVERLAY) ) {
+		lum += y * overlay->w;
+		Cr += (y/2) * (overlay->w/2);
+		Cb += (y/2) * (overlay->w/2);
+	} else {
+		lum += y * overlay->w * 2;
+		Cr += y * overlay->w * 2;
+		Cb += y * overlay->w * 2;
+	}
+	mod = (display->pitch / display->format->BytesPerPixel);
+	if ( info->scale == 2 ) {
+		mod -= (overlay->w * 2);
+		swdata->Display2X(swdata->colortab, swdata->rgb_2_pix, lum, Cr, Cb,
+		                  info->out + y * 2 * display->pitch,
+		                  end - y, overlay->w, mod);
+	} else {
+		mod -= overlay->w;
+		swdata->Display1X(swdata->colortab, swdata->rgb_2_pix, lum, Cr, Cb,
+		                  info->out + y * display->pitch,
+		                  end - y, overlay->w, mod);
+	}
+}
+
+/* Convert the visible part of a clipped or scaled overlay straight into
+   the display, sampling it like SDL_SoftStretch() does.  Each source row
+   is converted once per band, and only across the columns that are shown.
+ */
+static void YUVScaledBand(void *data, int band, int bands)
+{
+	YUVBands *info = (YUVBands *)data;
+	struct private_yuvhwdata *swdata = info->swdata;
+	SDL_Overlay *overlay = info->overlay;
+	SDL_Surface *display = swdata->display;
+	SDL_Rect *src = info->src;
+	SDL_Rect *dst = info->dst;
+	const int bpp = swdata->bpp;
+	const int *xtab = swdata->scale_xtab;
+	const int *ytab = swdata->scale_ytab;
+	Uint8 *planes = swdata->band_mem + band * swdata->band_size;
+	Uint8 *row = planes + overlay->w * 3;
+	Uint8 *dstp;
+	int x0, cols, needed, maxrow;
+	int y, end, src_row, last_row;
+
+	/* Chroma covers pairs of pixels, and pairs of rows in the planar
+	   formats, so an odd last column or row is never converted.  A shown
+	   odd column repeats the one before it, like the last row does.
+	 */
+	x0 = src->x & ~1;
+	needed = src->x + src->w - x0;
+	cols = (needed + 1) & ~1;
+	if ( cols > (overlay->w & ~1) - x0 ) {
+		cols = (overlay->w & ~1) - x0;
+	}
+	maxrow = overlay->h - 1;
+	if ( YUVHalfHeightChroma(overlay->format) ) {
+		maxrow = (overlay->h & ~1) - 1;
+	}
+	if ( (cols <= 0) || (maxrow < 0) ) {
+		return;
+	}
+
+	y = (band * dst->h) / bands;
+	end = ((band+1) * dst->h) / bands;
+	dstp = info->out + y * display->pitch;
+	last_row = -1;
+	for ( ; y < end; ++y ) {
+		src_row = src->y + ytab[y];
+		if ( src_row > maxrow ) {
+			src_row = maxrow;
+		}
+		if ( src_row == last_row ) {
+			/* Same source row as the previous line, copy it */
+			SDL_memcpy(dstp, dstp - display->pitch, dst->w * bpp);
+		} else {
+			YUVConvertRow(swdata, overlay, x0, src_row, cols, row, 1, planes);
+			if ( needed > cols ) {
+				SDL_memcpy(row + cols * bpp, row + (cols - 1) * bpp, bpp);
+			}
+			SDL_StretchRowNearest(row + (src->x - x0) * bpp, dstp,
+			                      xtab, dst->w, bpp);
+			last_row = src_row;
+		}
+		dstp += display->pitch;
+	}
+}
+
+/* Keep the scaling tables while the rectangles stay the same size */
+static int YUVSetupScaling(struct private_yuvhwdata *swdata,
+                           SDL_Rect *src, SDL_Rect *dst)
+{
+	int *tab;
+
+	if ( swdata->scale_xtab &&
+	     (swdata->scale_srcw == src->w) && (swdata->scale_srch == src->h) &&
+	     (swdata->scale_dstw == dst->w) && (swdata->scale_dsth == dst->h) ) {
+		return(0);
+	}
+	tab = (int *)SDL_realloc(swdata->scale_xtab, (dst->w + dst->h) * sizeof(int));
+	if ( ! tab ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	SDL_StretchNearestTable(tab, src->w, dst->w);
+	SDL_StretchNearestTable(tab + dst->w, src->h, dst->h);
+	swdata->scale_xtab = tab;
+	swdata->scale_ytab = tab + dst->w;
+	swdata->scale_srcw = src->w;
+	swdata->scale_srch = src->h;
+	swdata->scale_dstw = dst->w;
+	swdata->scale_dsth = dst->h;
+	return(0);
+}
+
+/* Point the overlay at its own planes */
+static void YUVSetupPlanes(SDL_Overlay *overlay)
+{
+	struct private_yuvhwdata *swdata = overlay->hwdata;
+
+	switch (overlay->format) {
+	    case SDL_YV12_OVERLAY:
+	    case SDL_IYUV_OVERLAY:
+		overlay->pitches[0] = overlay->w;
+		overlay->pitches[1] = overlay->pitches[0] / 2;
+		overlay->pitches[2] = overlay->pitches[0] / 2;
+	        overlay->pixels[0] = swdata->pixels;
+	        overlay->pixels[1] = overlay->pixels[0] +
+		                     overlay->pitches[0] * overlay->h;
+	        overlay->pixels[2] = overlay->pixels[1] +
+		                     overlay->pitches[1] * overlay->h / 2;
+		overlay->planes = 3;
+		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+	    case SDL_P010_OVERLAY:
+		overlay->pitches[0] = overlay->w;
+		overlay->pitches[1] = (overlay->w / 2) * 2;
+		if ( overlay->format == SDL_P010_OVERLAY ) {
+			overlay->pitches[0] *= 2;
+			overlay->pitches[1] *= 2;
+		}
+	        overlay->pixels[0] = swdata->pixels;
+	        overlay->pixels[1] = overlay->pixels[0] +
+		                     overlay->pitches[0] * overlay->h;
+		overlay->planes = 2;
+		break;
+	    case SDL_YUY2_OVERLAY:
+	    case SDL_UYVY_OVERLAY:
+	    case SDL_YVYU_OVERLAY:
+		overlay->pitches[0] = overlay->w*2;
+	        overlay->pixels[0] = swdata->pixels;
+		overlay->planes = 1;
+		break;
+	    default:
+		/* We should never get here (caught above) */
+		break;
+	}
+}
+
 SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_Surface *display)
 {
 	SDL_Overlay *overlay;
@@ -953,6 +1817,9 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	    case SDL_YUY2_OVERLAY:
 	    case SDL_UYVY_OVERLAY:
 	    case SDL_YVYU_OVERLAY:
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+	    case SDL_P010_OVERLAY:
 		break;
 	    default:
 		SDL_SetError("Unsupported YUV format");
@@ -983,9 +1850,18 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		SDL_FreeYUVOverlay(overlay);
 		return(NULL);
 	}
-	swdata->stretch = NULL;
+	swdata->Display1X = NULL;
+	swdata->Display2X = NULL;
+	swdata->simd = 0;
+	swdata->external = 0;
+	swdata->scale_xtab = NULL;
+	swdata->scale_ytab = NULL;
+	swdata->band_mem = NULL;
+	swdata->band_size = 0;
+	swdata->band_count = 0;
 	swdata->display = display;
-	swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
+	swdata->bpp = display->format->BytesPerPixel;
+	swdata->pixels = (Uint8 *) SDL_malloc(width*height*3);
 	swdata->colortab = (int *)SDL_malloc(4*256*sizeof(int));
 	Cr_r_tab = &swdata->colortab[0*256];
 	Cr_g_tab = &swdata->colortab[1*256];
@@ -1122,33 +1998,15 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		break;
 	}
 
+#if SDL_SSE2_BLITTERS
+	/* Use the SSE2/AVX2 converters if they handle the display format */
+	swdata->simd = YUVSetupSIMD(swdata, display->format);
+#endif
+
 	/* Find the pitch and offset values for the overlay */
 	overlay->pitches = swdata->pitches;
 	overlay->pixels = swdata->planes;
-	switch (format) {
-	    case SDL_YV12_OVERLAY:
-	    case SDL_IYUV_OVERLAY:
-		overlay->pitches[0] = overlay->w;
-		overlay->pitches[1] = overlay->pitches[0] / 2;
-		overlay->pitches[2] = overlay->pitches[0] / 2;
-	        overlay->pixels[0] = swdata->pixels;
-	        overlay->pixels[1] = overlay->pixels[0] +
-		                     overlay->pitches[0] * overlay->h;
-	        overlay->pixels[2] = overlay->pixels[1] +
-		                     overlay->pitches[1] * overlay->h / 2;
-		overlay->planes = 3;
-		break;
-	    case SDL_YUY2_OVERLAY:
-	    case SDL_UYVY_OVERLAY:
-	    case SDL_YVYU_OVERLAY:
-		overlay->pitches[0] = overlay->w*2;
-	        overlay->pixels[0] = swdata->pixels;
-		overlay->planes = 1;
-		break;
-	    default:
-		/* We should never get here (caught above) */
-		break;
-	}
+	YUVSetupPlanes(overlay);
 
 	/* We're all done.. */
 	return(overlay);
@@ -1170,18 +2028,18 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 	int stretch;
 	int scale_2x;
 	SDL_Surface *display;
-	Uint8 *lum, *Cr, *Cb;
-	Uint8 *dstp;
-	int mod;
+	YUVBands info;
+	SDL_BlitJob job;
+	int bands;
 
 	swdata = overlay->hwdata;
 	stretch = 0;
 	scale_2x = 0;
 	if ( src->x || src->y || src->w < overlay->w || src->h < overlay->h ) {
 		/* The source rectangle has been clipped.
-		   Using a scratch surface is easier than adding clipped
-		   source support to all the blitters, plus that would
-		   slow them down in the general unclipped case.
+		   The scaling path converts only the rows and columns that
+		   are shown, which keeps clipping out of the full frame
+		   converters.
 		*/
 		stretch = 1;
 	} else if ( (src->w != dst->w) || (src->h != dst->h) ) {
@@ -1192,84 +2050,97 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 			stretch = 1;
 		}
 	}
-	if ( stretch ) {
-		if ( ! swdata->stretch ) {
-			display = swdata->display;
-			swdata->stretch = SDL_CreateRGBSurface(
-				SDL_SWSURFACE,
-				overlay->w, overlay->h,
-				display->format->BitsPerPixel,
-				display->format->Rmask,
-				display->format->Gmask,
-				display->format->Bmask, 0);
-			if ( ! swdata->stretch ) {
-				return(-1);
-			}
-		}
-		display = swdata->stretch;
-	} else {
-		display = swdata->display;
+	if ( stretch && (!src->w || !src->h || !dst->w || !dst->h) ) {
+		return(0);
 	}
+	display = swdata->display;
+	info.swdata = swdata;
+	info.overlay = overlay;
+	info.src = src;
+	info.dst = dst;
+	info.scale = scale_2x ? 2 : 1;
 	switch (overlay->format) {
 	    case SDL_YV12_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr =  overlay->pixels[1];
-		Cb =  overlay->pixels[2];
+		info.lum = overlay->pixels[0];
+		info.Cr =  overlay->pixels[1];
+		info.Cb =  overlay->pixels[2];
 		break;
 	    case SDL_IYUV_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr =  overlay->pixels[2];
-		Cb =  overlay->pixels[1];
+		info.lum = overlay->pixels[0];
+		info.Cr =  overlay->pixels[2];
+		info.Cb =  overlay->pixels[1];
 		break;
 	    case SDL_YUY2_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr = lum + 3;
-		Cb = lum + 1;
+		info.lum = overlay->pixels[0];
+		info.Cr = info.lum + 3;
+		info.Cb = info.lum + 1;
 		break;
 	    case SDL_UYVY_OVERLAY:
-		lum = overlay->pixels[0]+1;
-		Cr = lum + 1;
-		Cb = lum - 1;
+		info.lum = overlay->pixels[0]+1;
+		info.Cr = info.lum + 1;
+		info.Cb = info.lum - 1;
 		break;
 	    case SDL_YVYU_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr = lum + 1;
-		Cb = lum + 3;
+		info.lum = overlay->pixels[0];
+		info.Cr = info.lum + 1;
+		info.Cb = info.lum + 3;
+		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+	    case SDL_P010_OVERLAY:
+		/* These are only converted a row at a time */
+		info.lum = info.Cr = info.Cb = NULL;
 		break;
 	    default:
 		SDL_SetError("Unsupported YUV format in blit");
 		return(-1);
 	}
-	if ( SDL_MUSTLOCK(display) ) {
-        	if ( SDL_LockSurface(display) < 0 ) {
+
+	/* Large frames are split into bands of rows between the blit
+	   threads, starting on even source rows so each band has whole
+	   chroma rows.  This still returns with the whole frame written.
+	 */
+	bands = SDL_BlitThreadsCount(dst->w * dst->h);
+	if ( stretch ) {
+		if ( YUVSetupScaling(swdata, src, dst) < 0 ) {
 			return(-1);
 		}
-	}
-	if ( stretch ) {
-		dstp = (Uint8 *)swdata->stretch->pixels;
+		job = YUVScaledBand;
+		if ( bands > dst->h ) {
+			bands = dst->h;
+		}
 	} else {
-		dstp = (Uint8 *)display->pixels
-			+ dst->x * display->format->BytesPerPixel
-			+ dst->y * display->pitch;
+		/* The table converters only take the original formats, in
+		   the overlay's own tightly packed planes, at even sizes */
+		if ( swdata->simd || swdata->external || !swdata->Display1X ||
+		     ((overlay->w | overlay->h) & 1) ) {
+			job = YUVFrameBand;
+		} else {
+			job = YUVLegacyBand;
+		}
+		if ( bands > overlay->h / 2 ) {
+			bands = overlay->h / 2;
+		}
+	}
+	if ( bands < 1 ) {
+		bands = 1;
+	}
+	if ( YUVSetupBands(swdata, overlay, bands) < 0 ) {
+		return(-1);
 	}
-	mod = (display->pitch / display->format->BytesPerPixel);
 
-	if ( scale_2x ) {
-		mod -= (overlay->w * 2);
-		swdata->Display2X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
-	} else {
-		mod -= overlay->w;
-		swdata->Display1X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
+	if ( SDL_MUSTLOCK(display) ) {
+        	if ( SDL_LockSurface(display) < 0 ) {
+			return(-1);
+		}
 	}
+	info.out = (Uint8 *)display->pixels
+		+ dst->x * display->format->BytesPerPixel
+		+ dst->y * display->pitch;
+	SDL_BlitThreadsRun(job, &info, bands);
 	if ( SDL_MUSTLOCK(display) ) {
 		SDL_UnlockSurface(display);
 	}
-	if ( stretch ) {
-		display = swdata->display;
-		SDL_SoftStretch(swdata->stretch, src, display, dst);
-	}
 	SDL_UpdateRects(display, 1, dst);
 
 	return(0);
@@ -1281,12 +2152,15 @@ void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay)
 
 	swdata = overlay->hwdata;
 	if ( swdata ) {
-		if ( swdata->stretch ) {
-			SDL_FreeSurface(swdata->stretch);
-		}
 		if ( swdata->pixels ) {
 			SDL_free(swdata->pixels);
 		}
+		if ( swdata->scale_xtab ) {
+			SDL_free(swdata->scale_xtab);
+		}
+		if ( swdata->band_mem ) {
+			SDL_free(swdata->band_mem);
+		}
 		if ( swdata->colortab ) {
 			SDL_free(swdata->colortab);
 		}
@@ -1297,3 +2171,48 @@ void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay)
 		overlay->hwdata = NULL;
 	}
 }
+
+int SDL_SetPlanesYUV_SW(SDL_Overlay *overlay, Uint8 **pixels, const Uint16 *pitches)
+{
+	struct private_yuvhwdata *swdata;
+	int i, rowbytes;
+
+	if ( overlay->hwfuncs != &sw_yuvfuncs ) {
+		SDL_SetError("Can't set the planes of a hardware overlay");
+		return(-1);
+	}
+	swdata = overlay->hwdata;
+	if ( pixels == NULL ) {
+		YUVSetupPlanes(overlay);
+		swdata->external = 0;
+		return(0);
+	}
+	for ( i = 0; i < overlay->planes; ++i ) {
+		switch (overlay->format) {
+		    case SDL_YV12_OVERLAY:
+		    case SDL_IYUV_OVERLAY:
+			rowbytes = i ? overlay->w / 2 : overlay->w;
+			break;
+		    case SDL_NV12_OVERLAY:
+		    case SDL_NV21_OVERLAY:
+			rowbytes = i ? (overlay->w / 2) * 2 : overlay->w;
+			break;
+		    case SDL_P010_OVERLAY:
+			rowbytes = i ? (overlay->w / 2) * 4 : overlay->w * 2;
+			break;
+		    default:
+			rowbytes = overlay->w * 2;
+			break;
+		}
+		if ( !pixels[i] || (pitches[i] < rowbytes) ) {
+			SDL_SetError("Invalid YUV overlay plane");
+			return(-1);
+		}
+	}
+	for ( i = 0; i < overlay->planes; ++i ) {
+		overlay->pixels[i] = pixels[i];
+		overlay->pitches[i] = pitches[i];
+	}
+	swdata->external = 1;
+	return(0);
+}
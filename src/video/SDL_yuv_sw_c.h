@@ -35,3 +35,5 @@ extern void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay);
 extern int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst);
 
 extern void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay);
+
+extern int SDL_SetPlanesYUV_SW(SDL_Overlay *overlay, Uint8 **pixels, const Uint16 *pitches);
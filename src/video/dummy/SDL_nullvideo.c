@@ -127,6 +127,8 @@ static SDL_VideoDevice *DUMMY_CreateDevice(int devindex)
 	device->InitOSKeymap = DUMMY_InitOSKeymap;
 	device->PumpEvents = DUMMY_PumpEvents;
 
+	device->async_present_ok = 1;
+
 	device->free = DUMMY_DeleteDevice;
 
 	return device;
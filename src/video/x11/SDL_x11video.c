@@ -128,6 +128,8 @@ static SDL_VideoDevice *X11_CreateDevice(int devindex)
 
 		/* Set the driver flags */
 		device->handles_any_size = 1;
+		/* Xlib is locked by XInitThreads() */
+		device->async_present_ok = 1;
 
 		/* Set the function pointers */
 		device->VideoInit = X11_VideoInit;
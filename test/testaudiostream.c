@@ -0,0 +1,168 @@
+
+/* Test that an audio stream gives the same output however the input is split */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define NUM_FRAMES	20000
+#define MAX_OUTPUT	(1024*1024)
+
+typedef struct {
+	Uint16 src_format;
+	Uint8 src_channels;
+	int src_rate;
+	Uint16 dst_format;
+	Uint8 dst_channels;
+	int dst_rate;
+} Conversion;
+
+static const Conversion conversions[] = {
+	{ AUDIO_S16SYS, 2, 44100, AUDIO_S16SYS, 2, 48000 },
+	{ AUDIO_S16SYS, 2, 48000, AUDIO_S16SYS, 2, 44100 },
+	{ AUDIO_U8, 1, 22050, AUDIO_S16SYS, 2, 48000 },
+	{ AUDIO_S16SYS, 1, 11025, AUDIO_U8, 1, 44100 },
+	{ AUDIO_S16SYS, 2, 44100, AUDIO_S16SYS, 2, 44100 },
+	{ AUDIO_U8, 2, 44100, AUDIO_S16MSB, 2, 44100 },
+	{ AUDIO_S16SYS, 6, 48000, AUDIO_S16SYS, 6, 32000 },
+	{ AUDIO_S16SYS, 4, 8000, AUDIO_S16SYS, 4, 44100 },
+};
+
+/* Fill the buffer with a triangle wave and a little noise */
+static void MakeSound(Uint16 format, Uint8 channels, Uint8 *buf, int frames)
+{
+	int i, c, v;
+
+	for ( i=0; i<frames; ++i ) {
+		v = (i % 200) < 100 ? (i % 100) * 400 : (100 - (i % 100)) * 400;
+		v -= 20000;
+		for ( c=0; c<channels; ++c ) {
+			int s = v + (rand() % 512) - 256;
+			switch (format) {
+			    case AUDIO_U8:
+				*buf++ = (Uint8)((s >> 8) + 128);
+				break;
+			    case AUDIO_S8:
+				*buf++ = (Uint8)(s >> 8);
+				break;
+			    default:
+				if ( format == AUDIO_S16MSB ) {
+					*(Uint16 *)buf = SDL_SwapBE16((Uint16)s);
+				} else {
+					*(Uint16 *)buf = SDL_SwapLE16((Uint16)s);
+				}
+				buf += 2;
+				break;
+			}
+		}
+	}
+}
+
+/* Convert 'len' bytes, putting and getting pieces of up to 'piece' bytes */
+static int Convert(SDL_AudioStream *stream, const Uint8 *src, int len,
+                   int piece, Uint8 *dst, int maxlen)
+{
+	int put, got, n;
+
+	put = 0;
+	got = 0;
+	while ( put < len ) {
+		n = piece ? 1 + rand() % piece : len;
+		if ( n > len - put ) {
+			n = len - put;
+		}
+		if ( SDL_AudioStreamPut(stream, src + put, n) < 0 ) {
+			return(-1);
+		}
+		put += n;
+		n = piece ? rand() % (2 * piece) : maxlen;
+		if ( n > maxlen - got ) {
+			n = maxlen - got;
+		}
+		got += SDL_AudioStreamGet(stream, dst + got, n);
+	}
+	if ( SDL_AudioStreamFlush(stream) < 0 ) {
+		return(-1);
+	}
+	got += SDL_AudioStreamGet(stream, dst + got, maxlen - got);
+	return(got);
+}
+
+static int TestConversion(const Conversion *conv, Uint8 *src,
+                          Uint8 *whole, Uint8 *pieces)
+{
+	static const int piece_sizes[] = { 1, 7, 333, 4096 };
+	SDL_AudioStream *stream;
+	int len, whole_len, pieces_len;
+	int i, error;
+
+	len = NUM_FRAMES * conv->src_channels * ((conv->src_format & 0xFF) / 8);
+	MakeSound(conv->src_format, conv->src_channels, src, NUM_FRAMES);
+
+	stream = SDL_NewAudioStream(conv->src_format, conv->src_channels,
+	                            conv->src_rate, conv->dst_format,
+	                            conv->dst_channels, conv->dst_rate);
+	if ( stream == NULL ) {
+		printf("Couldn't create audio stream: %s\n", SDL_GetError());
+		return(1);
+	}
+	whole_len = Convert(stream, src, len, 0, whole, MAX_OUTPUT);
+
+	error = 0;
+	for ( i=0; i<SDL_arraysize(piece_sizes); ++i ) {
+		/* A flushed stream starts afresh, so it can be used again */
+		pieces_len = Convert(stream, src, len, piece_sizes[i],
+		                     pieces, MAX_OUTPUT);
+		if ( (pieces_len != whole_len) ||
+		     (SDL_memcmp(whole, pieces, whole_len) != 0) ) {
+			printf("0x%.4x/%d/%d -> 0x%.4x/%d/%d: pieces of %d bytes differ (%d != %d bytes)\n",
+			       conv->src_format, conv->src_channels, conv->src_rate,
+			       conv->dst_format, conv->dst_channels, conv->dst_rate,
+			       piece_sizes[i], pieces_len, whole_len);
+			error = 1;
+		}
+	}
+	SDL_FreeAudioStream(stream);
+
+	if ( !error ) {
+		printf("0x%.4x/%d/%d -> 0x%.4x/%d/%d: %d bytes, ok\n",
+		       conv->src_format, conv->src_channels, conv->src_rate,
+		       conv->dst_format, conv->dst_channels, conv->dst_rate,
+		       whole_len);
+	}
+	return(error);
+}
+
+int main(int argc, char *argv[])
+{
+	Uint8 *src, *whole, *pieces;
+	int i, status;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	src = (Uint8 *)malloc(NUM_FRAMES * 6 * 2);
+	whole = (Uint8 *)malloc(MAX_OUTPUT);
+	pieces = (Uint8 *)malloc(MAX_OUTPUT);
+	if ( !src || !whole || !pieces ) {
+		fprintf(stderr, "Out of memory\n");
+		SDL_Quit();
+		return(1);
+	}
+
+	srand(1);
+	status = 0;
+	for ( i=0; i<SDL_arraysize(conversions); ++i ) {
+		status += TestConversion(&conversions[i], src, whole, pieces);
+	}
+	printf("%s\n", status ? "Audio stream test FAILED" : "All audio stream tests passed");
+
+	free(src);
+	free(whole);
+	free(pieces);
+	SDL_Quit();
+	return(status ? 1 : 0);
+}
@@ -0,0 +1,247 @@
+
+/* Test the audio mixing functions against a plain C reference mix */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define NUM_BYTES	20000
+#define NUM_SOUNDS	9
+
+static Uint8 *sounds[NUM_SOUNDS];
+static int volumes[NUM_SOUNDS];
+static SDL_AudioVoice voices[NUM_SOUNDS];
+
+static void fillerup(void *unused, Uint8 *stream, int len)
+{
+	/* Nothing to play, the mixing is done outside the callback */
+}
+
+/* Read sample 'i' of a buffer, as a signed value */
+static int GetSample(Uint16 format, const Uint8 *buf, int i)
+{
+	switch (format) {
+	    case AUDIO_U8:
+		return(buf[i] - 128);
+	    case AUDIO_S8:
+		return((Sint8)buf[i]);
+	    case AUDIO_S16LSB:
+		return((Sint16)(buf[2*i] | (buf[2*i+1] << 8)));
+	    default:
+		return((Sint16)((buf[2*i] << 8) | buf[2*i+1]));
+	}
+}
+
+/* Write sample 'i' of a buffer, clipped to the range of the format */
+static void PutSample(Uint16 format, Uint8 *buf, int i, int sample)
+{
+	switch (format) {
+	    case AUDIO_U8:
+		/* Pinned at 0xFE like SDL_MixAudio() */
+		sample += 128;
+		buf[i] = (Uint8)(sample > 0xFE ? 0xFE : sample < 0 ? 0 : sample);
+		break;
+	    case AUDIO_S8:
+		buf[i] = (Uint8)(sample > 127 ? 127 : sample < -128 ? -128 : sample);
+		break;
+	    default:
+		if ( sample > 32767 ) {
+			sample = 32767;
+		} else if ( sample < -32768 ) {
+			sample = -32768;
+		}
+		if ( format == AUDIO_S16LSB ) {
+			buf[2*i] = sample & 0xFF;
+			buf[2*i+1] = (sample >> 8) & 0xFF;
+		} else {
+			buf[2*i] = (sample >> 8) & 0xFF;
+			buf[2*i+1] = sample & 0xFF;
+		}
+		break;
+	}
+}
+
+/* Check SDL_MixAudio() against mixing the sounds one at a time in C */
+static int TestMixAudio(Uint16 format, const Uint8 *base, Uint8 *dst,
+                        Uint8 *ref, int len)
+{
+	int samples = len / ((format & 0xFF) / 8);
+	int i, k;
+
+	SDL_memcpy(dst, base, len);
+	SDL_memcpy(ref, base, len);
+	for ( k=0; k<NUM_SOUNDS; ++k ) {
+		SDL_MixAudio(dst, sounds[k], len, volumes[k]);
+		if ( volumes[k] == 0 ) {
+			continue;
+		}
+		for ( i=0; i<samples; ++i ) {
+			PutSample(format, ref, i, GetSample(format, ref, i) +
+			          GetSample(format, sounds[k], i) * volumes[k] / SDL_MIX_MAXVOLUME);
+		}
+	}
+	return(SDL_memcmp(dst, ref, len) != 0);
+}
+
+/* Check SDL_MixAudioAccum() and SDL_MixAudioClamp() against a C sum */
+static int TestMixAudioAccum(Uint16 format, Sint32 *accum, Uint8 *dst,
+                             Uint8 *ref, int len)
+{
+	int samples = len / ((format & 0xFF) / 8);
+	int i, k, sum;
+
+	SDL_memset(accum, 0, samples * sizeof(Sint32));
+	for ( k=0; k<NUM_SOUNDS; ++k ) {
+		SDL_MixAudioAccum(accum, sounds[k], len, volumes[k]);
+	}
+	SDL_MixAudioClamp(dst, accum, len);
+
+	for ( i=0; i<samples; ++i ) {
+		sum = 0;
+		for ( k=0; k<NUM_SOUNDS; ++k ) {
+			sum += GetSample(format, sounds[k], i) * volumes[k];
+		}
+		PutSample(format, ref, i, sum / SDL_MIX_MAXVOLUME);
+	}
+	return(SDL_memcmp(dst, ref, len) != 0);
+}
+
+/* Check SDL_MixAudioVoices() against a C sum with the volume of each channel */
+static int TestMixAudioVoices(Uint16 format, int channels, const Uint8 *base,
+                              Uint8 *dst, Uint8 *ref, int len)
+{
+	int size = (format & 0xFF) / 8;
+	int samples = len / size;
+	int i, k, c, sum, volume;
+
+	SDL_memcpy(dst, base, len);
+	SDL_MixAudioVoices(dst, voices, NUM_SOUNDS, len);
+
+	for ( i=0; i<samples; ++i ) {
+		c = i % channels;
+		sum = GetSample(format, base, i) * SDL_MIX_MAXVOLUME;
+		for ( k=0; k<NUM_SOUNDS; ++k ) {
+			const SDL_AudioVoice *voice = &voices[k];
+
+			if ( !voice->src || ((Uint32)(i + 1) * size > voice->len) ) {
+				continue;
+			}
+			if ( (channels == 1) ||
+			     ((channels == 6) && ((c == 2) || (c == 3))) ) {
+				volume = (voice->left_volume + voice->right_volume) / 2;
+			} else if ( c & 1 ) {
+				volume = voice->right_volume;
+			} else {
+				volume = voice->left_volume;
+			}
+			sum += GetSample(format, voice->src, i) * volume;
+		}
+		PutSample(format, ref, i, sum / SDL_MIX_MAXVOLUME);
+	}
+	return(SDL_memcmp(dst, ref, len) != 0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const Uint16 formats[] = {
+		AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB
+	};
+	static const Uint8 channels[] = { 1, 2, 6 };
+	SDL_AudioSpec spec;
+	Uint8 *base, *dst, *ref;
+	Sint32 *accum;
+	int f, c, i, k, len;
+	int status;
+
+	if ( SDL_Init(SDL_INIT_AUDIO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	base = (Uint8 *)malloc(NUM_BYTES);
+	dst = (Uint8 *)malloc(NUM_BYTES);
+	ref = (Uint8 *)malloc(NUM_BYTES);
+	accum = (Sint32 *)malloc(NUM_BYTES * sizeof(Sint32));
+	if ( !base || !dst || !ref || !accum ) {
+		fprintf(stderr, "Out of memory\n");
+		SDL_Quit();
+		return(1);
+	}
+	srand(7);
+	for ( i=0; i<NUM_BYTES; ++i ) {
+		base[i] = (Uint8)rand();
+	}
+	for ( k=0; k<NUM_SOUNDS; ++k ) {
+		sounds[k] = (Uint8 *)malloc(NUM_BYTES);
+		if ( !sounds[k] ) {
+			fprintf(stderr, "Out of memory\n");
+			SDL_Quit();
+			return(1);
+		}
+		for ( i=0; i<NUM_BYTES; ++i ) {
+			sounds[k][i] = (Uint8)rand();
+		}
+		volumes[k] = rand() % (SDL_MIX_MAXVOLUME + 1);
+	}
+	volumes[3] = 0;
+	volumes[5] = SDL_MIX_MAXVOLUME;
+
+	/* Voices of different lengths, some panned, one silent and one empty */
+	for ( k=0; k<NUM_SOUNDS; ++k ) {
+		voices[k].src = sounds[k];
+		voices[k].len = NUM_BYTES - rand() % (NUM_BYTES / 2);
+		voices[k].left_volume = volumes[k];
+		voices[k].right_volume = (k & 1) ? volumes[k] : rand() % (SDL_MIX_MAXVOLUME + 1);
+	}
+	voices[3].right_volume = 0;
+	voices[4].src = NULL;
+
+	status = 0;
+	for ( f=0; f<SDL_arraysize(formats); ++f ) {
+		for ( c=0; c<SDL_arraysize(channels); ++c ) {
+			SDL_memset(&spec, 0, sizeof(spec));
+			spec.freq = 22050;
+			spec.format = formats[f];
+			spec.channels = channels[c];
+			spec.samples = 512;
+			spec.callback = fillerup;
+			if ( SDL_OpenAudio(&spec, NULL) < 0 ) {
+				fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+				SDL_Quit();
+				return(1);
+			}
+
+			/* Lengths around the vector sizes exercise the tails */
+			for ( len=NUM_BYTES-64; len<=NUM_BYTES; len+=6 ) {
+				if ( TestMixAudio(formats[f], base, dst, ref, len) ) {
+					printf("0x%.4x/%d: SDL_MixAudio() of %d bytes differs\n",
+					       formats[f], channels[c], len);
+					++status;
+				}
+				if ( TestMixAudioAccum(formats[f], accum, dst, ref, len) ) {
+					printf("0x%.4x/%d: SDL_MixAudioAccum() of %d bytes differs\n",
+					       formats[f], channels[c], len);
+					++status;
+				}
+				if ( TestMixAudioVoices(formats[f], channels[c], base, dst, ref, len) ) {
+					printf("0x%.4x/%d: SDL_MixAudioVoices() of %d bytes differs\n",
+					       formats[f], channels[c], len);
+					++status;
+				}
+			}
+			SDL_CloseAudio();
+		}
+	}
+	printf("%s\n", status ? "Mixing test FAILED" : "All mixing tests passed");
+
+	for ( k=0; k<NUM_SOUNDS; ++k ) {
+		free(sounds[k]);
+	}
+	free(base);
+	free(dst);
+	free(ref);
+	free(accum);
+	SDL_Quit();
+	return(status ? 1 : 0);
+}
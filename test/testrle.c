@@ -0,0 +1,208 @@
+
+/* Test saving and loading RLE accelerated surfaces */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define WIDTH	97
+#define HEIGHT	53
+
+static Uint8 cache[1024*1024];
+
+static SDL_Surface *CreateSurface(int bpp, Uint32 Amask)
+{
+	switch (bpp) {
+	    case 8:
+		return SDL_CreateRGBSurface(SDL_SWSURFACE, WIDTH, HEIGHT, 8,
+		                            0, 0, 0, 0);
+	    case 16:
+		return SDL_CreateRGBSurface(SDL_SWSURFACE, WIDTH, HEIGHT, 16,
+		                            0xF800, 0x07E0, 0x001F, 0);
+	    default:
+		return SDL_CreateRGBSurface(SDL_SWSURFACE, WIDTH, HEIGHT, bpp,
+		                            0x00FF0000, 0x0000FF00, 0x000000FF,
+		                            Amask);
+	}
+}
+
+/* Fill the surface with noise, transparent stripes and blank lines */
+static void FillSurface(SDL_Surface *surface)
+{
+	int bpp = surface->format->BytesPerPixel;
+	Uint32 Amask = surface->format->Amask;
+	Uint32 pixel;
+	int x, y;
+
+	for ( y=0; y<surface->h; ++y ) {
+		for ( x=0; x<surface->w; ++x ) {
+			pixel = ((Uint32)rand() << 16) ^ rand();
+			if ( ((x/7 + y/5) % 3) == 0 ) {
+				pixel = 0;
+			}
+			if ( Amask ) {
+				switch ((x/9 + y) % 4) {
+				    case 0:
+					pixel &= ~Amask;
+					break;
+				    case 1:
+					pixel |= Amask;
+					break;
+				}
+			}
+			SDL_memcpy((Uint8 *)surface->pixels + y*surface->pitch + x*bpp,
+			           &pixel, bpp);
+		}
+	}
+	SDL_memset((Uint8 *)surface->pixels + (surface->h-3)*surface->pitch,
+	           0, 3*surface->pitch);
+}
+
+static int SamePixels(SDL_Surface *a, SDL_Surface *b)
+{
+	int y;
+
+	for ( y=0; y<a->h; ++y ) {
+		if ( SDL_memcmp((Uint8 *)a->pixels + y*a->pitch,
+		                (Uint8 *)b->pixels + y*b->pitch,
+		                a->w*a->format->BytesPerPixel) != 0 ) {
+			return(0);
+		}
+	}
+	return(1);
+}
+
+static int TestRLE(int bpp, Uint32 Amask, int dst_bpp, int use_dst)
+{
+	SDL_Surface *src, *loaded, *truncated, *dst1, *dst2;
+	SDL_RWops *rw;
+	SDL_Rect area, pos;
+	int len, error;
+
+	src = CreateSurface(bpp, Amask);
+	dst1 = CreateSurface(dst_bpp, 0);
+	dst2 = CreateSurface(dst_bpp, 0);
+	if ( !src || !dst1 || !dst2 ) {
+		printf("Couldn't create surfaces: %s\n", SDL_GetError());
+		return(1);
+	}
+	if ( bpp == 8 ) {
+		SDL_Color colors[256];
+		int i;
+
+		for ( i=0; i<256; ++i ) {
+			colors[i].r = i;
+			colors[i].g = 255 - i;
+			colors[i].b = i * 7;
+		}
+		SDL_SetColors(src, colors, 0, 256);
+		SDL_SetColors(dst1, colors, 0, 256);
+		SDL_SetColors(dst2, colors, 0, 256);
+	}
+	FillSurface(src);
+	if ( Amask ) {
+		SDL_SetAlpha(src, SDL_SRCALPHA|SDL_RLEACCEL, 255);
+	} else {
+		SDL_SetColorKey(src, SDL_SRCCOLORKEY|SDL_RLEACCEL, 0);
+	}
+
+	/* The first blit encodes the surface */
+	SDL_FillRect(dst1, NULL, 5);
+	SDL_FillRect(dst2, NULL, 5);
+	SDL_BlitSurface(src, NULL, dst1, NULL);
+
+	error = 0;
+	rw = SDL_RWFromMem(cache, sizeof(cache));
+	if ( SDL_SaveRLE_RW(src, rw, 0) < 0 ) {
+		printf("Couldn't save %d bpp surface: %s\n", bpp, SDL_GetError());
+		SDL_RWclose(rw);
+		return(1);
+	}
+	len = SDL_RWtell(rw);
+	SDL_RWclose(rw);
+
+	loaded = SDL_LoadRLE_RW(SDL_RWFromConstMem(cache, len), 1,
+	                        use_dst ? dst2 : NULL);
+	if ( loaded == NULL ) {
+		printf("Couldn't load %d bpp surface: %s\n", bpp, SDL_GetError());
+		return(1);
+	}
+
+	/* Whole and clipped blits of the loaded surface match the original */
+	SDL_BlitSurface(loaded, NULL, dst2, NULL);
+	if ( !SamePixels(dst1, dst2) ) {
+		printf("%d -> %d bpp: blit of loaded surface differs\n", bpp, dst_bpp);
+		error = 1;
+	}
+	area.x = 5;
+	area.y = 7;
+	area.w = 40;
+	area.h = 30;
+	pos.x = 3;
+	pos.y = 2;
+	SDL_FillRect(dst1, NULL, 9);
+	SDL_FillRect(dst2, NULL, 9);
+	SDL_BlitSurface(src, &area, dst1, &pos);
+	pos.x = 3;
+	pos.y = 2;
+	SDL_BlitSurface(loaded, &area, dst2, &pos);
+	if ( !SamePixels(dst1, dst2) ) {
+		printf("%d -> %d bpp: clipped blit of loaded surface differs\n", bpp, dst_bpp);
+		error = 1;
+	}
+
+	/* Locking decodes the pixels */
+	SDL_LockSurface(src);
+	SDL_LockSurface(loaded);
+	if ( !SamePixels(src, loaded) ) {
+		printf("%d -> %d bpp: decoded pixels differ\n", bpp, dst_bpp);
+		error = 1;
+	}
+	SDL_UnlockSurface(loaded);
+	SDL_UnlockSurface(src);
+
+	/* A truncated cache fails to load */
+	truncated = SDL_LoadRLE_RW(SDL_RWFromConstMem(cache, len-1), 1, dst2);
+	if ( truncated != NULL ) {
+		printf("%d -> %d bpp: truncated cache loaded\n", bpp, dst_bpp);
+		SDL_FreeSurface(truncated);
+		error = 1;
+	}
+
+	if ( !error ) {
+		printf("%d -> %d bpp%s: %d bytes, ok\n", bpp, dst_bpp,
+		       Amask ? " with alpha" : "", len);
+	}
+	SDL_FreeSurface(loaded);
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst1);
+	SDL_FreeSurface(dst2);
+	return(error);
+}
+
+int main(int argc, char *argv[])
+{
+	int status;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	srand(3);
+
+	status = 0;
+	status += TestRLE(8, 0, 8, 1);
+	status += TestRLE(16, 0, 16, 1);
+	status += TestRLE(24, 0, 24, 1);
+	status += TestRLE(32, 0, 32, 1);
+	status += TestRLE(32, 0xFF000000, 32, 1);
+	status += TestRLE(32, 0xFF000000, 16, 1);
+	status += TestRLE(16, 0, 16, 0);
+	status += TestRLE(32, 0xFF000000, 32, 0);
+	printf("%s\n", status ? "RLE test FAILED" : "All RLE tests passed");
+
+	SDL_Quit();
+	return(status ? 1 : 0);
+}
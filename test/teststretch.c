@@ -0,0 +1,246 @@
+
+/* Test the filters of SDL_SoftStretchEx() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static const int depths[] = { 8, 16, 24, 32 };
+
+static SDL_Surface *CreateSurface(int w, int h, int bpp)
+{
+	switch (bpp) {
+	    case 8:
+		return SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 8, 0, 0, 0, 0);
+	    case 16:
+		return SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 16,
+		                            0xF800, 0x07E0, 0x001F, 0);
+	    default:
+		return SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, bpp,
+		                            0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+	}
+}
+
+static void FillNoise(SDL_Surface *surface)
+{
+	int i;
+
+	for ( i=0; i<surface->h*surface->pitch; ++i ) {
+		((Uint8 *)surface->pixels)[i] = (Uint8)rand();
+	}
+}
+
+static int SamePixels(SDL_Surface *a, SDL_Surface *b)
+{
+	int y;
+
+	for ( y=0; y<a->h; ++y ) {
+		if ( SDL_memcmp((Uint8 *)a->pixels + y*a->pitch,
+		                (Uint8 *)b->pixels + y*b->pitch,
+		                a->w*a->format->BytesPerPixel) != 0 ) {
+			return(0);
+		}
+	}
+	return(1);
+}
+
+/* Every filter copies the pixels when the size doesn't change */
+static int TestCopy(int bpp)
+{
+	static const Uint32 filters[] = {
+		SDL_STRETCH_NEAREST, SDL_STRETCH_BILINEAR, SDL_STRETCH_BOX
+	};
+	SDL_Surface *src, *dst;
+	int i, error;
+
+	src = CreateSurface(61, 37, bpp);
+	dst = CreateSurface(61, 37, bpp);
+	FillNoise(src);
+	error = 0;
+	for ( i=0; i<SDL_arraysize(filters); ++i ) {
+		SDL_FillRect(dst, NULL, 0);
+		if ( (SDL_SoftStretchEx(src, NULL, dst, NULL, filters[i]) < 0) ||
+		     !SamePixels(src, dst) ) {
+			printf("%d bpp: 1:1 stretch with filter %d isn't a copy\n",
+			       bpp, (int)filters[i]);
+			error = 1;
+		}
+	}
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst);
+	return(error);
+}
+
+/* The nearest filter, SDL_SoftStretch() and a reused context agree */
+static int TestNearest(int bpp)
+{
+	SDL_StretchContext *ctx;
+	SDL_Surface *src, *dst1, *dst2;
+	SDL_Rect srcrect, dstrect;
+	int i, error;
+
+	src = CreateSurface(123, 77, bpp);
+	dst1 = CreateSurface(300, 200, bpp);
+	dst2 = CreateSurface(300, 200, bpp);
+	ctx = SDL_CreateStretchContext();
+	FillNoise(src);
+	error = 0;
+	for ( i=0; i<50; ++i ) {
+		srcrect.x = rand() % 100;
+		srcrect.y = rand() % 60;
+		srcrect.w = 1 + rand() % (src->w - srcrect.x);
+		srcrect.h = 1 + rand() % (src->h - srcrect.y);
+		dstrect.x = rand() % 250;
+		dstrect.y = rand() % 150;
+		dstrect.w = 1 + rand() % (dst1->w - dstrect.x);
+		dstrect.h = 1 + rand() % (dst1->h - dstrect.y);
+		SDL_SoftStretch(src, &srcrect, dst1, &dstrect);
+		SDL_SoftStretchEx(src, &srcrect, dst2, &dstrect, SDL_STRETCH_NEAREST);
+		if ( !SamePixels(dst1, dst2) ) {
+			printf("%d bpp: SDL_SoftStretchEx() differs from SDL_SoftStretch()\n", bpp);
+			error = 1;
+			break;
+		}
+		SDL_SoftStretchContext(ctx, src, &srcrect, dst2, &dstrect, SDL_STRETCH_NEAREST);
+		SDL_SoftStretchContext(ctx, src, &srcrect, dst2, &dstrect, SDL_STRETCH_NEAREST);
+		if ( !SamePixels(dst1, dst2) ) {
+			printf("%d bpp: SDL_SoftStretchContext() differs from SDL_SoftStretch()\n", bpp);
+			error = 1;
+			break;
+		}
+	}
+	SDL_FreeStretchContext(ctx);
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst1);
+	SDL_FreeSurface(dst2);
+	return(error);
+}
+
+/* Halving with the box filter averages each 2x2 block, rounding */
+static int TestBox(int bpp)
+{
+	SDL_Surface *src, *dst;
+	Uint8 *s0, *s1, *d;
+	int x, y, c, sum, bytes;
+	int error;
+
+	src = CreateSurface(64, 48, bpp);
+	dst = CreateSurface(32, 24, bpp);
+	FillNoise(src);
+	if ( SDL_SoftStretchEx(src, NULL, dst, NULL, SDL_STRETCH_BOX) < 0 ) {
+		printf("%d bpp: box stretch failed: %s\n", bpp, SDL_GetError());
+		return(1);
+	}
+	error = 0;
+	bytes = src->format->BytesPerPixel;
+	for ( y=0; y<dst->h && !error; ++y ) {
+		s0 = (Uint8 *)src->pixels + (2*y)*src->pitch;
+		s1 = s0 + src->pitch;
+		d = (Uint8 *)dst->pixels + y*dst->pitch;
+		for ( x=0; x<dst->w && !error; ++x ) {
+			for ( c=0; c<bytes; ++c ) {
+				sum = s0[(2*x)*bytes+c] + s0[(2*x+1)*bytes+c] +
+				      s1[(2*x)*bytes+c] + s1[(2*x+1)*bytes+c];
+				if ( d[x*bytes+c] != (sum + 2) / 4 ) {
+					printf("%d bpp: box average wrong at %d,%d\n", bpp, x, y);
+					error = 1;
+					break;
+				}
+			}
+		}
+	}
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst);
+	return(error);
+}
+
+/* Bilinear enlarging of a gradient stays between the source pixels */
+static int TestBilinear(void)
+{
+	SDL_Surface *src, *dst;
+	Uint32 *row;
+	Uint32 last;
+	int x, y;
+	int error;
+
+	src = CreateSurface(16, 4, 32);
+	dst = CreateSurface(157, 41, 32);
+	for ( y=0; y<src->h; ++y ) {
+		row = (Uint32 *)((Uint8 *)src->pixels + y*src->pitch);
+		for ( x=0; x<src->w; ++x ) {
+			row[x] = SDL_MapRGB(src->format, x*16, x*16, x*16);
+		}
+	}
+	if ( SDL_SoftStretchEx(src, NULL, dst, NULL, SDL_STRETCH_BILINEAR) < 0 ) {
+		printf("Bilinear stretch failed: %s\n", SDL_GetError());
+		return(1);
+	}
+	error = 0;
+	for ( y=0; y<dst->h && !error; ++y ) {
+		row = (Uint32 *)((Uint8 *)dst->pixels + y*dst->pitch);
+		last = 0;
+		for ( x=0; x<dst->w; ++x ) {
+			if ( (row[x] < last) || (row[x] > 0x00F0F0F0) ||
+			     ((row[x] & 0xFF) != ((row[x] >> 8) & 0xFF)) ) {
+				printf("Bilinear gradient wrong at %d,%d\n", x, y);
+				error = 1;
+				break;
+			}
+			last = row[x];
+		}
+	}
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst);
+	return(error);
+}
+
+static int TestErrors(void)
+{
+	SDL_Surface *src, *dst;
+	int error;
+
+	src = CreateSurface(16, 16, 32);
+	dst = CreateSurface(32, 32, 16);
+	error = 0;
+	if ( SDL_SoftStretchEx(src, NULL, dst, NULL, SDL_STRETCH_NEAREST) == 0 ) {
+		printf("Stretch between different formats didn't fail\n");
+		error = 1;
+	}
+	if ( SDL_SoftStretchEx(src, NULL, src, NULL,
+	                       SDL_STRETCH_BILINEAR|SDL_STRETCH_BOX) == 0 ) {
+		printf("Stretch with two filters didn't fail\n");
+		error = 1;
+	}
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst);
+	return(error);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, status;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	srand(5);
+
+	status = 0;
+	for ( i=0; i<SDL_arraysize(depths); ++i ) {
+		status += TestCopy(depths[i]);
+		status += TestNearest(depths[i]);
+		/* Paletted pixels aren't filtered, 16-bit ones aren't bytes */
+		if ( depths[i] >= 24 ) {
+			status += TestBox(depths[i]);
+		}
+	}
+	status += TestBilinear();
+	status += TestErrors();
+	printf("%s\n", status ? "Stretch test FAILED" : "All stretch tests passed");
+
+	SDL_Quit();
+	return(status ? 1 : 0);
+}